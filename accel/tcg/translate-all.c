@@ -2258,6 +2258,49 @@ int page_get_flags(target_ulong address)
     return p->flags;
 }
 
+/*
+ * Number of pages from @index to the end of its PageDesc leaf, capped at
+ * @len bytes. Range operations look up each leaf once and then walk its
+ * PageDescs directly, instead of walking the radix tree for every page.
+ */
+static inline target_ulong page_leaf_run(tb_page_addr_t index,
+                                         target_ulong len)
+{
+    target_ulong n = V_L2_SIZE - (index & (V_L2_SIZE - 1));
+
+    return MIN(n, len >> TARGET_PAGE_BITS);
+}
+
+target_ulong page_find_last_used(target_ulong start, target_ulong last)
+{
+    tb_page_addr_t first = start >> TARGET_PAGE_BITS;
+    tb_page_addr_t index = last >> TARGET_PAGE_BITS;
+
+    assert(start <= last);
+
+    for (;;) {
+        PageDesc *p = page_find(index);
+        tb_page_addr_t stop = MAX(index & ~(tb_page_addr_t)(V_L2_SIZE - 1),
+                                  first);
+
+        /* A leaf that was never allocated has no flags at all.  */
+        if (p) {
+            for (;; index--, p--) {
+                if (p->flags) {
+                    return (target_ulong)index << TARGET_PAGE_BITS;
+                }
+                if (index == stop) {
+                    break;
+                }
+            }
+        }
+        if (stop == first) {
+            return -1;
+        }
+        index = stop - 1;
+    }
+}
+
 /*
  * Allow the target to decide if PAGE_TARGET_[12] may be reset.
  * By default, they are not kept.
@@ -2272,7 +2315,7 @@ int page_get_flags(target_ulong address)
    on PAGE_WRITE.  The mmap_lock should already be held.  */
 void page_set_flags(target_ulong start, target_ulong end, int flags)
 {
-    target_ulong addr, len;
+    target_ulong addr, len, n, i;
     bool reset_target_data;
 
     /* This function should never be called with addresses outside the
@@ -2293,32 +2336,44 @@ void page_set_flags(target_ulong start, target_ulong end, int flags)
     reset_target_data = !(flags & PAGE_VALID) || (flags & PAGE_RESET);
     flags &= ~PAGE_RESET;
 
-    for (addr = start, len = end - start;
-         len != 0;
-         len -= TARGET_PAGE_SIZE, addr += TARGET_PAGE_SIZE) {
-        PageDesc *p = page_find_alloc(addr >> TARGET_PAGE_BITS, 1);
-
-        /* If the write protection bit is set, then we invalidate
-           the code inside.  */
-        if (!(p->flags & PAGE_WRITE) &&
-            (flags & PAGE_WRITE) &&
-            p->first_tb) {
-            tb_invalidate_phys_page(addr, 0);
+    for (addr = start, len = end - start; len != 0;
+         len -= n << TARGET_PAGE_BITS) {
+        /*
+         * Clearing the flags of a leaf that was never allocated is a
+         * no-op, don't allocate it just to store zeroes (munmap of
+         * large reservations).
+         */
+        PageDesc *p = page_find_alloc(addr >> TARGET_PAGE_BITS, flags != 0);
+
+        n = page_leaf_run(addr >> TARGET_PAGE_BITS, len);
+        if (!p) {
+            addr += n << TARGET_PAGE_BITS;
+            continue;
         }
-        if (reset_target_data) {
-            g_free(p->target_data);
-            p->target_data = NULL;
-            p->flags = flags;
-        } else {
-            /* Using mprotect on a page does not change sticky bits. */
-            p->flags = (p->flags & PAGE_STICKY) | flags;
+
+        for (i = 0; i < n; i++, p++, addr += TARGET_PAGE_SIZE) {
+            /* If the write protection bit is set, then we invalidate
+               the code inside.  */
+            if (!(p->flags & PAGE_WRITE) &&
+                (flags & PAGE_WRITE) &&
+                p->first_tb) {
+                tb_invalidate_phys_page(addr, 0);
+            }
+            if (reset_target_data) {
+                g_free(p->target_data);
+                p->target_data = NULL;
+                p->flags = flags;
+            } else {
+                /* Using mprotect on a page does not change sticky bits. */
+                p->flags = (p->flags & PAGE_STICKY) | flags;
+            }
         }
     }
 }
 
 void page_reset_target_data(target_ulong start, target_ulong end)
 {
-    target_ulong addr, len;
+    target_ulong addr, len, n, i;
 
     /*
      * This function should never be called with addresses outside the
@@ -2332,13 +2387,15 @@ void page_reset_target_data(target_ulong start, target_ulong end)
     start = start & TARGET_PAGE_MASK;
     end = TARGET_PAGE_ALIGN(end);
 
-    for (addr = start, len = end - start;
-         len != 0;
-         len -= TARGET_PAGE_SIZE, addr += TARGET_PAGE_SIZE) {
-        PageDesc *p = page_find_alloc(addr >> TARGET_PAGE_BITS, 1);
+    for (addr = start, len = end - start; len != 0;
+         len -= n << TARGET_PAGE_BITS, addr += n << TARGET_PAGE_BITS) {
+        PageDesc *p = page_find(addr >> TARGET_PAGE_BITS);
 
-        g_free(p->target_data);
-        p->target_data = NULL;
+        n = page_leaf_run(addr >> TARGET_PAGE_BITS, len);
+        for (i = 0; p && i < n; i++, p++) {
+            g_free(p->target_data);
+            p->target_data = NULL;
+        }
     }
 }
 
@@ -2367,6 +2424,7 @@ int page_check_range(target_ulong start, target_ulong len, int flags)
     PageDesc *p;
     target_ulong end;
     target_ulong addr;
+    target_ulong n, i;
 
     /* This function should never be called with addresses outside the
        guest address space.  If this assert fires, it probably indicates
@@ -2387,30 +2445,33 @@ int page_check_range(target_ulong start, target_ulong len, int flags)
     end = TARGET_PAGE_ALIGN(start + len);
     start = start & TARGET_PAGE_MASK;
 
-    for (addr = start, len = end - start;
-         len != 0;
-         len -= TARGET_PAGE_SIZE, addr += TARGET_PAGE_SIZE) {
+    for (addr = start, len = end - start; len != 0;
+         len -= n << TARGET_PAGE_BITS) {
         p = page_find(addr >> TARGET_PAGE_BITS);
         if (!p) {
             return -1;
         }
-        if (!(p->flags & PAGE_VALID)) {
-            return -1;
-        }
 
-        if ((flags & PAGE_READ) && !(p->flags & PAGE_READ)) {
-            return -1;
-        }
-        if (flags & PAGE_WRITE) {
-            if (!(p->flags & PAGE_WRITE_ORG)) {
+        n = page_leaf_run(addr >> TARGET_PAGE_BITS, len);
+        for (i = 0; i < n; i++, p++, addr += TARGET_PAGE_SIZE) {
+            if (!(p->flags & PAGE_VALID)) {
                 return -1;
             }
-            /* unprotect the page if it was put read-only because it
-               contains translated code */
-            if (!(p->flags & PAGE_WRITE)) {
-                if (!page_unprotect(addr, 0)) {
+
+            if ((flags & PAGE_READ) && !(p->flags & PAGE_READ)) {
+                return -1;
+            }
+            if (flags & PAGE_WRITE) {
+                if (!(p->flags & PAGE_WRITE_ORG)) {
                     return -1;
                 }
+                /* unprotect the page if it was put read-only because it
+                   contains translated code */
+                if (!(p->flags & PAGE_WRITE)) {
+                    if (!page_unprotect(addr, 0)) {
+                        return -1;
+                    }
+                }
             }
         }
     }
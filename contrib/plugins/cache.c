@@ -76,10 +76,22 @@ typedef struct {
     int blksize_shift;
     uint64_t set_mask;
     uint64_t tag_mask;
-    uint64_t accesses;
-    uint64_t misses;
 } Cache;
 
+/*
+ * Access and miss counters are kept per vCPU in a scoreboard, so that
+ * they never bounce between host cores. Instruction fetches are counted
+ * by an inline op, without calling into the plugin.
+ */
+typedef struct {
+    uint64_t l1_daccesses;
+    uint64_t l1_dmisses;
+    uint64_t l1_iaccesses;
+    uint64_t l1_imisses;
+    uint64_t l2_accesses;
+    uint64_t l2_misses;
+} CacheStats;
+
 typedef struct {
     char *disas_str;
     const char *symbol;
@@ -105,13 +117,13 @@ static GMutex *l1_dcache_locks;
 static GMutex *l1_icache_locks;
 static GMutex *l2_ucache_locks;
 
-static uint64_t l1_dmem_accesses;
-static uint64_t l1_imem_accesses;
-static uint64_t l1_imisses;
-static uint64_t l1_dmisses;
-
-static uint64_t l2_mem_accesses;
-static uint64_t l2_misses;
+static struct qemu_plugin_scoreboard *stats;
+static qemu_plugin_u64 l1_daccesses;
+static qemu_plugin_u64 l1_dmisses;
+static qemu_plugin_u64 l1_iaccesses;
+static qemu_plugin_u64 l1_imisses;
+static qemu_plugin_u64 l2_accesses;
+static qemu_plugin_u64 l2_misses;
 
 static int pow_of_two(int num)
 {
@@ -264,8 +276,6 @@ static Cache *cache_init(int blksize, int assoc, int cachesize)
     cache->num_sets = cachesize / (blksize * assoc);
     cache->sets = g_new(CacheSet, cache->num_sets);
     cache->blksize_shift = pow_of_two(blksize);
-    cache->accesses = 0;
-    cache->misses = 0;
 
     for (i = 0; i < cache->num_sets; i++) {
         cache->sets[i].blocks = g_new0(CacheBlock, assoc);
@@ -392,7 +402,7 @@ static void vcpu_mem_access(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
     struct qemu_plugin_hwaddr *hwaddr;
     int cache_idx;
     InsnData *insn;
-    bool hit_in_l1;
+    bool hit_in_l1, hit_in_l2;
 
     hwaddr = qemu_plugin_get_hwaddr(info, vaddr);
     if (hwaddr && qemu_plugin_hwaddr_is_io(hwaddr)) {
@@ -404,13 +414,14 @@ static void vcpu_mem_access(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
 
     g_mutex_lock(&l1_dcache_locks[cache_idx]);
     hit_in_l1 = access_cache(l1_dcaches[cache_idx], effective_addr);
+    g_mutex_unlock(&l1_dcache_locks[cache_idx]);
+
+    qemu_plugin_u64_add(l1_daccesses, vcpu_index, 1);
     if (!hit_in_l1) {
         insn = (InsnData *) userdata;
         __atomic_fetch_add(&insn->l1_dmisses, 1, __ATOMIC_SEQ_CST);
-        l1_dcaches[cache_idx]->misses++;
+        qemu_plugin_u64_add(l1_dmisses, vcpu_index, 1);
     }
-    l1_dcaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l1_dcache_locks[cache_idx]);
 
     if (hit_in_l1 || !use_l2) {
         /* No need to access L2 */
@@ -418,13 +429,15 @@ static void vcpu_mem_access(unsigned int vcpu_index, qemu_plugin_meminfo_t info,
     }
 
     g_mutex_lock(&l2_ucache_locks[cache_idx]);
-    if (!access_cache(l2_ucaches[cache_idx], effective_addr)) {
+    hit_in_l2 = access_cache(l2_ucaches[cache_idx], effective_addr);
+    g_mutex_unlock(&l2_ucache_locks[cache_idx]);
+
+    qemu_plugin_u64_add(l2_accesses, vcpu_index, 1);
+    if (!hit_in_l2) {
         insn = (InsnData *) userdata;
         __atomic_fetch_add(&insn->l2_misses, 1, __ATOMIC_SEQ_CST);
-        l2_ucaches[cache_idx]->misses++;
+        qemu_plugin_u64_add(l2_misses, vcpu_index, 1);
     }
-    l2_ucaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l2_ucache_locks[cache_idx]);
 }
 
 static void vcpu_insn_exec(unsigned int vcpu_index, void *userdata)
@@ -432,20 +445,20 @@ static void vcpu_insn_exec(unsigned int vcpu_index, void *userdata)
     uint64_t insn_addr;
     InsnData *insn;
     int cache_idx;
-    bool hit_in_l1;
+    bool hit_in_l1, hit_in_l2;
 
     insn_addr = ((InsnData *) userdata)->addr;
 
     cache_idx = vcpu_index % cores;
     g_mutex_lock(&l1_icache_locks[cache_idx]);
     hit_in_l1 = access_cache(l1_icaches[cache_idx], insn_addr);
+    g_mutex_unlock(&l1_icache_locks[cache_idx]);
+
     if (!hit_in_l1) {
         insn = (InsnData *) userdata;
         __atomic_fetch_add(&insn->l1_imisses, 1, __ATOMIC_SEQ_CST);
-        l1_icaches[cache_idx]->misses++;
+        qemu_plugin_u64_add(l1_imisses, vcpu_index, 1);
     }
-    l1_icaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l1_icache_locks[cache_idx]);
 
     if (hit_in_l1 || !use_l2) {
         /* No need to access L2 */
@@ -453,13 +466,15 @@ static void vcpu_insn_exec(unsigned int vcpu_index, void *userdata)
     }
 
     g_mutex_lock(&l2_ucache_locks[cache_idx]);
-    if (!access_cache(l2_ucaches[cache_idx], insn_addr)) {
+    hit_in_l2 = access_cache(l2_ucaches[cache_idx], insn_addr);
+    g_mutex_unlock(&l2_ucache_locks[cache_idx]);
+
+    qemu_plugin_u64_add(l2_accesses, vcpu_index, 1);
+    if (!hit_in_l2) {
         insn = (InsnData *) userdata;
         __atomic_fetch_add(&insn->l2_misses, 1, __ATOMIC_SEQ_CST);
-        l2_ucaches[cache_idx]->misses++;
+        qemu_plugin_u64_add(l2_misses, vcpu_index, 1);
     }
-    l2_ucaches[cache_idx]->accesses++;
-    g_mutex_unlock(&l2_ucache_locks[cache_idx]);
 }
 
 static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
@@ -502,6 +517,9 @@ static void vcpu_tb_trans(qemu_plugin_id_t id, struct qemu_plugin_tb *tb)
 
         qemu_plugin_register_vcpu_insn_exec_cb(insn, vcpu_insn_exec,
                                                QEMU_PLUGIN_CB_NO_REGS, data);
+
+        qemu_plugin_register_vcpu_insn_exec_inline_per_vcpu(
+            insn, QEMU_PLUGIN_INLINE_ADD_U64, l1_iaccesses, 1);
     }
 }
 
@@ -565,21 +583,19 @@ static void append_stats_line(GString *line, uint64_t l1_daccess,
     g_string_append(line, "\n");
 }
 
-static void sum_stats(void)
+/* Sum the counters of all vCPUs sharing the caches of core @core */
+static void core_stats(int core, CacheStats *sum)
 {
-    int i;
+    int vcpu;
 
-    g_assert(cores > 1);
-    for (i = 0; i < cores; i++) {
-        l1_imisses += l1_icaches[i]->misses;
-        l1_dmisses += l1_dcaches[i]->misses;
-        l1_imem_accesses += l1_icaches[i]->accesses;
-        l1_dmem_accesses += l1_dcaches[i]->accesses;
-
-        if (use_l2) {
-            l2_misses += l2_ucaches[i]->misses;
-            l2_mem_accesses += l2_ucaches[i]->accesses;
-        }
+    *sum = (CacheStats) { 0 };
+    for (vcpu = core; vcpu < qemu_plugin_num_vcpus(); vcpu += cores) {
+        sum->l1_daccesses += qemu_plugin_u64_get(l1_daccesses, vcpu);
+        sum->l1_dmisses += qemu_plugin_u64_get(l1_dmisses, vcpu);
+        sum->l1_iaccesses += qemu_plugin_u64_get(l1_iaccesses, vcpu);
+        sum->l1_imisses += qemu_plugin_u64_get(l1_imisses, vcpu);
+        sum->l2_accesses += qemu_plugin_u64_get(l2_accesses, vcpu);
+        sum->l2_misses += qemu_plugin_u64_get(l2_misses, vcpu);
     }
 }
 
@@ -610,7 +626,7 @@ static int l2_cmp(gconstpointer a, gconstpointer b)
 static void log_stats(void)
 {
     int i;
-    Cache *icache, *dcache, *l2_cache;
+    CacheStats core;
 
     g_autoptr(GString) rep = g_string_new("core #, data accesses, data misses,"
                                           " dmiss rate, insn accesses,"
@@ -624,21 +640,20 @@ static void log_stats(void)
 
     for (i = 0; i < cores; i++) {
         g_string_append_printf(rep, "%-8d", i);
-        dcache = l1_dcaches[i];
-        icache = l1_icaches[i];
-        l2_cache = use_l2 ? l2_ucaches[i] : NULL;
-        append_stats_line(rep, dcache->accesses, dcache->misses,
-                icache->accesses, icache->misses,
-                l2_cache ? l2_cache->accesses : 0,
-                l2_cache ? l2_cache->misses : 0);
+        core_stats(i, &core);
+        append_stats_line(rep, core.l1_daccesses, core.l1_dmisses,
+                core.l1_iaccesses, core.l1_imisses,
+                core.l2_accesses, core.l2_misses);
     }
 
     if (cores > 1) {
-        sum_stats();
         g_string_append_printf(rep, "%-8s", "sum");
-        append_stats_line(rep, l1_dmem_accesses, l1_dmisses,
-                l1_imem_accesses, l1_imisses,
-                l2_cache ? l2_mem_accesses : 0, l2_cache ? l2_misses : 0);
+        append_stats_line(rep, qemu_plugin_u64_sum(l1_daccesses),
+                qemu_plugin_u64_sum(l1_dmisses),
+                qemu_plugin_u64_sum(l1_iaccesses),
+                qemu_plugin_u64_sum(l1_imisses),
+                qemu_plugin_u64_sum(l2_accesses),
+                qemu_plugin_u64_sum(l2_misses));
     }
 
     g_string_append(rep, "\n");
@@ -718,6 +733,7 @@ static void plugin_exit(qemu_plugin_id_t id, void *p)
     }
 
     g_hash_table_destroy(miss_ht);
+    qemu_plugin_scoreboard_free(stats);
 }
 
 static void policy_init(void)
@@ -847,6 +863,20 @@ int qemu_plugin_install(qemu_plugin_id_t id, const qemu_info_t *info,
         return -1;
     }
 
+    stats = qemu_plugin_scoreboard_new(sizeof(CacheStats));
+    l1_daccesses = qemu_plugin_scoreboard_u64_in_struct(stats, CacheStats,
+                                                        l1_daccesses);
+    l1_dmisses = qemu_plugin_scoreboard_u64_in_struct(stats, CacheStats,
+                                                      l1_dmisses);
+    l1_iaccesses = qemu_plugin_scoreboard_u64_in_struct(stats, CacheStats,
+                                                        l1_iaccesses);
+    l1_imisses = qemu_plugin_scoreboard_u64_in_struct(stats, CacheStats,
+                                                      l1_imisses);
+    l2_accesses = qemu_plugin_scoreboard_u64_in_struct(stats, CacheStats,
+                                                       l2_accesses);
+    l2_misses = qemu_plugin_scoreboard_u64_in_struct(stats, CacheStats,
+                                                     l2_misses);
+
     l1_dcache_locks = g_new0(GMutex, cores);
     l1_icache_locks = g_new0(GMutex, cores);
     l2_ucache_locks = use_l2 ? g_new0(GMutex, cores) : NULL;
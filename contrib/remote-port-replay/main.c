@@ -0,0 +1,425 @@
+/*
+ * Remote-port capture replay.
+ *
+ * Plays back a capture recorded with the remote-port "capture" property
+ * over a unix or TCP socket, standing in either for the peer (to drive QEMU
+ * without the RTL simulator) or for QEMU (to drive a peer). Packets of
+ * the emulated side are sent as recorded, packets of the other side are
+ * waited for and checked against the capture.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+
+#include "hw/remote-port-proto.h"
+#include "hw/remote-port-capture.h"
+
+#define RP_HDR_SIZE sizeof(struct rp_pkt_hdr)
+#define RP_HDR_LEN_OFFSET offsetof(struct rp_pkt_hdr, len)
+#define RP_HDR_ID_OFFSET offsetof(struct rp_pkt_hdr, id)
+
+typedef struct ReplayArgs {
+    bool verbose;
+    bool timed;
+    bool listen;
+    bool as_qemu;
+    const char *capture;
+    const char *sock_path;
+} ReplayArgs;
+
+typedef struct ReplayStats {
+    uint64_t sent;
+    uint64_t sent_bytes;
+    uint64_t received;
+    uint64_t received_bytes;
+    uint64_t mismatches;
+    /* Time spent waiting for the other side, in ns.  */
+    uint64_t wait_ns;
+    uint64_t max_wait_ns;
+} ReplayStats;
+
+static void
+replay_usage(const char *name, int code)
+{
+    fprintf(stderr, "%s [opts] <capture> <unix_sock_path|host:port>\n",
+            name);
+    fprintf(stderr, "  -h: show this help\n");
+    fprintf(stderr, "  -v: verbose mode, report every mismatch\n");
+    fprintf(stderr, "  -q: stand in for QEMU instead of for the peer\n");
+    fprintf(stderr, "  -l: listen on the socket instead of connecting\n");
+    fprintf(stderr, "  -t: honour the recorded host timing between packets\n"
+                    "      (default: send as fast as possible)\n");
+    exit(code);
+}
+
+static void
+replay_parse_args(ReplayArgs *args, int argc, char *argv[])
+{
+    int c;
+
+    while ((c = getopt(argc, argv, "hvqlt")) != -1) {
+        switch (c) {
+        case 'h':
+            replay_usage(argv[0], 0);
+            break;
+        case 'v':
+            args->verbose = true;
+            break;
+        case 'q':
+            args->as_qemu = true;
+            break;
+        case 'l':
+            args->listen = true;
+            break;
+        case 't':
+            args->timed = true;
+            break;
+        default:
+            replay_usage(argv[0], 1);
+            break;
+        }
+    }
+
+    if (argc - optind != 2) {
+        replay_usage(argv[0], 1);
+    }
+    args->capture = argv[optind];
+    args->sock_path = argv[optind + 1];
+}
+
+static uint64_t
+replay_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+static int
+replay_open_unix(const ReplayArgs *args, const char *path)
+{
+    struct sockaddr_un addr = { .sun_family = AF_UNIX };
+    int fd, sk;
+
+    if (strlen(path) >= sizeof(addr.sun_path)) {
+        fprintf(stderr, "socket path too long: %s\n", path);
+        return -1;
+    }
+    strcpy(addr.sun_path, path);
+
+    fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        perror("socket");
+        return -1;
+    }
+
+    if (!args->listen) {
+        if (connect(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+            perror("connect");
+            close(fd);
+            return -1;
+        }
+        return fd;
+    }
+
+    unlink(path);
+    if (bind(fd, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        listen(fd, 1) < 0) {
+        perror("bind");
+        close(fd);
+        return -1;
+    }
+    sk = accept(fd, NULL, NULL);
+    if (sk < 0) {
+        perror("accept");
+    }
+    close(fd);
+    return sk;
+}
+
+static int
+replay_open_tcp(const ReplayArgs *args, const char *host, const char *port)
+{
+    struct addrinfo hints = {
+        .ai_family = AF_UNSPEC,
+        .ai_socktype = SOCK_STREAM,
+        .ai_flags = args->listen ? AI_PASSIVE : 0,
+    };
+    struct addrinfo *res, *ai;
+    int fd = -1, sk, one = 1, r;
+
+    r = getaddrinfo(*host ? host : NULL, port, &hints, &res);
+    if (r) {
+        fprintf(stderr, "%s:%s: %s\n", host, port, gai_strerror(r));
+        return -1;
+    }
+
+    for (ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype, ai->ai_protocol);
+        if (fd < 0) {
+            continue;
+        }
+        if (args->listen) {
+            setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+            if (!bind(fd, ai->ai_addr, ai->ai_addrlen) && !listen(fd, 1)) {
+                break;
+            }
+        } else if (!connect(fd, ai->ai_addr, ai->ai_addrlen)) {
+            break;
+        }
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        perror(args->listen ? "bind" : "connect");
+        return -1;
+    }
+
+    if (args->listen) {
+        sk = accept(fd, NULL, NULL);
+        if (sk < 0) {
+            perror("accept");
+        }
+        close(fd);
+        fd = sk;
+    }
+    if (fd >= 0) {
+        /* Packets are small and latency bound, don't let Nagle hold them.  */
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    }
+    return fd;
+}
+
+/*
+ * Accepts the same unix:path and host:port forms as the remote-port
+ * "socket" property. Anything else is taken as a unix socket path.
+ */
+static int
+replay_open_socket(const ReplayArgs *args)
+{
+    g_autofree char *host = NULL;
+    const char *path = args->sock_path;
+    const char *colon;
+
+    if (g_str_has_prefix(path, "unix:")) {
+        return replay_open_unix(args, path + strlen("unix:"));
+    }
+    if (g_str_has_prefix(path, "tcp:")) {
+        path += strlen("tcp:");
+    } else if (path[0] == '/' || path[0] == '.') {
+        return replay_open_unix(args, path);
+    }
+
+    colon = strrchr(path, ':');
+    if (!colon) {
+        return replay_open_unix(args, path);
+    }
+    host = g_strndup(path, colon - path);
+    return replay_open_tcp(args, host, colon + 1);
+}
+
+static bool
+replay_xfer(int fd, void *buf, size_t len, bool send)
+{
+    uint8_t *p = buf;
+
+    while (len) {
+        ssize_t r = send ? write(fd, p, len) : read(fd, p, len);
+
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return false;
+        }
+        p += r;
+        len -= r;
+    }
+    return true;
+}
+
+/*
+ * Compare whole packets except for the id and the timestamp, which may
+ * legitimately differ: the side running live picks its own ids and
+ * stamps packets with its own clock. Every command but the handshake
+ * ones starts its payload with the timestamp.
+ */
+static bool
+replay_pkt_matches(const uint8_t *a, const uint8_t *b, size_t len)
+{
+    size_t payload = RP_HDR_SIZE;
+
+    if (len < RP_HDR_SIZE) {
+        return !memcmp(a, b, len);
+    }
+    if (memcmp(a, b, RP_HDR_ID_OFFSET) ||
+        memcmp(a + RP_HDR_ID_OFFSET + 4, b + RP_HDR_ID_OFFSET + 4,
+               RP_HDR_SIZE - RP_HDR_ID_OFFSET - 4)) {
+        return false;
+    }
+
+    switch (ldl_be_p(a)) {
+    case RP_CMD_nop:
+    case RP_CMD_hello:
+    case RP_CMD_cfg:
+        break;
+    default:
+        if (len >= payload + sizeof(uint64_t)) {
+            payload += sizeof(uint64_t);
+        }
+        break;
+    }
+    return !memcmp(a + payload, b + payload, len - payload);
+}
+
+static int
+replay_run(const ReplayArgs *args, FILE *f, int fd, ReplayStats *st)
+{
+    g_autofree uint8_t *data = NULL;
+    g_autofree uint8_t *buf = NULL;
+    size_t size = 0, buf_size = 0;
+    uint64_t first_ns = 0, start_ns = replay_now();
+    uint64_t rec_nr;
+    RemotePortCaptureRecord rec;
+
+    for (rec_nr = 0; fread(&rec, sizeof(rec), 1, f) == 1; rec_nr++) {
+        uint32_t len = le32_to_cpu(rec.len);
+        uint64_t host_ns = le64_to_cpu(rec.host_ns);
+        bool ours = (rec.dir == RP_CAPTURE_DIR_IN) != args->as_qemu;
+
+        if (len > size) {
+            size = len;
+            data = g_realloc(data, size);
+        }
+        if (len && fread(data, len, 1, f) != 1) {
+            fprintf(stderr, "truncated capture at record %" PRIu64 "\n",
+                    rec_nr);
+            return 1;
+        }
+        if (!rec_nr) {
+            first_ns = host_ns;
+        }
+
+        if (ours) {
+            if (args->timed) {
+                uint64_t due = start_ns + (host_ns - first_ns);
+                uint64_t now = replay_now();
+
+                if (due > now) {
+                    g_usleep((due - now) / 1000);
+                }
+            }
+            if (!replay_xfer(fd, data, len, true)) {
+                fprintf(stderr, "disconnected at record %" PRIu64 "\n",
+                        rec_nr);
+                return 1;
+            }
+            st->sent++;
+            st->sent_bytes += len;
+        } else {
+            uint64_t t0 = replay_now(), wait;
+            size_t rlen;
+
+            /* Size the packet by its own header, it may not be the one
+               we expect.  */
+            if (buf_size < RP_HDR_SIZE) {
+                buf_size = RP_HDR_SIZE;
+                buf = g_realloc(buf, buf_size);
+            }
+            if (!replay_xfer(fd, buf, RP_HDR_SIZE, false)) {
+                fprintf(stderr, "disconnected at record %" PRIu64 "\n",
+                        rec_nr);
+                return 1;
+            }
+            rlen = RP_HDR_SIZE + (size_t)ldl_be_p(buf + RP_HDR_LEN_OFFSET);
+            if (rlen > buf_size) {
+                buf_size = rlen;
+                buf = g_realloc(buf, buf_size);
+            }
+            if (!replay_xfer(fd, buf + RP_HDR_SIZE, rlen - RP_HDR_SIZE,
+                             false)) {
+                fprintf(stderr, "disconnected at record %" PRIu64 "\n",
+                        rec_nr);
+                return 1;
+            }
+            wait = replay_now() - t0;
+            st->wait_ns += wait;
+            st->max_wait_ns = MAX(st->max_wait_ns, wait);
+            st->received++;
+            st->received_bytes += rlen;
+
+            if (rlen != len || !replay_pkt_matches(buf, data, len)) {
+                st->mismatches++;
+                if (args->verbose) {
+                    fprintf(stderr, "record %" PRIu64 ": unexpected packet\n",
+                            rec_nr);
+                }
+            }
+        }
+    }
+    return 0;
+}
+
+int
+main(int argc, char *argv[])
+{
+    ReplayArgs args = { 0 };
+    ReplayStats st = { 0 };
+    RemotePortCaptureHeader hdr;
+    uint64_t start_ns, elapsed_ns;
+    FILE *f;
+    int fd, ret;
+
+    replay_parse_args(&args, argc, argv);
+
+    f = fopen(args.capture, "rb");
+    if (!f) {
+        perror(args.capture);
+        return 1;
+    }
+    if (fread(&hdr, sizeof(hdr), 1, f) != 1 ||
+        memcmp(hdr.magic, RP_CAPTURE_MAGIC, sizeof(hdr.magic)) ||
+        le32_to_cpu(hdr.version) != RP_CAPTURE_VERSION) {
+        fprintf(stderr, "%s: not a remote-port capture\n", args.capture);
+        fclose(f);
+        return 1;
+    }
+
+    fd = replay_open_socket(&args);
+    if (fd < 0) {
+        fclose(f);
+        return 1;
+    }
+
+    start_ns = replay_now();
+    ret = replay_run(&args, f, fd, &st);
+    elapsed_ns = MAX(replay_now() - start_ns, 1);
+
+    printf("sent:       %" PRIu64 " packets, %" PRIu64 " bytes\n",
+           st.sent, st.sent_bytes);
+    printf("received:   %" PRIu64 " packets, %" PRIu64 " bytes, "
+           "%" PRIu64 " mismatches\n",
+           st.received, st.received_bytes, st.mismatches);
+    printf("elapsed:    %" PRIu64 " us, %.0f packets/s\n",
+           elapsed_ns / 1000,
+           (st.sent + st.received) * 1e9 / elapsed_ns);
+    if (st.received) {
+        printf("wait:       avg %" PRIu64 " ns, max %" PRIu64 " ns\n",
+               st.wait_ns / st.received, st.max_wait_ns);
+    }
+
+    close(fd);
+    fclose(f);
+    return ret;
+}
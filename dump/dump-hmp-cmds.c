@@ -20,6 +20,7 @@ void hmp_dump_guest_memory(Monitor *mon, const QDict *qdict)
     bool zlib = qdict_get_try_bool(qdict, "zlib", false);
     bool lzo = qdict_get_try_bool(qdict, "lzo", false);
     bool snappy = qdict_get_try_bool(qdict, "snappy", false);
+    bool zstd = qdict_get_try_bool(qdict, "zstd", false);
     const char *file = qdict_get_str(qdict, "filename");
     bool has_begin = qdict_haskey(qdict, "begin");
     bool has_length = qdict_haskey(qdict, "length");
@@ -30,8 +31,8 @@ void hmp_dump_guest_memory(Monitor *mon, const QDict *qdict)
     enum DumpGuestMemoryFormat dump_format = DUMP_GUEST_MEMORY_FORMAT_ELF;
     char *prot;
 
-    if (zlib + lzo + snappy + win_dmp > 1) {
-        error_setg(&err, "only one of '-z|-l|-s|-w' can be set");
+    if (zlib + lzo + snappy + zstd + win_dmp > 1) {
+        error_setg(&err, "only one of '-z|-l|-s|-Z|-w' can be set");
         hmp_handle_error(mon, err);
         return;
     }
@@ -52,6 +53,10 @@ void hmp_dump_guest_memory(Monitor *mon, const QDict *qdict)
         dump_format = DUMP_GUEST_MEMORY_FORMAT_KDUMP_SNAPPY;
     }
 
+    if (zstd) {
+        dump_format = DUMP_GUEST_MEMORY_FORMAT_KDUMP_ZSTD;
+    }
+
     if (has_begin) {
         begin = qdict_get_int(qdict, "begin");
     }
@@ -83,6 +88,10 @@ void hmp_info_dump(Monitor *mon, const QDict *qdict)
         percent = 100.0 * result->completed / result->total;
         monitor_printf(mon, "Finished: %.2f %%\n", percent);
     }
+    if (result->has_throughput) {
+        monitor_printf(mon, "Elapsed: %" PRId64 " ms, %" PRId64 " MB/s\n",
+                       result->elapsed, result->throughput >> 20);
+    }
 
     qapi_free_DumpQueryResult(result);
 }
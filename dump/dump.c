@@ -27,6 +27,7 @@
 #include "qapi/qmp/qerror.h"
 #include "qemu/error-report.h"
 #include "qemu/main-loop.h"
+#include "qemu/timer.h"
 #include "hw/misc/vmcoreinfo.h"
 #include "migration/blocker.h"
 
@@ -41,12 +42,24 @@
 #ifdef CONFIG_SNAPPY
 #include <snappy-c.h>
 #endif
+#ifdef CONFIG_ZSTD
+#include <zstd.h>
+#endif
 #ifndef ELF_MACHINE_UNAME
 #define ELF_MACHINE_UNAME "Unknown"
 #endif
 
 #define MAX_GUEST_NOTE_SIZE (1 << 20) /* 1MB should be enough */
 
+/*
+ * Pages of the kdump-compressed format are checked for zeroes and
+ * compressed by a pool of up to DUMP_MAX_THREADS helper threads, plus the
+ * dump thread itself. They go through a ring of DUMP_SLOTS_PER_THREAD
+ * slots per compressor, and the dump thread writes them out in pfn order.
+ */
+#define DUMP_MAX_THREADS        16
+#define DUMP_SLOTS_PER_THREAD   64
+
 static Error *dump_migration_blocker;
 
 #define ELF_NOTE_SIZE(hdr_size, name_size, desc_size)   \
@@ -825,6 +838,11 @@ static void create_header32(DumpState *s, Error **errp)
     if (s->flag_compress & DUMP_DH_COMPRESSED_SNAPPY) {
         status |= DUMP_DH_COMPRESSED_SNAPPY;
     }
+#endif
+#ifdef CONFIG_ZSTD
+    if (s->flag_compress & DUMP_DH_COMPRESSED_ZSTD) {
+        status |= DUMP_DH_COMPRESSED_ZSTD;
+    }
 #endif
     dh->status = cpu_to_dump32(s, status);
 
@@ -936,6 +954,11 @@ static void create_header64(DumpState *s, Error **errp)
     if (s->flag_compress & DUMP_DH_COMPRESSED_SNAPPY) {
         status |= DUMP_DH_COMPRESSED_SNAPPY;
     }
+#endif
+#ifdef CONFIG_ZSTD
+    if (s->flag_compress & DUMP_DH_COMPRESSED_ZSTD) {
+        status |= DUMP_DH_COMPRESSED_ZSTD;
+    }
 #endif
     dh->status = cpu_to_dump32(s, status);
 
@@ -1262,24 +1285,256 @@ static size_t get_len_buf_out(size_t page_size, uint32_t flag_compress)
     case DUMP_DH_COMPRESSED_SNAPPY:
         return snappy_max_compressed_length(page_size);
 #endif
+
+#ifdef CONFIG_ZSTD
+    case DUMP_DH_COMPRESSED_ZSTD:
+        return ZSTD_compressBound(page_size);
+#endif
     }
     return 0;
 }
 
+typedef struct DumpPageSlot {
+    uint8_t *buf;           /* the guest page */
+    uint8_t *out;           /* the compressed page */
+    size_t size_out;        /* size of the page data to write */
+    uint32_t flags;         /* compression format of out, 0 for plaintext */
+    bool zero;              /* the page only has zeroes */
+    bool done;              /* the fields above are valid */
+} DumpPageSlot;
+
+typedef struct DumpCompressPool DumpCompressPool;
+
+typedef struct DumpCompressor {
+    DumpCompressPool *pool;
+    QemuThread thread;
+#ifdef CONFIG_LZO
+    lzo_bytep wrkmem;
+#endif
+#ifdef CONFIG_ZSTD
+    ZSTD_CCtx *zstd;
+#endif
+} DumpCompressor;
+
+struct DumpCompressPool {
+    DumpState *s;
+    size_t len_buf_out;
+
+    QemuMutex lock;
+    QemuCond work_cond;         /* pages were queued, or quit is set */
+    QemuCond done_cond;         /* a page was compressed */
+    bool quit;
+
+    /* pages [claimed, queued) wait for a compressor */
+    uint64_t queued;
+    uint64_t claimed;
+    DumpPageSlot *slots;
+    unsigned int nr_slots;
+
+    /* nr_threads helpers, followed by the dump thread's compressor */
+    DumpCompressor *compressors;
+    unsigned int nr_threads;
+};
+
+/*
+ * Fill in the result fields of @slot. When compression fails to work or
+ * doesn't make the page smaller, we fall back to save in plaintext.
+ */
+static void dump_compress_page(DumpCompressor *c, DumpPageSlot *slot)
+{
+    DumpState *s = c->pool->s;
+    size_t page_size = s->dump_info.page_size;
+    size_t size_out = c->pool->len_buf_out;
+    uLongf zlib_size_out = size_out;
+    bool ok = false;
+
+    slot->zero = buffer_is_zero(slot->buf, page_size);
+    if (slot->zero) {
+        return;
+    }
+
+    switch (s->flag_compress) {
+    case DUMP_DH_COMPRESSED_ZLIB:
+        ok = compress2(slot->out, &zlib_size_out, slot->buf, page_size,
+                       Z_BEST_SPEED) == Z_OK;
+        size_out = zlib_size_out;
+        break;
+
+#ifdef CONFIG_LZO
+    case DUMP_DH_COMPRESSED_LZO:
+        ok = lzo1x_1_compress(slot->buf, page_size, slot->out,
+                              (lzo_uint *)&size_out, c->wrkmem) == LZO_E_OK;
+        break;
+#endif
+
+#ifdef CONFIG_SNAPPY
+    case DUMP_DH_COMPRESSED_SNAPPY:
+        ok = snappy_compress((char *)slot->buf, page_size,
+                             (char *)slot->out, &size_out) == SNAPPY_OK;
+        break;
+#endif
+
+#ifdef CONFIG_ZSTD
+    case DUMP_DH_COMPRESSED_ZSTD:
+        size_out = ZSTD_compressCCtx(c->zstd, slot->out, size_out,
+                                     slot->buf, page_size, 1);
+        ok = !ZSTD_isError(size_out);
+        break;
+#endif
+    }
+
+    if (ok && size_out < page_size) {
+        slot->flags = s->flag_compress;
+        slot->size_out = size_out;
+    } else {
+        slot->flags = 0;
+        slot->size_out = page_size;
+    }
+}
+
+/* Called with the pool lock held, which is dropped while compressing.  */
+static void dump_compress_next(DumpCompressor *c)
+{
+    DumpCompressPool *p = c->pool;
+    DumpPageSlot *slot = &p->slots[p->claimed++ % p->nr_slots];
+
+    qemu_mutex_unlock(&p->lock);
+    dump_compress_page(c, slot);
+    qemu_mutex_lock(&p->lock);
+    slot->done = true;
+}
+
+static void *dump_compress_thread(void *opaque)
+{
+    DumpCompressor *c = opaque;
+    DumpCompressPool *p = c->pool;
+
+    qemu_mutex_lock(&p->lock);
+    while (!p->quit) {
+        if (p->claimed == p->queued) {
+            qemu_cond_wait(&p->work_cond, &p->lock);
+            continue;
+        }
+        dump_compress_next(c);
+        /* only the dump thread waits for results */
+        qemu_cond_signal(&p->done_cond);
+    }
+    qemu_mutex_unlock(&p->lock);
+    return NULL;
+}
+
+static DumpCompressPool *dump_compress_pool_new(DumpState *s,
+                                                size_t len_buf_out)
+{
+    DumpCompressPool *p = g_new0(DumpCompressPool, 1);
+    long nr_cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    unsigned int i;
+
+    p->s = s;
+    p->len_buf_out = len_buf_out;
+    qemu_mutex_init(&p->lock);
+    qemu_cond_init(&p->work_cond);
+    qemu_cond_init(&p->done_cond);
+
+    /* the dump thread compresses too, it takes one of the host's cpus */
+    p->nr_threads = MIN(MAX(nr_cpus, 1) - 1, DUMP_MAX_THREADS);
+    p->nr_slots = (p->nr_threads + 1) * DUMP_SLOTS_PER_THREAD;
+    p->slots = g_new0(DumpPageSlot, p->nr_slots);
+    for (i = 0; i < p->nr_slots; i++) {
+        p->slots[i].out = g_malloc(len_buf_out);
+    }
+
+    p->compressors = g_new0(DumpCompressor, p->nr_threads + 1);
+    for (i = 0; i <= p->nr_threads; i++) {
+        DumpCompressor *c = &p->compressors[i];
+
+        c->pool = p;
+#ifdef CONFIG_LZO
+        c->wrkmem = g_malloc(LZO1X_1_MEM_COMPRESS);
+#endif
+#ifdef CONFIG_ZSTD
+        c->zstd = ZSTD_createCCtx();
+#endif
+        if (i < p->nr_threads) {
+            qemu_thread_create(&c->thread, "dump_compress",
+                               dump_compress_thread, c,
+                               QEMU_THREAD_JOINABLE);
+        }
+    }
+    return p;
+}
+
+static void dump_compress_pool_free(DumpCompressPool *p)
+{
+    unsigned int i;
+
+    qemu_mutex_lock(&p->lock);
+    p->quit = true;
+    qemu_cond_broadcast(&p->work_cond);
+    qemu_mutex_unlock(&p->lock);
+
+    for (i = 0; i <= p->nr_threads; i++) {
+        DumpCompressor *c = &p->compressors[i];
+
+        if (i < p->nr_threads) {
+            qemu_thread_join(&c->thread);
+        }
+#ifdef CONFIG_LZO
+        g_free(c->wrkmem);
+#endif
+#ifdef CONFIG_ZSTD
+        ZSTD_freeCCtx(c->zstd);
+#endif
+    }
+    for (i = 0; i < p->nr_slots; i++) {
+        g_free(p->slots[i].out);
+    }
+    g_free(p->compressors);
+    g_free(p->slots);
+    qemu_cond_destroy(&p->done_cond);
+    qemu_cond_destroy(&p->work_cond);
+    qemu_mutex_destroy(&p->lock);
+    g_free(p);
+}
+
+/* Make the pages of the ring up to @queued available to compressors.  */
+static void dump_compress_queue(DumpCompressPool *p, uint64_t queued)
+{
+    qemu_mutex_lock(&p->lock);
+    p->queued = queued;
+    qemu_cond_broadcast(&p->work_cond);
+    qemu_mutex_unlock(&p->lock);
+}
+
+/* Wait until @slot is compressed, helping with the queued pages meanwhile. */
+static void dump_compress_wait(DumpCompressPool *p, DumpPageSlot *slot)
+{
+    DumpCompressor *self = &p->compressors[p->nr_threads];
+
+    qemu_mutex_lock(&p->lock);
+    while (!slot->done) {
+        if (p->claimed != p->queued) {
+            dump_compress_next(self);
+        } else {
+            qemu_cond_wait(&p->done_cond, &p->lock);
+        }
+    }
+    qemu_mutex_unlock(&p->lock);
+}
+
 static void write_dump_pages(DumpState *s, Error **errp)
 {
     int ret = 0;
     DataCache page_desc, page_data;
-    size_t len_buf_out, size_out;
-#ifdef CONFIG_LZO
-    lzo_bytep wrkmem = NULL;
-#endif
-    uint8_t *buf_out = NULL;
+    size_t len_buf_out;
+    DumpCompressPool *pool;
+    DumpPageSlot *slot;
     off_t offset_desc, offset_data;
     PageDescriptor pd, pd_zero;
     uint8_t *buf;
     GuestPhysBlock *block_iter = NULL;
-    uint64_t pfn_iter;
+    uint64_t pfn_iter, queued = 0, written = 0;
+    bool more;
 
     /* get offset of page_desc and page_data in dump file */
     offset_desc = s->offset_page;
@@ -1288,15 +1543,11 @@ static void write_dump_pages(DumpState *s, Error **errp)
     prepare_data_cache(&page_desc, s, offset_desc);
     prepare_data_cache(&page_data, s, offset_data);
 
-    /* prepare buffer to store compressed data */
+    /* prepare buffers to store compressed data */
     len_buf_out = get_len_buf_out(s->dump_info.page_size, s->flag_compress);
     assert(len_buf_out != 0);
 
-#ifdef CONFIG_LZO
-    wrkmem = g_malloc(LZO1X_1_MEM_COMPRESS);
-#endif
-
-    buf_out = g_malloc(len_buf_out);
+    pool = dump_compress_pool_new(s, len_buf_out);
 
     /*
      * init zero page's page_desc and page_data, because every zero page
@@ -1320,9 +1571,26 @@ static void write_dump_pages(DumpState *s, Error **errp)
      * dump memory to vmcore page by page. zero page will all be resided in the
      * first page of page section
      */
-    while (get_next_page(&block_iter, &pfn_iter, &buf, s)) {
-        /* check zero page */
-        if (buffer_is_zero(buf, s->dump_info.page_size)) {
+    more = get_next_page(&block_iter, &pfn_iter, &buf, s);
+    while (more || written < queued) {
+        /*
+         * refill the ring once half of it is written, so that the
+         * compressors don't run dry while we write
+         */
+        if (more && queued - written <= pool->nr_slots / 2) {
+            while (more && queued - written < pool->nr_slots) {
+                slot = &pool->slots[queued++ % pool->nr_slots];
+                slot->buf = buf;
+                slot->done = false;
+                more = get_next_page(&block_iter, &pfn_iter, &buf, s);
+            }
+            dump_compress_queue(pool, queued);
+        }
+
+        slot = &pool->slots[written++ % pool->nr_slots];
+        dump_compress_wait(pool, slot);
+
+        if (slot->zero) {
             ret = write_cache(&page_desc, &pd_zero, sizeof(PageDescriptor),
                               false);
             if (ret < 0) {
@@ -1332,77 +1600,24 @@ static void write_dump_pages(DumpState *s, Error **errp)
         } else {
             /*
              * not zero page, then:
-             * 1. compress the page
-             * 2. write the compressed page into the cache of page_data
-             * 3. get page desc of the compressed page and write it into the
+             * 1. write the compressed page, or the page itself when it
+             *    couldn't be compressed, into the cache of page_data
+             * 2. get page desc of the compressed page and write it into the
              *    cache of page_desc
-             *
-             * only one compression format will be used here, for
-             * s->flag_compress is set. But when compression fails to work,
-             * we fall back to save in plaintext.
              */
-             size_out = len_buf_out;
-             if ((s->flag_compress & DUMP_DH_COMPRESSED_ZLIB) &&
-                    (compress2(buf_out, (uLongf *)&size_out, buf,
-                               s->dump_info.page_size, Z_BEST_SPEED) == Z_OK) &&
-                    (size_out < s->dump_info.page_size)) {
-                pd.flags = cpu_to_dump32(s, DUMP_DH_COMPRESSED_ZLIB);
-                pd.size  = cpu_to_dump32(s, size_out);
-
-                ret = write_cache(&page_data, buf_out, size_out, false);
-                if (ret < 0) {
-                    error_setg(errp, "dump: failed to write page data");
-                    goto out;
-                }
-#ifdef CONFIG_LZO
-            } else if ((s->flag_compress & DUMP_DH_COMPRESSED_LZO) &&
-                    (lzo1x_1_compress(buf, s->dump_info.page_size, buf_out,
-                    (lzo_uint *)&size_out, wrkmem) == LZO_E_OK) &&
-                    (size_out < s->dump_info.page_size)) {
-                pd.flags = cpu_to_dump32(s, DUMP_DH_COMPRESSED_LZO);
-                pd.size  = cpu_to_dump32(s, size_out);
-
-                ret = write_cache(&page_data, buf_out, size_out, false);
-                if (ret < 0) {
-                    error_setg(errp, "dump: failed to write page data");
-                    goto out;
-                }
-#endif
-#ifdef CONFIG_SNAPPY
-            } else if ((s->flag_compress & DUMP_DH_COMPRESSED_SNAPPY) &&
-                    (snappy_compress((char *)buf, s->dump_info.page_size,
-                    (char *)buf_out, &size_out) == SNAPPY_OK) &&
-                    (size_out < s->dump_info.page_size)) {
-                pd.flags = cpu_to_dump32(s, DUMP_DH_COMPRESSED_SNAPPY);
-                pd.size  = cpu_to_dump32(s, size_out);
-
-                ret = write_cache(&page_data, buf_out, size_out, false);
-                if (ret < 0) {
-                    error_setg(errp, "dump: failed to write page data");
-                    goto out;
-                }
-#endif
-            } else {
-                /*
-                 * fall back to save in plaintext, size_out should be
-                 * assigned the target's page size
-                 */
-                pd.flags = cpu_to_dump32(s, 0);
-                size_out = s->dump_info.page_size;
-                pd.size = cpu_to_dump32(s, size_out);
-
-                ret = write_cache(&page_data, buf,
-                                  s->dump_info.page_size, false);
-                if (ret < 0) {
-                    error_setg(errp, "dump: failed to write page data");
-                    goto out;
-                }
+            ret = write_cache(&page_data, slot->flags ? slot->out : slot->buf,
+                              slot->size_out, false);
+            if (ret < 0) {
+                error_setg(errp, "dump: failed to write page data");
+                goto out;
             }
 
             /* get and write page desc here */
+            pd.flags = cpu_to_dump32(s, slot->flags);
+            pd.size = cpu_to_dump32(s, slot->size_out);
             pd.page_flags = cpu_to_dump64(s, 0);
             pd.offset = cpu_to_dump64(s, offset_data);
-            offset_data += size_out;
+            offset_data += slot->size_out;
 
             ret = write_cache(&page_desc, &pd, sizeof(PageDescriptor), false);
             if (ret < 0) {
@@ -1425,14 +1640,9 @@ static void write_dump_pages(DumpState *s, Error **errp)
     }
 
 out:
+    dump_compress_pool_free(pool);
     free_data_cache(&page_desc);
     free_data_cache(&page_data);
-
-#ifdef CONFIG_LZO
-    g_free(wrkmem);
-#endif
-
-    g_free(buf_out);
 }
 
 static void create_kdump_vmcore(DumpState *s, Error **errp)
@@ -1618,6 +1828,7 @@ static void dump_init(DumpState *s, int fd, bool has_format,
     s->has_format = has_format;
     s->format = format;
     s->written_size = 0;
+    s->start_time = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
 
     /* kdump-compressed is conflict with paging and filter */
     if (has_format && format != DUMP_GUEST_MEMORY_FORMAT_ELF) {
@@ -1769,6 +1980,10 @@ static void dump_init(DumpState *s, int fd, bool has_format,
             s->flag_compress = DUMP_DH_COMPRESSED_SNAPPY;
             break;
 
+        case DUMP_GUEST_MEMORY_FORMAT_KDUMP_ZSTD:
+            s->flag_compress = DUMP_DH_COMPRESSED_ZSTD;
+            break;
+
         default:
             s->flag_compress = 0;
         }
@@ -1836,6 +2051,8 @@ static void dump_process(DumpState *s, Error **errp)
         create_vmcore(s, errp);
     }
 
+    s->end_time = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
+
     /* make sure status is written after written_size updates */
     smp_wmb();
     qatomic_set(&s->status,
@@ -1868,6 +2085,19 @@ DumpQueryResult *qmp_query_dump(Error **errp)
     smp_rmb();
     result->completed = state->written_size;
     result->total = state->total_size;
+
+    if (result->status != DUMP_STATUS_NONE) {
+        int64_t end = state->end_time;
+
+        if (!end) {
+            end = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
+        }
+        result->has_elapsed = true;
+        result->elapsed = end - state->start_time;
+        result->has_throughput = true;
+        result->throughput = result->elapsed ?
+                             result->completed * 1000 / result->elapsed : 0;
+    }
     return result;
 }
 
@@ -1917,7 +2147,7 @@ void qmp_dump_guest_memory(bool paging, const char *file,
         detach_p = detach;
     }
 
-    /* check whether lzo/snappy is supported */
+    /* check whether lzo/snappy/zstd is supported */
 #ifndef CONFIG_LZO
     if (has_format && format == DUMP_GUEST_MEMORY_FORMAT_KDUMP_LZO) {
         error_setg(errp, "kdump-lzo is not available now");
@@ -1932,6 +2162,13 @@ void qmp_dump_guest_memory(bool paging, const char *file,
     }
 #endif
 
+#ifndef CONFIG_ZSTD
+    if (has_format && format == DUMP_GUEST_MEMORY_FORMAT_KDUMP_ZSTD) {
+        error_setg(errp, "kdump-zstd is not available now");
+        return;
+    }
+#endif
+
 #ifndef TARGET_X86_64
     if (has_format && format == DUMP_GUEST_MEMORY_FORMAT_WIN_DMP) {
         error_setg(errp, "Windows dump is only available for x86-64");
@@ -1982,6 +2219,7 @@ void qmp_dump_guest_memory(bool paging, const char *file,
     dump_init(s, fd, has_format, format, paging, has_begin,
               begin, length, errp);
     if (*errp) {
+        s->end_time = qemu_clock_get_ms(QEMU_CLOCK_REALTIME);
         qatomic_set(&s->status, DUMP_STATUS_FAILED);
         return;
     }
@@ -2019,6 +2257,11 @@ DumpGuestMemoryCapability *qmp_query_dump_guest_memory_capability(Error **errp)
     QAPI_LIST_APPEND(tail, DUMP_GUEST_MEMORY_FORMAT_KDUMP_SNAPPY);
 #endif
 
+    /* add new item if kdump-zstd is available */
+#ifdef CONFIG_ZSTD
+    QAPI_LIST_APPEND(tail, DUMP_GUEST_MEMORY_FORMAT_KDUMP_ZSTD);
+#endif
+
     /* Windows dump is available only if target is x86_64 */
 #ifdef TARGET_X86_64
     QAPI_LIST_APPEND(tail, DUMP_GUEST_MEMORY_FORMAT_WIN_DMP);
@@ -2803,7 +2803,8 @@ float16 float64_to_float16(float64 a, bool ieee, float_status *s)
     return float16a_round_pack_canonical(&p, s, fmt);
 }
 
-float32 float64_to_float32(float64 a, float_status *s)
+static float32 QEMU_SOFTFLOAT_ATTR
+soft_float64_to_float32(float64 a, float_status *s)
 {
     FloatParts64 p;
 
@@ -2812,6 +2813,29 @@ float32 float64_to_float32(float64 a, float_status *s)
     return float32_round_pack_canonical(&p, s);
 }
 
+float32 float64_to_float32(float64 a, float_status *s)
+{
+    if (likely(float64_is_normal(a)) && can_use_fpu(s)) {
+        /*
+         * Narrowing conversion: inexact is already set, so only overflow
+         * and results that may be tiny need special treatment.
+         */
+        union_float64 ud;
+        union_float32 uf;
+        ud.s = a;
+        uf.h = ud.h;
+        if (unlikely(f32_is_inf(uf))) {
+            float_raise(float_flag_overflow, s);
+            return uf.s;
+        } else if (likely(fabsf(uf.h) > FLT_MIN)) {
+            return uf.s;
+        }
+    } else if (float64_is_zero(a)) {
+        return float32_set_sign(float32_zero, float64_is_neg(a));
+    }
+    return soft_float64_to_float32(a, s);
+}
+
 float32 bfloat16_to_float32(bfloat16 a, float_status *s)
 {
     FloatParts64 p;
@@ -4181,7 +4205,8 @@ static bfloat16 bfloat16_minmax(bfloat16 a, bfloat16 b,
     return bfloat16_round_pack_canonical(pr, s);
 }
 
-static float32 float32_minmax(float32 a, float32 b, float_status *s, int flags)
+static float32 QEMU_SOFTFLOAT_ATTR
+float32_do_minmax(float32 a, float32 b, float_status *s, int flags)
 {
     FloatParts64 pa, pb, *pr;
 
@@ -4192,7 +4217,50 @@ static float32 float32_minmax(float32 a, float32 b, float_status *s, int flags)
     return float32_round_pack_canonical(pr, s);
 }
 
-static float64 float64_minmax(float64 a, float64 b, float_status *s, int flags)
+/*
+ * The result of min/max is always one of the inputs, so no rounding is
+ * involved and no flags can be raised for zero or normal operands.  Leave
+ * NaNs, infinities, denormals and ties (which includes signed zeros and,
+ * for the magnitude variants, equal magnitudes) to the soft implementation.
+ */
+static float32 QEMU_FLATTEN
+float32_minmax(float32 xa, float32 xb, float_status *s, int flags)
+{
+    union_float32 ua, ub;
+    float fa, fb;
+
+    ua.s = xa;
+    ub.s = xb;
+
+    if (QEMU_NO_HARDFLOAT) {
+        goto soft;
+    }
+
+    float32_input_flush2(&ua.s, &ub.s, s);
+    if (unlikely(!f32_is_zon2(ua, ub))) {
+        goto soft;
+    }
+
+    fa = ua.h;
+    fb = ub.h;
+    if (flags & minmax_ismag) {
+        fa = fabsf(fa);
+        fb = fabsf(fb);
+    }
+    if (unlikely(fa == fb)) {
+        goto soft;
+    }
+    if (flags & minmax_ismin) {
+        return fa < fb ? ua.s : ub.s;
+    }
+    return fa > fb ? ua.s : ub.s;
+
+ soft:
+    return float32_do_minmax(ua.s, ub.s, s, flags);
+}
+
+static float64 QEMU_SOFTFLOAT_ATTR
+float64_do_minmax(float64 a, float64 b, float_status *s, int flags)
 {
     FloatParts64 pa, pb, *pr;
 
@@ -4203,6 +4271,42 @@ static float64 float64_minmax(float64 a, float64 b, float_status *s, int flags)
     return float64_round_pack_canonical(pr, s);
 }
 
+static float64 QEMU_FLATTEN
+float64_minmax(float64 xa, float64 xb, float_status *s, int flags)
+{
+    union_float64 ua, ub;
+    double da, db;
+
+    ua.s = xa;
+    ub.s = xb;
+
+    if (QEMU_NO_HARDFLOAT) {
+        goto soft;
+    }
+
+    float64_input_flush2(&ua.s, &ub.s, s);
+    if (unlikely(!f64_is_zon2(ua, ub))) {
+        goto soft;
+    }
+
+    da = ua.h;
+    db = ub.h;
+    if (flags & minmax_ismag) {
+        da = fabs(da);
+        db = fabs(db);
+    }
+    if (unlikely(da == db)) {
+        goto soft;
+    }
+    if (flags & minmax_ismin) {
+        return da < db ? ua.s : ub.s;
+    }
+    return da > db ? ua.s : ub.s;
+
+ soft:
+    return float64_do_minmax(ua.s, ub.s, s, flags);
+}
+
 static float128 float128_minmax(float128 a, float128 b,
                                 float_status *s, int flags)
 {
@@ -41,7 +41,12 @@
 #include "hw/boards.h"
 #endif
 
-#define MAX_PACKET_LENGTH 4096
+/*
+ * Advertised to GDB as PacketSize. GDB sizes its memory transfers after
+ * it, so a large value cuts the number of round trips when dumping big
+ * buffers.
+ */
+#define MAX_PACKET_LENGTH 0x10000
 
 #include "qemu/sockets.h"
 #include "sysemu/hw_accel.h"
@@ -612,26 +617,58 @@ static inline int tohex(int v)
 /* writes 2*len+1 bytes in buf */
 static void memtohex(GString *buf, const uint8_t *mem, int len)
 {
-    int i, c;
-    for(i = 0; i < len; i++) {
-        c = mem[i];
-        g_string_append_c(buf, tohex(c >> 4));
-        g_string_append_c(buf, tohex(c & 0xf));
+    gsize pos = buf->len;
+    char *out;
+    int i;
+
+    g_string_set_size(buf, pos + 2 * len + 1);
+    out = buf->str + pos;
+    for (i = 0; i < len; i++) {
+        *out++ = tohex(mem[i] >> 4);
+        *out++ = tohex(mem[i] & 0xf);
     }
-    g_string_append_c(buf, '\0');
+    *out = '\0';
 }
 
 static void hextomem(GByteArray *mem, const char *buf, int len)
 {
+    guint pos = mem->len;
     int i;
 
-    for(i = 0; i < len; i++) {
-        guint8 byte = fromhex(buf[0]) << 4 | fromhex(buf[1]);
-        g_byte_array_append(mem, &byte, 1);
+    g_byte_array_set_size(mem, pos + len);
+    for (i = 0; i < len; i++) {
+        mem->data[pos + i] = fromhex(buf[0]) << 4 | fromhex(buf[1]);
         buf += 2;
     }
 }
 
+/*
+ * Append @len bytes of @mem to @buf as binary data, escaping the
+ * characters that are special to the remote protocol. Stops early rather
+ * than letting @buf grow beyond @max bytes.
+ *
+ * Returns the number of bytes of @mem consumed.
+ */
+static int memtobin(GString *buf, const uint8_t *mem, int len, gsize max)
+{
+    int i;
+
+    for (i = 0; i < len; i++) {
+        uint8_t c = mem[i];
+        bool escape = c == '#' || c == '$' || c == '}' || c == '*';
+
+        if (buf->len + 1 + escape > max) {
+            break;
+        }
+        if (escape) {
+            g_string_append_c(buf, '}');
+            c ^= 0x20;
+        }
+        g_string_append_c(buf, c);
+    }
+    return i;
+}
+
 static void hexdump(const char *buf, int len,
                     void (*trace_fn)(size_t ofs, char const *text))
 {
@@ -1849,6 +1886,84 @@ static void handle_write_all_regs(GArray *params, void *user_ctx)
     put_packet("OK");
 }
 
+/*
+ * X addr,length:XX...
+ *
+ * Same as M, but with the payload sent as escaped binary. The escapes were
+ * already undone when the packet was received, but the data may contain
+ * NULs, so it is located and sized from the packet itself rather than
+ * parsed as a string parameter.
+ */
+static void handle_write_mem_bin(GArray *params, void *user_ctx)
+{
+    const char *data;
+    size_t avail;
+    uint64_t len;
+
+    data = strchr(gdbserver_state.line_buf, ':');
+    if (params->len != 2 || !data) {
+        put_packet("E22");
+        return;
+    }
+
+    len = get_param(params, 1)->val_ull;
+    data++;
+    avail = gdbserver_state.line_buf + gdbserver_state.line_buf_index - data;
+    if (len > avail) {
+        put_packet("E22");
+        return;
+    }
+
+    /* GDB probes for X support with an empty write */
+    if (len) {
+        g_byte_array_append(gdbserver_state.mem_buf,
+                            (const uint8_t *)data, len);
+        if (target_memory_rw_debug(gdbserver_state.g_cpu,
+                                   get_param(params, 0)->val_ull,
+                                   gdbserver_state.mem_buf->data,
+                                   gdbserver_state.mem_buf->len, true)) {
+            put_packet("E14");
+            return;
+        }
+    }
+
+    put_packet("OK");
+}
+
+/*
+ * x addr,length
+ *
+ * Binary counterpart of m, replying 'b' followed by the escaped data.
+ * The reply may hold fewer bytes than requested when escaping makes it
+ * outgrow the packet size, in which case GDB asks for the rest.
+ */
+static void handle_read_mem_bin(GArray *params, void *user_ctx)
+{
+    uint64_t len;
+
+    if (params->len != 2) {
+        put_packet("E22");
+        return;
+    }
+
+    len = MIN(get_param(params, 1)->val_ull, MAX_PACKET_LENGTH - 1);
+    g_byte_array_set_size(gdbserver_state.mem_buf, len);
+
+    if (target_memory_rw_debug(gdbserver_state.g_cpu,
+                               get_param(params, 0)->val_ull,
+                               gdbserver_state.mem_buf->data,
+                               gdbserver_state.mem_buf->len, false)) {
+        put_packet("E14");
+        return;
+    }
+
+    g_string_append_c(gdbserver_state.str_buf, 'b');
+    memtobin(gdbserver_state.str_buf, gdbserver_state.mem_buf->data,
+             gdbserver_state.mem_buf->len, MAX_PACKET_LENGTH);
+    put_packet_binary(gdbserver_state.str_buf->str,
+                      gdbserver_state.str_buf->len, true);
+}
+
 static void handle_read_all_regs(GArray *params, void *user_ctx)
 {
     target_ulong addr, len;
@@ -2227,6 +2342,7 @@ static void handle_query_supported(GArray *params, void *user_ctx)
     CPUClass *cc;
 
     g_string_printf(gdbserver_state.str_buf, "PacketSize=%x", MAX_PACKET_LENGTH);
+    g_string_append(gdbserver_state.str_buf, ";binary-upload+");
     cc = CPU_GET_CLASS(first_cpu);
     if (cc->gdb_core_xml_file) {
         g_string_append(gdbserver_state.str_buf, ";qXfer:features:read+");
@@ -2777,6 +2893,28 @@ static int gdb_handle_packet(const char *line_buf)
             cmd_parser = &write_mem_cmd_desc;
         }
         break;
+    case 'x':
+        {
+            static const GdbCmdParseEntry read_mem_bin_cmd_desc = {
+                .handler = handle_read_mem_bin,
+                .cmd = "x",
+                .cmd_startswith = 1,
+                .schema = "L,L0"
+            };
+            cmd_parser = &read_mem_bin_cmd_desc;
+        }
+        break;
+    case 'X':
+        {
+            static const GdbCmdParseEntry write_mem_bin_cmd_desc = {
+                .handler = handle_write_mem_bin,
+                .cmd = "X",
+                .cmd_startswith = 1,
+                .schema = "L,L:"
+            };
+            cmd_parser = &write_mem_bin_cmd_desc;
+        }
+        break;
     case 'p':
         {
             static const GdbCmdParseEntry get_reg_cmd_desc = {
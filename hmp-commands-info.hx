@@ -673,6 +673,22 @@ SRST
     Show iothread's identifiers.
 ERST
 
+    {
+        .name       = "event-loop-stats",
+        .args_type  = "",
+        .params     = "",
+        .help       = "show event loop handler accounting",
+        .cmd        = hmp_info_event_loop_stats,
+        .flags      = "p",
+    },
+
+SRST
+  ``info event-loop-stats``
+    Show how often and for how long bottom halves, fd handlers and timers
+    ran, and how long the BQL was waited for, since accounting was enabled
+    with ``event-loop-stats on``.
+ERST
+
     {
         .name       = "rocker",
         .args_type  = "name:s",
@@ -56,6 +56,77 @@ static gboolean smmu_iotlb_key_equal(gconstpointer v1, gconstpointer v2)
            (k1->level == k2->level) && (k1->tg == k2->tg);
 }
 
+/*
+ * Besides the hash table used for lookups, each ASID with cached entries
+ * has a GTree of its keys ordered by IOVA, so that ASID and range
+ * invalidations only visit the entries they remove instead of the whole
+ * IOTLB.  Keys and entries are owned by the hash table.
+ */
+static gint smmu_iotlb_key_cmp(gconstpointer a, gconstpointer b)
+{
+    const SMMUIOTLBKey *k1 = a, *k2 = b;
+
+    if (k1->iova != k2->iova) {
+        return k1->iova < k2->iova ? -1 : 1;
+    }
+    if (k1->level != k2->level) {
+        return k1->level < k2->level ? -1 : 1;
+    }
+    return k1->tg - k2->tg;
+}
+
+/* Search function matching any key whose IOVA is in the [start, end] range */
+static gint smmu_iotlb_key_in_range(gconstpointer a, gconstpointer b)
+{
+    const SMMUIOTLBKey *key = a;
+    const SMMUIOTLBPageInvInfo *info = b;
+
+    if (key->iova < info->iova) {
+        return 1;
+    }
+    if (key->iova > info->iova + info->mask) {
+        return -1;
+    }
+    return 0;
+}
+
+static GTree *smmu_iotlb_asid_tree(SMMUState *bs, uint16_t asid, bool create)
+{
+    GTree *tree = g_hash_table_lookup(bs->iotlb_by_asid,
+                                      GUINT_TO_POINTER(asid));
+
+    if (!tree && create) {
+        tree = g_tree_new(smmu_iotlb_key_cmp);
+        g_hash_table_insert(bs->iotlb_by_asid, GUINT_TO_POINTER(asid), tree);
+    }
+    return tree;
+}
+
+/* Drop @key, which must be the key stored in the IOTLB, and its entry */
+static void smmu_iotlb_remove(SMMUState *bs, GTree *tree, SMMUIOTLBKey *key)
+{
+    uint16_t asid = key->asid;
+
+    g_tree_remove(tree, key);
+    g_hash_table_remove(bs->iotlb, key);
+    if (!g_tree_nnodes(tree)) {
+        g_hash_table_remove(bs->iotlb_by_asid, GUINT_TO_POINTER(asid));
+    }
+}
+
+static bool smmu_iotlb_remove_key(SMMUState *bs, SMMUIOTLBKey *key)
+{
+    gpointer orig_key, value;
+    GTree *tree;
+
+    if (!g_hash_table_lookup_extended(bs->iotlb, key, &orig_key, &value)) {
+        return false;
+    }
+    tree = smmu_iotlb_asid_tree(bs, key->asid, false);
+    smmu_iotlb_remove(bs, tree, orig_key);
+    return true;
+}
+
 SMMUIOTLBKey smmu_get_iotlb_key(uint16_t asid, uint64_t iova,
                                 uint8_t tg, uint8_t level)
 {
@@ -103,12 +174,14 @@ SMMUTLBEntry *smmu_iotlb_lookup(SMMUState *bs, SMMUTransCfg *cfg,
     }
 
     if (entry) {
+        bs->iotlb_hits++;
         cfg->iotlb_hits++;
         trace_smmu_iotlb_lookup_hit(cfg->asid, iova,
                                     cfg->iotlb_hits, cfg->iotlb_misses,
                                     100 * cfg->iotlb_hits /
                                     (cfg->iotlb_hits + cfg->iotlb_misses));
     } else {
+        bs->iotlb_misses++;
         cfg->iotlb_misses++;
         trace_smmu_iotlb_lookup_miss(cfg->asid, iova,
                                      cfg->iotlb_hits, cfg->iotlb_misses,
@@ -123,43 +196,72 @@ void smmu_iotlb_insert(SMMUState *bs, SMMUTransCfg *cfg, SMMUTLBEntry *new)
     SMMUIOTLBKey *key = g_new0(SMMUIOTLBKey, 1);
     uint8_t tg = (new->granule - 10) / 2;
 
-    if (g_hash_table_size(bs->iotlb) >= SMMU_IOTLB_MAX_SIZE) {
+    if (g_hash_table_size(bs->iotlb) >= bs->iotlb_size) {
+        bs->iotlb_flushes++;
         smmu_iotlb_inv_all(bs);
     }
 
     *key = smmu_get_iotlb_key(cfg->asid, new->entry.iova, tg, new->level);
     trace_smmu_iotlb_insert(cfg->asid, new->entry.iova, tg, new->level);
+    smmu_iotlb_remove_key(bs, key);
     g_hash_table_insert(bs->iotlb, key, new);
+    g_tree_insert(smmu_iotlb_asid_tree(bs, cfg->asid, true), key, key);
 }
 
 inline void smmu_iotlb_inv_all(SMMUState *s)
 {
     trace_smmu_iotlb_inv_all();
+    s->iotlb_inv++;
+    s->iotlb_inv_entries += g_hash_table_size(s->iotlb);
+    g_hash_table_remove_all(s->iotlb_by_asid);
     g_hash_table_remove_all(s->iotlb);
 }
 
-static gboolean smmu_hash_remove_by_asid(gpointer key, gpointer value,
-                                         gpointer user_data)
+static gboolean smmu_tree_collect_key(gpointer key, gpointer value,
+                                      gpointer user_data)
 {
-    uint16_t asid = *(uint16_t *)user_data;
-    SMMUIOTLBKey *iotlb_key = (SMMUIOTLBKey *)key;
-
-    return SMMU_IOTLB_ASID(*iotlb_key) == asid;
+    g_ptr_array_add(user_data, key);
+    return false;
 }
 
-static gboolean smmu_hash_remove_by_asid_iova(gpointer key, gpointer value,
-                                              gpointer user_data)
+/*
+ * Remove the entries of one ASID that either contain @info->iova or
+ * start within the [@info->iova, @info->iova + @info->mask] range.
+ */
+static void smmu_iotlb_inv_asid_iova(SMMUState *s, uint16_t asid,
+                                     SMMUIOTLBPageInvInfo *info)
 {
-    SMMUTLBEntry *iter = (SMMUTLBEntry *)value;
-    IOMMUTLBEntry *entry = &iter->entry;
-    SMMUIOTLBPageInvInfo *info = (SMMUIOTLBPageInvInfo *)user_data;
-    SMMUIOTLBKey iotlb_key = *(SMMUIOTLBKey *)key;
+    GTree *tree = smmu_iotlb_asid_tree(s, asid, false);
+    SMMUIOTLBKey *key;
+    int level, tg;
+
+    /* Larger entries containing the start address: one per level and TG */
+    for (tg = 1; tg <= 3 && tree; tg++) {
+        for (level = 0; level <= 3; level++) {
+            int shift = level_shift(level, tg * 2 + 10);
+            SMMUIOTLBKey k = smmu_get_iotlb_key(asid,
+                                                info->iova & ~((1ULL << shift)
+                                                               - 1),
+                                                tg, level);
+
+            if (smmu_iotlb_remove_key(s, &k)) {
+                s->iotlb_inv_entries++;
+                tree = smmu_iotlb_asid_tree(s, asid, false);
+            }
+        }
+    }
 
-    if (info->asid >= 0 && info->asid != SMMU_IOTLB_ASID(iotlb_key)) {
-        return false;
+    /* Entries starting within the range, O(log n) each */
+    while (tree && (key = g_tree_search(tree, smmu_iotlb_key_in_range, info))) {
+        smmu_iotlb_remove(s, tree, key);
+        s->iotlb_inv_entries++;
+        tree = smmu_iotlb_asid_tree(s, asid, false);
     }
-    return ((info->iova & ~entry->addr_mask) == entry->iova) ||
-           ((entry->iova & ~info->mask) == info->iova);
+}
+
+static void smmu_collect_asid(gpointer key, gpointer value, gpointer user_data)
+{
+    g_array_append_val(user_data, key);
 }
 
 inline void
@@ -169,10 +271,13 @@ smmu_iotlb_inv_iova(SMMUState *s, int asid, dma_addr_t iova,
     /* if tg is not set we use 4KB range invalidation */
     uint8_t granule = tg ? tg * 2 + 10 : 12;
 
+    trace_smmu_iotlb_inv_iova(asid, iova);
+    s->iotlb_inv++;
     if (ttl && (num_pages == 1) && (asid >= 0)) {
         SMMUIOTLBKey key = smmu_get_iotlb_key(asid, iova, tg, ttl);
 
-        if (g_hash_table_remove(s->iotlb, &key)) {
+        if (smmu_iotlb_remove_key(s, &key)) {
+            s->iotlb_inv_entries++;
             return;
         }
         /*
@@ -183,17 +288,41 @@ smmu_iotlb_inv_iova(SMMUState *s, int asid, dma_addr_t iova,
 
     SMMUIOTLBPageInvInfo info = {
         .asid = asid, .iova = iova,
-        .mask = (num_pages * 1 << granule) - 1};
+        .mask = (num_pages << granule) - 1};
 
-    g_hash_table_foreach_remove(s->iotlb,
-                                smmu_hash_remove_by_asid_iova,
-                                &info);
+    if (asid >= 0) {
+        smmu_iotlb_inv_asid_iova(s, asid, &info);
+    } else {
+        g_autoptr(GArray) asids = g_array_new(false, false, sizeof(gpointer));
+        int i;
+
+        g_hash_table_foreach(s->iotlb_by_asid, smmu_collect_asid, asids);
+        for (i = 0; i < asids->len; i++) {
+            smmu_iotlb_inv_asid_iova(s,
+                GPOINTER_TO_UINT(g_array_index(asids, gpointer, i)), &info);
+        }
+    }
 }
 
 inline void smmu_iotlb_inv_asid(SMMUState *s, uint16_t asid)
 {
+    GTree *tree = smmu_iotlb_asid_tree(s, asid, false);
+    g_autoptr(GPtrArray) keys = NULL;
+    int i;
+
     trace_smmu_iotlb_inv_asid(asid);
-    g_hash_table_foreach_remove(s->iotlb, smmu_hash_remove_by_asid, &asid);
+    s->iotlb_inv++;
+    if (!tree) {
+        return;
+    }
+
+    keys = g_ptr_array_sized_new(g_tree_nnodes(tree));
+    g_tree_foreach(tree, smmu_tree_collect_key, keys);
+    g_hash_table_remove(s->iotlb_by_asid, GUINT_TO_POINTER(asid));
+    for (i = 0; i < keys->len; i++) {
+        g_hash_table_remove(s->iotlb, g_ptr_array_index(keys, i));
+    }
+    s->iotlb_inv_entries += keys->len;
 }
 
 /* VMSAv8-64 Translation */
@@ -593,9 +722,15 @@ static void smmu_base_realize(DeviceState *dev, Error **errp)
         error_propagate(errp, local_err);
         return;
     }
+    if (!s->iotlb_size) {
+        error_setg(errp, "iotlb-size must be at least 1");
+        return;
+    }
     s->configs = g_hash_table_new_full(NULL, NULL, NULL, g_free);
     s->iotlb = g_hash_table_new_full(smmu_iotlb_key_hash, smmu_iotlb_key_equal,
                                      g_free, g_free);
+    s->iotlb_by_asid = g_hash_table_new_full(NULL, NULL, NULL,
+                                             (GDestroyNotify)g_tree_destroy);
     s->smmu_pcibus_by_busptr = g_hash_table_new(NULL, NULL);
 
     if (s->primary_bus) {
@@ -610,12 +745,38 @@ static void smmu_base_reset(DeviceState *dev)
     SMMUState *s = ARM_SMMU(dev);
 
     g_hash_table_remove_all(s->configs);
+    g_hash_table_remove_all(s->iotlb_by_asid);
     g_hash_table_remove_all(s->iotlb);
 }
 
+static void smmu_base_instance_init(Object *obj)
+{
+    SMMUState *s = ARM_SMMU(obj);
+
+    /* Cache statistics, readable with qom-get */
+    object_property_add_uint64_ptr(obj, "iotlb-hits", &s->iotlb_hits,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "iotlb-misses", &s->iotlb_misses,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "iotlb-invalidations", &s->iotlb_inv,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "iotlb-invalidated-entries",
+                                   &s->iotlb_inv_entries, OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "iotlb-flushes", &s->iotlb_flushes,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "config-cache-hits",
+                                   &s->cfg_cache_hits, OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "config-cache-misses",
+                                   &s->cfg_cache_misses, OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "config-cache-invalidations",
+                                   &s->cfg_cache_inv, OBJ_PROP_FLAG_READ);
+}
+
 static Property smmu_dev_properties[] = {
     DEFINE_PROP_UINT8("bus_num", SMMUState, bus_num, 0),
     DEFINE_PROP_LINK("primary-bus", SMMUState, primary_bus, "PCI", PCIBus *),
+    DEFINE_PROP_UINT32("iotlb-size", SMMUState, iotlb_size,
+                       SMMU_IOTLB_MAX_SIZE),
     DEFINE_PROP_END_OF_LIST(),
 };
 
@@ -634,6 +795,7 @@ static const TypeInfo smmu_base_info = {
     .name          = TYPE_ARM_SMMU,
     .parent        = TYPE_SYS_BUS_DEVICE,
     .instance_size = sizeof(SMMUState),
+    .instance_init = smmu_base_instance_init,
     .class_data    = NULL,
     .class_size    = sizeof(SMMUBaseClass),
     .class_init    = smmu_base_class_init,
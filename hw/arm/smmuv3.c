@@ -628,12 +628,14 @@ static SMMUTransCfg *smmuv3_get_config(SMMUDevice *sdev, SMMUEventInfo *event,
 
     cfg = g_hash_table_lookup(bc->configs, sdev);
     if (cfg) {
+        bc->cfg_cache_hits++;
         sdev->cfg_cache_hits++;
         trace_smmuv3_config_cache_hit(sid,
                             sdev->cfg_cache_hits, sdev->cfg_cache_misses,
                             100 * sdev->cfg_cache_hits /
                             (sdev->cfg_cache_hits + sdev->cfg_cache_misses));
     } else {
+        bc->cfg_cache_misses++;
         sdev->cfg_cache_misses++;
         trace_smmuv3_config_cache_miss(sid,
                             sdev->cfg_cache_hits, sdev->cfg_cache_misses,
@@ -665,6 +667,7 @@ static void smmuv3_flush_config(SMMUDevice *sdev, uint32_t sid)
     SMMUState *bc = &s->smmu_state;
 
     trace_smmuv3_config_cache_inv(sid);
+    bc->cfg_cache_inv++;
     g_hash_table_remove(bc->configs, sdev);
 }
 
@@ -1045,8 +1048,9 @@ static int smmuv3_cmdq_consume(SMMUv3State *s)
             sid_range.end = sid_range.start + mask;
 
             trace_smmuv3_cmdq_cfgi_ste_range(sid_range.start, sid_range.end);
-            g_hash_table_foreach_remove(bs->configs, smmuv3_invalidate_ste,
-                                        &sid_range);
+            bs->cfg_cache_inv += g_hash_table_foreach_remove(bs->configs,
+                                                     smmuv3_invalidate_ste,
+                                                     &sid_range);
             break;
         }
         case SMMU_CMD_CFGI_CD:
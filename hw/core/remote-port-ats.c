@@ -54,37 +54,199 @@ IOMMUTLBEntry *rp_ats_cache_lookup_translation(RemotePortATSCache *cache,
     return c->lookup_translation(cache, translated_addr, len);
 }
 
+/*
+ * The translation cache.
+ *
+ * ATS translations are naturally aligned power-of-two blocks, so entries
+ * are bucketed by block size. Each bucket indexes its entries both by
+ * translated address (for lookups from the memory slave) and by iova
+ * (for IOMMU unmap notifications). A lookup costs one hash probe per
+ * block size in use, and a range invalidation only visits the slots the
+ * range can touch.
+ */
+typedef struct ATSCacheSlot {
+    hwaddr key;
+    GSList *entries;
+} ATSCacheSlot;
+
+typedef struct ATSCacheBucket {
+    hwaddr mask;
+    GHashTable *by_phys;
+    GHashTable *by_iova;
+} ATSCacheBucket;
+
+static ATSCacheBucket *rp_ats_cache_bucket(RemotePortATS *s, hwaddr mask)
+{
+    ATSCacheBucket *b;
+    int i;
+
+    for (i = 0; i < s->cache->len; i++) {
+        b = g_ptr_array_index(s->cache, i);
+        if (b->mask == mask) {
+            return b;
+        }
+    }
+
+    b = g_new0(ATSCacheBucket, 1);
+    b->mask = mask;
+    b->by_phys = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                       NULL, g_free);
+    b->by_iova = g_hash_table_new_full(g_int64_hash, g_int64_equal,
+                                       NULL, g_free);
+    g_ptr_array_add(s->cache, b);
+    return b;
+}
+
+static void rp_ats_cache_bucket_free(gpointer opaque)
+{
+    ATSCacheBucket *b = opaque;
+    GHashTableIter iter;
+    ATSCacheSlot *slot;
+
+    /* Every entry is on exactly one by_phys slot.  */
+    g_hash_table_iter_init(&iter, b->by_phys);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&slot)) {
+        g_slist_free_full(slot->entries, g_free);
+    }
+    g_hash_table_iter_init(&iter, b->by_iova);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&slot)) {
+        g_slist_free(slot->entries);
+    }
+    g_hash_table_destroy(b->by_phys);
+    g_hash_table_destroy(b->by_iova);
+    g_free(b);
+}
+
+static void rp_ats_slot_add(GHashTable *h, hwaddr key, IOMMUTLBEntry *iotlb)
+{
+    ATSCacheSlot *slot = g_hash_table_lookup(h, &key);
+
+    if (!slot) {
+        slot = g_new0(ATSCacheSlot, 1);
+        slot->key = key;
+        g_hash_table_insert(h, &slot->key, slot);
+    }
+    slot->entries = g_slist_prepend(slot->entries, iotlb);
+}
+
+static void rp_ats_slot_del(GHashTable *h, hwaddr key, IOMMUTLBEntry *iotlb)
+{
+    ATSCacheSlot *slot = g_hash_table_lookup(h, &key);
+
+    slot->entries = g_slist_remove(slot->entries, iotlb);
+    if (!slot->entries) {
+        g_hash_table_remove(h, &key);
+    }
+}
+
+/* Collect the entries of one index of @b that overlap [start, last].  */
+static void rp_ats_bucket_collect(ATSCacheBucket *b, GHashTable *h,
+                                  hwaddr start, hwaddr last, GPtrArray *out)
+{
+    hwaddr first_key = start & ~b->mask;
+    hwaddr last_key = last & ~b->mask;
+    uint64_t nkeys = b->mask == HWADDR_MAX ? 1 :
+                     (last_key - first_key) / (b->mask + 1) + 1;
+    ATSCacheSlot *slot;
+    GSList *l;
+
+    if (nkeys <= g_hash_table_size(h)) {
+        hwaddr key = first_key;
+        uint64_t i;
+
+        for (i = 0; i < nkeys; i++, key += b->mask + 1) {
+            slot = g_hash_table_lookup(h, &key);
+            for (l = slot ? slot->entries : NULL; l; l = l->next) {
+                g_ptr_array_add(out, l->data);
+            }
+        }
+    } else {
+        GHashTableIter iter;
+
+        g_hash_table_iter_init(&iter, h);
+        while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&slot)) {
+            if (slot->key < first_key || slot->key > last_key) {
+                continue;
+            }
+            for (l = slot->entries; l; l = l->next) {
+                g_ptr_array_add(out, l->data);
+            }
+        }
+    }
+}
+
+static GPtrArray *rp_ats_cache_collect(RemotePortATS *s, bool by_iova,
+                                       hwaddr start, hwaddr last)
+{
+    GPtrArray *out = g_ptr_array_new();
+    int i;
+
+    for (i = 0; i < s->cache->len; i++) {
+        ATSCacheBucket *b = g_ptr_array_index(s->cache, i);
+
+        rp_ats_bucket_collect(b, by_iova ? b->by_iova : b->by_phys,
+                              start, last, out);
+    }
+    return out;
+}
+
+/*
+ * Take @iotlb out of the cache without freeing it. Invalidations block in
+ * rp_dev_wait_resp(), which processes incoming packets and can change the
+ * cache, so callers unlink everything they drop before sending any and
+ * free the entries after the last response.
+ */
+static void rp_ats_cache_unlink(RemotePortATS *s, IOMMUTLBEntry *iotlb)
+{
+    ATSCacheBucket *b = rp_ats_cache_bucket(s, iotlb->addr_mask);
+
+    rp_ats_slot_del(b->by_phys, iotlb->translated_addr, iotlb);
+    rp_ats_slot_del(b->by_iova, iotlb->iova, iotlb);
+    s->cache_entries--;
+}
+
 static IOMMUTLBEntry *rp_ats_lookup_translation(RemotePortATSCache *cache,
                                                 hwaddr translated_addr,
                                                 hwaddr len)
 {
     RemotePortATS *s = REMOTE_PORT_ATS(cache);
+    int i;
 
-    for (int i = 0; i < s->cache->len; i++) {
-        IOMMUTLBEntry *iotlb = g_array_index(s->cache, IOMMUTLBEntry *, i);
-        hwaddr masked_start = (translated_addr & ~iotlb->addr_mask);
-        hwaddr masked_end = ((translated_addr + len - 1) & ~iotlb->addr_mask);
+    for (i = 0; i < s->cache->len; i++) {
+        ATSCacheBucket *b = g_ptr_array_index(s->cache, i);
+        hwaddr masked_start = (translated_addr & ~b->mask);
+        hwaddr masked_end = ((translated_addr + len - 1) & ~b->mask);
+        ATSCacheSlot *slot;
 
-        if (masked_start == iotlb->translated_addr &&
-            masked_end == iotlb->translated_addr) {
-            return iotlb;
+        if (masked_start != masked_end) {
+            continue;
+        }
+        slot = g_hash_table_lookup(b->by_phys, &masked_start);
+        if (slot) {
+            s->cache_hits++;
+            return slot->entries->data;
         }
     }
 
+    s->cache_misses++;
     return NULL;
 }
 
-static void rp_ats_cache_remove(RemotePortATS *s, IOMMUTLBEntry *iotlb)
+/*
+ * Unlink every cached translation whose iova range overlaps @iotlb and
+ * return them, the caller frees the array.
+ */
+static GPtrArray *rp_ats_cache_remove(RemotePortATS *s, IOMMUTLBEntry *iotlb)
 {
-    for (int i = 0; i < s->cache->len; i++) {
-        IOMMUTLBEntry *tmp = g_array_index(s->cache, IOMMUTLBEntry *, i);
-        hwaddr masked_start = (tmp->iova & ~iotlb->addr_mask);
-        hwaddr masked_end = ((tmp->iova | tmp->addr_mask) & ~iotlb->addr_mask);
+    GPtrArray *hits = rp_ats_cache_collect(s, true, iotlb->iova,
+                                           iotlb->iova | iotlb->addr_mask);
+    int i;
 
-        if (masked_start == iotlb->iova || masked_end == iotlb->iova) {
-            g_array_remove_index_fast(s->cache, i);
-        }
+    g_ptr_array_set_free_func(hits, g_free);
+    for (i = 0; i < hits->len; i++) {
+        rp_ats_cache_unlink(s, g_ptr_array_index(hits, i));
     }
+    return hits;
 }
 
 static void rp_ats_invalidate(RemotePortATS *s, IOMMUTLBEntry *iotlb)
@@ -130,7 +292,12 @@ static void rp_ats_cache_insert(RemotePortATS *s,
                                 hwaddr mask,
                                 AddressSpace *target_as)
 {
+    ATSCacheBucket *b;
     IOMMUTLBEntry *iotlb;
+    GPtrArray *hits;
+    GPtrArray *stale;
+    bool cached = false;
+    int i;
 
     /*
      * Invalidate all current translations that collide with the new one and
@@ -138,68 +305,72 @@ static void rp_ats_cache_insert(RemotePortATS *s,
      * towards the same addresses but in different target address spaces are
      * not allowed.
      */
-    for (int i = 0; i < s->cache->len; i++) {
-        IOMMUTLBEntry *iotlb = g_array_index(s->cache, IOMMUTLBEntry *, i);
-        hwaddr masked_start = (translated_addr & ~iotlb->addr_mask);
-        hwaddr masked_end = ((translated_addr | mask) & ~iotlb->addr_mask);
-        bool spans_region = masked_start < iotlb->translated_addr &&
-                             masked_end > iotlb->translated_addr;
-
-        if (masked_start == iotlb->translated_addr ||
-            masked_end == iotlb->translated_addr || spans_region) {
-            hwaddr masked_iova_start;
-            hwaddr masked_iova_end;
-
-            /*
-             * Invalidated & remove the mapping if the address range hit in the
-             * cache but the target_as is different.
-             */
-            if (iotlb->target_as != target_as) {
-                rp_ats_invalidate(s, iotlb);
-                g_array_remove_index_fast(s->cache, i);
-                continue;
-            }
+    hits = rp_ats_cache_collect(s, false, translated_addr,
+                                translated_addr | mask);
+    stale = g_ptr_array_new_with_free_func(g_free);
+    for (i = 0; i < hits->len; i++) {
+        IOMMUTLBEntry *tmp = g_ptr_array_index(hits, i);
+        bool iova_overlap = tmp->iova <= (iova | mask) &&
+                            iova <= (tmp->iova | tmp->addr_mask);
+
+        /*
+         * Invalidated & remove the mapping if the address range hit in the
+         * cache but the target_as is different.
+         */
+        if (tmp->target_as != target_as) {
+            rp_ats_cache_unlink(s, tmp);
+            g_ptr_array_add(stale, tmp);
+            continue;
+        }
 
-            /*
-             * Remove duplicates with a smaller range length since the new
-             * mapping will span over it.
-             */
-            masked_iova_start = (iova & ~iotlb->addr_mask);
-            masked_iova_end = ((iova | mask) & ~iotlb->addr_mask);
-            spans_region = masked_iova_start < iotlb->iova &&
-                            masked_iova_end > iotlb->iova;
-
-            if (masked_iova_start == iotlb->iova ||
-                masked_iova_end == iotlb->iova || spans_region) {
-
-                if ((iotlb->addr_mask + 1) < (mask + 1)) {
-                    g_array_remove_index_fast(s->cache, i);
-                } else {
-                    /*
-                     * The new mapping is smaller or equal in size and is thus
-                     * already cached.
-                     */
-                    return;
-                }
+        /*
+         * Remove duplicates with a smaller range length since the new
+         * mapping will span over it.
+         */
+        if (iova_overlap) {
+            if (tmp->addr_mask < mask) {
+                rp_ats_cache_unlink(s, tmp);
+                g_free(tmp);
+            } else {
+                /*
+                 * The new mapping is smaller or equal in size and is thus
+                 * already cached.
+                 */
+                cached = true;
+                break;
             }
         }
     }
+    g_ptr_array_free(hits, true);
+
+    if (!cached) {
+        iotlb = g_new0(IOMMUTLBEntry, 1);
+        iotlb->iova = iova;
+        iotlb->translated_addr = translated_addr;
+        iotlb->addr_mask = mask;
+        iotlb->target_as = target_as;
+
+        b = rp_ats_cache_bucket(s, mask);
+        rp_ats_slot_add(b->by_phys, translated_addr, iotlb);
+        rp_ats_slot_add(b->by_iova, iova, iotlb);
+        s->cache_entries++;
+    }
 
-    iotlb = g_new0(IOMMUTLBEntry, 1);
-    iotlb->iova = iova;
-    iotlb->translated_addr = translated_addr;
-    iotlb->addr_mask = mask;
-    iotlb->target_as = target_as;
-    g_array_append_val(s->cache, iotlb);
+    /* The cache is consistent now, the invalidations may re-enter it.  */
+    for (i = 0; i < stale->len; i++) {
+        rp_ats_invalidate(s, g_ptr_array_index(stale, i));
+    }
+    g_ptr_array_free(stale, true);
 }
 
 static void rp_ats_iommu_unmap_notify(IOMMUNotifier *n, IOMMUTLBEntry *iotlb)
 {
     ATSIOMMUNotifier *notifier = container_of(n, ATSIOMMUNotifier, n);
     RemotePortATS *s = notifier->rp_ats;
+    GPtrArray *hits = rp_ats_cache_remove(s, iotlb);
 
     rp_ats_invalidate(s, iotlb);
-    rp_ats_cache_remove(s, iotlb);
+    g_ptr_array_free(hits, true);
 }
 
 static bool ats_translate_address(RemotePortATS *s, struct rp_pkt *pkt,
@@ -319,7 +490,7 @@ static void rp_ats_realize(DeviceState *dev, Error **errp)
     address_space_init(&s->as, s->mr ? s->mr : get_system_memory(), "ats-as");
 
     s->iommu_notifiers = g_array_new(false, true, sizeof(ATSIOMMUNotifier *));
-    s->cache = g_array_new(false, true, sizeof(IOMMUTLBEntry *));
+    s->cache = g_ptr_array_new_with_free_func(rp_ats_cache_bucket_free);
 }
 
 static void rp_ats_init(Object *obj)
@@ -334,6 +505,12 @@ static void rp_ats_init(Object *obj)
                              (Object **)&s->mr,
                              qdev_prop_allow_set_link_before_realize,
                              OBJ_PROP_LINK_STRONG);
+    object_property_add_uint64_ptr(obj, "cache-hits", &s->cache_hits,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "cache-misses", &s->cache_misses,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "cache-entries", &s->cache_entries,
+                                   OBJ_PROP_FLAG_READ);
 }
 
 static void rp_ats_unrealize(DeviceState *dev)
@@ -351,11 +528,7 @@ static void rp_ats_unrealize(DeviceState *dev)
 
     address_space_destroy(&s->as);
 
-    for (i = 0; i < s->cache->len; i++) {
-        IOMMUTLBEntry *tmp = g_array_index(s->cache, IOMMUTLBEntry *, i);
-        g_free(tmp);
-    }
-    g_array_free(s->cache, true);
+    g_ptr_array_free(s->cache, true);
 }
 
 static Property rp_properties[] = {
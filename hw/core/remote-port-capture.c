@@ -0,0 +1,210 @@
+/*
+ * QEMU remote port traffic capture.
+ *
+ * Each direction has its own single-producer ring, filled without locks
+ * by the thread doing the transfer and drained by a writer thread that
+ * merges both rings in host time order into the capture file.
+ *
+ * This code is licensed under the GNU GPL.
+ */
+
+#include "qemu/osdep.h"
+#include "qapi/error.h"
+#include "qemu/atomic.h"
+#include "qemu/bswap.h"
+#include "qemu/error-report.h"
+#include "qemu/thread.h"
+#include "qemu/timer.h"
+
+#include "hw/remote-port-capture.h"
+
+/* Must be a power of 2.  */
+#define RP_CAPTURE_RING_SIZE (4 * MiB)
+
+typedef struct RemotePortCaptureRing {
+    uint8_t *buf;
+    /* Free running byte counters, only the producer moves head.  */
+    uint32_t head;
+    uint32_t tail;
+    uint64_t dropped;
+} RemotePortCaptureRing;
+
+struct RemotePortCapture {
+    char *path;
+    FILE *f;
+    QemuThread thread;
+    QemuEvent event;
+    bool stop;
+    RemotePortCaptureRing ring[2];
+};
+
+static void rp_capture_ring_put(RemotePortCaptureRing *r, uint32_t pos,
+                                const void *data, size_t len)
+{
+    uint32_t off = pos & (RP_CAPTURE_RING_SIZE - 1);
+    size_t first = MIN(len, RP_CAPTURE_RING_SIZE - off);
+
+    memcpy(r->buf + off, data, first);
+    memcpy(r->buf, (const uint8_t *)data + first, len - first);
+}
+
+static void rp_capture_ring_get(RemotePortCaptureRing *r, uint32_t pos,
+                                void *data, size_t len)
+{
+    uint32_t off = pos & (RP_CAPTURE_RING_SIZE - 1);
+    size_t first = MIN(len, RP_CAPTURE_RING_SIZE - off);
+
+    memcpy(data, r->buf + off, first);
+    memcpy((uint8_t *)data + first, r->buf, len - first);
+}
+
+void rp_capture_pkt(RemotePortCapture *c, unsigned int dir, int64_t vclk,
+                    const void *hdr, size_t hdr_len,
+                    const void *data, size_t data_len)
+{
+    RemotePortCaptureRing *r = &c->ring[dir];
+    RemotePortCaptureRecord rec = {
+        .host_ns = cpu_to_le64(get_clock()),
+        .vclk = cpu_to_le64(vclk),
+        .len = cpu_to_le32(hdr_len + data_len),
+        .dir = dir,
+    };
+    size_t need = sizeof(rec) + hdr_len + data_len;
+    uint32_t head = r->head;
+    uint32_t used = head - qatomic_load_acquire(&r->tail);
+
+    if (need > RP_CAPTURE_RING_SIZE - used) {
+        r->dropped++;
+        return;
+    }
+
+    rp_capture_ring_put(r, head, &rec, sizeof(rec));
+    rp_capture_ring_put(r, head + sizeof(rec), hdr, hdr_len);
+    rp_capture_ring_put(r, head + sizeof(rec) + hdr_len, data, data_len);
+    qatomic_store_release(&r->head, head + need);
+    qemu_event_set(&c->event);
+}
+
+/* Write out the oldest pending record. Returns false if there is none.  */
+static bool rp_capture_write_one(RemotePortCapture *c)
+{
+    RemotePortCaptureRecord rec[2];
+    RemotePortCaptureRing *r = NULL;
+    uint8_t chunk[4096];
+    uint32_t pos, len;
+    int i, pick = -1;
+
+    for (i = 0; i < ARRAY_SIZE(c->ring); i++) {
+        RemotePortCaptureRing *ri = &c->ring[i];
+
+        if (qatomic_load_acquire(&ri->head) == ri->tail) {
+            continue;
+        }
+        rp_capture_ring_get(ri, ri->tail, &rec[i], sizeof(rec[i]));
+        if (pick < 0 ||
+            le64_to_cpu(rec[i].host_ns) < le64_to_cpu(rec[pick].host_ns)) {
+            pick = i;
+        }
+    }
+    if (pick < 0) {
+        return false;
+    }
+
+    r = &c->ring[pick];
+    len = sizeof(rec[pick]) + le32_to_cpu(rec[pick].len);
+    for (pos = 0; pos < len; pos += sizeof(chunk)) {
+        uint32_t n = MIN(len - pos, sizeof(chunk));
+
+        rp_capture_ring_get(r, r->tail + pos, chunk, n);
+        if (fwrite(chunk, n, 1, c->f) != 1) {
+            /* Keep draining, or the producers would start dropping.  */
+            break;
+        }
+    }
+    qatomic_store_release(&r->tail, r->tail + len);
+    return true;
+}
+
+static void *rp_capture_thread(void *opaque)
+{
+    RemotePortCapture *c = opaque;
+
+    while (true) {
+        qemu_event_reset(&c->event);
+        while (rp_capture_write_one(c)) {
+            /* Drain.  */
+        }
+        if (qatomic_read(&c->stop)) {
+            break;
+        }
+        fflush(c->f);
+        qemu_event_wait(&c->event);
+    }
+    return NULL;
+}
+
+RemotePortCapture *rp_capture_open(const char *path, Error **errp)
+{
+    RemotePortCaptureHeader hdr = {
+        .version = cpu_to_le32(RP_CAPTURE_VERSION),
+    };
+    RemotePortCapture *c;
+    FILE *f;
+    int i;
+
+    memcpy(hdr.magic, RP_CAPTURE_MAGIC, sizeof(hdr.magic));
+
+    f = fopen(path, "wb");
+    if (!f) {
+        error_setg_errno(errp, errno, "Cannot create capture file '%s'",
+                         path);
+        return NULL;
+    }
+    if (fwrite(&hdr, sizeof(hdr), 1, f) != 1) {
+        error_setg_errno(errp, errno, "Cannot write capture file '%s'",
+                         path);
+        fclose(f);
+        return NULL;
+    }
+
+    c = g_new0(RemotePortCapture, 1);
+    c->path = g_strdup(path);
+    c->f = f;
+    for (i = 0; i < ARRAY_SIZE(c->ring); i++) {
+        c->ring[i].buf = g_malloc(RP_CAPTURE_RING_SIZE);
+    }
+    qemu_event_init(&c->event, false);
+    qemu_thread_create(&c->thread, "remote-port-capture", rp_capture_thread,
+                       c, QEMU_THREAD_JOINABLE);
+    return c;
+}
+
+void rp_capture_close(RemotePortCapture *c)
+{
+    int i;
+
+    qatomic_set(&c->stop, true);
+    qemu_event_set(&c->event);
+    qemu_thread_join(&c->thread);
+
+    /* Pick up whatever was queued while the thread was stopping.  */
+    while (rp_capture_write_one(c)) {
+        /* Drain.  */
+    }
+
+    if (c->ring[RP_CAPTURE_DIR_IN].dropped ||
+        c->ring[RP_CAPTURE_DIR_OUT].dropped) {
+        warn_report("%s: dropped %" PRIu64 " received and %" PRIu64
+                    " sent packets", c->path,
+                    c->ring[RP_CAPTURE_DIR_IN].dropped,
+                    c->ring[RP_CAPTURE_DIR_OUT].dropped);
+    }
+
+    fclose(c->f);
+    qemu_event_destroy(&c->event);
+    for (i = 0; i < ARRAY_SIZE(c->ring); i++) {
+        g_free(c->ring[i].buf);
+    }
+    g_free(c->path);
+    g_free(c);
+}
@@ -11,6 +11,9 @@
 #include "sysemu/sysemu.h"
 #include "sysemu/dma.h"
 #include "qemu/log.h"
+#include "qemu/cutils.h"
+#include "qemu/host-utils.h"
+#include "qemu/main-loop.h"
 #include "qapi/qmp/qerror.h"
 #include "qapi/error.h"
 #include "hw/qdev-core.h"
@@ -27,15 +30,139 @@
 
 #define CACHE_INVALID -1
 
+static void rp_gpio_batch_flush(RemotePortGPIO *s)
+{
+    struct {
+        struct rp_pkt_interrupt_vec pkt;
+        uint32_t bitmaps[RP_GPIO_WORDS * 2];
+    } pay;
+    uint32_t nwords = DIV_ROUND_UP(s->num_gpios, 32);
+    uint32_t flags = s->posted_updates ? RP_PKT_FLAGS_posted : 0;
+    uint32_t id;
+    unsigned int i;
+    size_t len;
+
+    if (!s->batch.pending) {
+        return;
+    }
+    s->batch.pending = false;
+    qemu_bh_cancel(s->batch.bh);
+
+    for (i = 0; i < s->num_gpios; i++) {
+        if (s->batch.changed[i / 32] & (1U << (i % 32))) {
+            s->cache[i] = !!(s->batch.levels[i / 32] & (1U << (i % 32)));
+        }
+    }
+
+    id = rp_new_id(s->rp);
+    len = rp_encode_interrupt_vec(id, s->rp_dev, &pay.pkt, s->batch.clk, 0,
+                                  nwords, s->batch.changed, s->batch.levels,
+                                  flags);
+    memset(s->batch.changed, 0, sizeof s->batch.changed);
+    memset(s->batch.levels, 0, sizeof s->batch.levels);
+
+    trace_remote_port_gpio_tx_interrupt_vec(id, flags, s->rp_dev, nwords);
+
+    if (s->peer->caps.wire_posted_updates && !s->posted_updates) {
+        rp_rsp_mutex_lock(s->rp);
+    }
+
+    rp_write(s->rp, (void *)&pay, len);
+
+    if (s->peer->caps.wire_posted_updates && !s->posted_updates) {
+        RemotePortRespSlot *rsp_slot;
+        struct rp_pkt_interrupt_vec *vec;
+
+        rsp_slot = rp_dev_wait_resp(s->rp, s->rp_dev, id);
+        assert(rsp_slot->rsp.pkt->hdr.id == id);
+
+        vec = &rsp_slot->rsp.pkt->interrupt_vec;
+        trace_remote_port_gpio_rx_interrupt_vec(vec->hdr.id, vec->hdr.flags,
+                                                vec->hdr.dev, vec->nwords);
+
+        rp_resp_slot_done(s->rp, rsp_slot);
+        rp_rsp_mutex_unlock(s->rp);
+    }
+}
+
+static void rp_gpio_batch_bh(void *opaque)
+{
+    rp_gpio_batch_flush(opaque);
+}
+
+/*
+ * Queue a line change. Changes made at the same virtual time go out in a
+ * single vector packet, either when time moves on or from a bottom half.
+ */
+static void rp_gpio_batch_update(RemotePortGPIO *s, int irq, int level)
+{
+    int64_t clk = rp_normalized_vmclk(s->rp);
+    uint32_t *changed = &s->batch.changed[irq / 32];
+    uint32_t *levels = &s->batch.levels[irq / 32];
+    uint32_t bit = 1U << (irq % 32);
+
+    level = !!level;
+
+    if (s->batch.pending && s->batch.clk != clk) {
+        rp_gpio_batch_flush(s);
+    }
+
+    if (*changed & bit) {
+        if (!!(*levels & bit) == level) {
+            return;
+        }
+        if (!s->coalesce) {
+            /* Don't lose the edge, send what we have first.  */
+            rp_gpio_batch_flush(s);
+        } else if (s->cache[irq] == level) {
+            /* Back where the peer thinks it is, nothing to send.  */
+            *changed &= ~bit;
+            *levels &= ~bit;
+            if (buffer_is_zero(s->batch.changed, sizeof s->batch.changed)) {
+                s->batch.pending = false;
+                qemu_bh_cancel(s->batch.bh);
+            }
+            return;
+        } else {
+            *levels ^= bit;
+            return;
+        }
+    }
+
+    /* If we hit the cache, return early.  */
+    if (s->cache[irq] != CACHE_INVALID && s->cache[irq] == level) {
+        return;
+    }
+
+    *changed |= bit;
+    if (level) {
+        *levels |= bit;
+    } else {
+        *levels &= ~bit;
+    }
+    if (!s->batch.pending) {
+        s->batch.pending = true;
+        s->batch.clk = clk;
+        qemu_bh_schedule(s->batch.bh);
+    }
+}
+
 static void rp_gpio_handler(void *opaque, int irq, int level)
 {
     RemotePortGPIO *s = opaque;
     struct rp_pkt pkt;
     size_t len;
     int64_t clk;
-    uint32_t id = rp_new_id(s->rp);
+    uint32_t id;
     uint32_t flags = s->posted_updates ? RP_PKT_FLAGS_posted : 0;
 
+    if (s->batch_updates && s->peer->caps.wire_vector) {
+        rp_gpio_batch_update(s, irq, level);
+        return;
+    }
+
+    id = rp_new_id(s->rp);
+
     /* If we hit the cache, return early.  */
     if (s->cache[irq] != CACHE_INVALID && s->cache[irq] == level) {
         return;
@@ -106,12 +233,73 @@ static void rp_gpio_interrupt(RemotePortDevice *rpdev, struct rp_pkt *pkt)
     }
 }
 
+static void rp_gpio_interrupt_vec(RemotePortDevice *rpdev,
+                                  struct rp_pkt *pkt)
+{
+    RemotePortGPIO *s = REMOTE_PORT_GPIO(rpdev);
+    struct rp_pkt_interrupt_vec *vec = &pkt->interrupt_vec;
+    uint32_t *changed = rp_interrupt_vec_changed(vec);
+    uint32_t *levels = rp_interrupt_vec_levels(vec);
+    /* Words past the last line can only hold errors.  */
+    uint32_t nwords = MIN(vec->nwords, DIV_ROUND_UP(s->num_gpios, 32));
+    uint32_t w;
+
+    trace_remote_port_gpio_rx_interrupt_vec(pkt->hdr.id, pkt->hdr.flags,
+                                            pkt->hdr.dev, vec->nwords);
+
+    for (w = 0; w < nwords; w++) {
+        uint32_t c = changed[w];
+
+        while (c) {
+            int bit = ctz32(c);
+            uint64_t line = (uint64_t)vec->base + w * 32 + bit;
+
+            c &= c - 1;
+            if (line >= s->num_gpios) {
+                qemu_log_mask(LOG_GUEST_ERROR,
+                              "%s: update of nonexistent line %" PRIu64 "\n",
+                              TYPE_REMOTE_PORT_GPIO, line);
+                continue;
+            }
+            qemu_set_irq(s->gpio_out[line], (levels[w] >> bit) & 1);
+        }
+    }
+
+    if (s->peer->caps.wire_posted_updates
+        && !(pkt->hdr.flags & RP_PKT_FLAGS_posted)) {
+        RemotePortDynPkt rsp = {0};
+        size_t len;
+
+        /* Need to reply, echo the update.  */
+        rp_dpkt_alloc(&rsp, sizeof(struct rp_pkt_interrupt_vec) +
+                            vec->nwords * 2 * sizeof(uint32_t));
+        len = rp_encode_interrupt_vec(pkt->hdr.id, pkt->hdr.dev,
+                                      &rsp.pkt->interrupt_vec,
+                                      vec->timestamp, vec->base, vec->nwords,
+                                      changed, levels,
+                                      pkt->hdr.flags | RP_PKT_FLAGS_response);
+
+        trace_remote_port_gpio_tx_interrupt_vec(pkt->hdr.id,
+            pkt->hdr.flags | RP_PKT_FLAGS_response, pkt->hdr.dev,
+            vec->nwords);
+
+        rp_write(s->rp, (void *)rsp.pkt, len);
+        rp_dpkt_free(&rsp);
+    }
+}
+
 static void rp_gpio_reset(DeviceState *dev)
 {
     RemotePortGPIO *s = REMOTE_PORT_GPIO(dev);
 
     /* Mark as invalid.  */
     memset(s->cache, CACHE_INVALID, s->num_gpios);
+
+    /* Drop updates that didn't make it out.  */
+    s->batch.pending = false;
+    qemu_bh_cancel(s->batch.bh);
+    memset(s->batch.changed, 0, sizeof s->batch.changed);
+    memset(s->batch.levels, 0, sizeof s->batch.levels);
 }
 
 static void rp_gpio_realize(DeviceState *dev, Error **errp)
@@ -119,7 +307,14 @@ static void rp_gpio_realize(DeviceState *dev, Error **errp)
     RemotePortGPIO *s = REMOTE_PORT_GPIO(dev);
     unsigned int i;
 
+    if (s->num_gpios > MAX_GPIOS) {
+        error_setg(errp, "%s: num-gpios %u too large! MAX is %d",
+                   TYPE_REMOTE_PORT_GPIO, s->num_gpios, MAX_GPIOS);
+        return;
+    }
+
     s->peer = rp_get_peer(s->rp);
+    s->batch.bh = qemu_bh_new(rp_gpio_batch_bh, s);
 
     s->gpio_out = g_new0(qemu_irq, s->num_gpios);
     qdev_init_gpio_out(dev, s->gpio_out, s->num_gpios);
@@ -146,6 +341,8 @@ static Property rp_properties[] = {
     DEFINE_PROP_UINT16("cell-offset-irq-num", RemotePortGPIO,
                        cell_offset_irq_num, 0),
     DEFINE_PROP_BOOL("posted-updates", RemotePortGPIO, posted_updates, true),
+    DEFINE_PROP_BOOL("batch-updates", RemotePortGPIO, batch_updates, false),
+    DEFINE_PROP_BOOL("coalesce", RemotePortGPIO, coalesce, false),
     DEFINE_PROP_END_OF_LIST(),
 };
 
@@ -173,6 +370,7 @@ static void rp_gpio_class_init(ObjectClass *oc, void *data)
     FDTGenericIntcClass *fgic = FDT_GENERIC_INTC_CLASS(oc);
 
     rpdc->ops[RP_CMD_interrupt] = rp_gpio_interrupt;
+    rpdc->ops[RP_CMD_interrupt_vec] = rp_gpio_interrupt_vec;
     dc->reset = rp_gpio_reset;
     dc->realize = rp_gpio_realize;
     device_class_set_props(dc, rp_properties);
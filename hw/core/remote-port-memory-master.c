@@ -12,9 +12,13 @@
 #include "qemu/log.h"
 #include "qapi/qmp/qerror.h"
 #include "qapi/error.h"
+#include "qapi/qapi-builtin-visit.h"
+#include "qapi/visitor.h"
 #include "hw/sysbus.h"
 #include "migration/vmstate.h"
 #include "hw/qdev-properties.h"
+#include "sysemu/cpu-timers.h"
+#include "hw/core/cpu.h"
 #include "trace.h"
 
 #include "hw/remote-port-proto.h"
@@ -43,11 +47,11 @@
 
 #define RP_MAX_ACCESS_SIZE 4096
 
-MemTxResult rp_mm_access_with_def_attr(RemotePort *rp, uint32_t rp_dev,
-                                       struct rp_peer_state *peer,
-                                       MemoryTransaction *tr,
-                                       bool relative, uint64_t offset,
-                                       uint32_t def_attr)
+MemTxResult rp_mm_access_timed(RemotePort *rp, uint32_t rp_dev,
+                               struct rp_peer_state *peer,
+                               MemoryTransaction *tr,
+                               bool relative, uint64_t offset,
+                               uint32_t def_attr, int64_t *latency)
 {
     uint64_t addr = tr->addr;
     RemotePortRespSlot *rsp_slot;
@@ -127,6 +131,10 @@ MemTxResult rp_mm_access_with_def_attr(RemotePort *rp, uint32_t rp_dev,
         }
     }
 
+    if (latency) {
+        *latency = rsp->pkt->busaccess.timestamp - in.clk;
+    }
+
     trace_remote_port_memory_master_rx_busaccess(
         rp_cmd_to_string(rsp->pkt->hdr.cmd), rsp->pkt->hdr.id,
         rsp->pkt->hdr.flags, rsp->pkt->hdr.dev, rsp->pkt->busaccess.addr,
@@ -156,6 +164,16 @@ MemTxResult rp_mm_access_with_def_attr(RemotePort *rp, uint32_t rp_dev,
     return ret;
 }
 
+MemTxResult rp_mm_access_with_def_attr(RemotePort *rp, uint32_t rp_dev,
+                                       struct rp_peer_state *peer,
+                                       MemoryTransaction *tr,
+                                       bool relative, uint64_t offset,
+                                       uint32_t def_attr)
+{
+    return rp_mm_access_timed(rp, rp_dev, peer, tr, relative, offset,
+                              def_attr, NULL);
+}
+
 MemTxResult rp_mm_access(RemotePort *rp, uint32_t rp_dev,
                          struct rp_peer_state *peer,
                          MemoryTransaction *tr,
@@ -165,13 +183,64 @@ MemTxResult rp_mm_access(RemotePort *rp, uint32_t rp_dev,
                                       0);
 }
 
+static void rp_account_latency(RemotePortMemoryMaster *s, MemoryTransaction *tr,
+                               int64_t latency)
+{
+    int bucket = 0;
+
+    if (latency <= 0) {
+        /* Peer doesn't annotate, or its clock went backwards.  */
+        return;
+    }
+
+    s->latency.count++;
+    s->latency.total_ns += latency;
+    s->latency.max_ns = MAX(s->latency.max_ns, latency);
+    if (latency >= 1024) {
+        bucket = MIN(63 - clz64(latency) - 9, RP_LATENCY_BUCKETS - 1);
+    }
+    s->latency.hist[bucket]++;
+
+    if (current_cpu) {
+        GArray *per_cpu = s->latency.per_cpu_ns;
+        unsigned int idx = current_cpu->cpu_index;
+
+        if (idx >= per_cpu->len) {
+            g_array_set_size(per_cpu, idx + 1);
+        }
+        g_array_index(per_cpu, uint64_t, idx) += latency;
+    }
+
+    trace_remote_port_memory_master_latency(s->rp_dev, tr->addr, tr->rw,
+                                            current_cpu ?
+                                            current_cpu->cpu_index : -1,
+                                            latency);
+
+    /*
+     * The issuing vCPU was blocked for the annotated latency. Under icount
+     * virtual time only moves with instructions, so stall it explicitly.
+     */
+    if (icount_enabled()) {
+        icount_stall(latency);
+    }
+}
+
 static MemTxResult rp_access(MemoryTransaction *tr)
 {
     RemotePortMap *map = tr->opaque;
     RemotePortMemoryMaster *s = map->parent;
+    int64_t latency;
+    MemTxResult ret;
+
+    if (!s->annotate_timing) {
+        return rp_mm_access(s->rp, s->rp_dev, s->peer, tr, s->relative,
+                            map->offset);
+    }
 
-    return rp_mm_access(s->rp, s->rp_dev, s->peer, tr, s->relative,
-                        map->offset);
+    ret = rp_mm_access_timed(s->rp, s->rp_dev, s->peer, tr, s->relative,
+                             map->offset, 0, &latency);
+    rp_account_latency(s, tr, latency);
+    return ret;
 }
 
 static const MemoryRegionOps rp_ops_template = {
@@ -226,6 +295,37 @@ static void rp_memory_master_realize(DeviceState *dev, Error **errp)
     }
 }
 
+static void rp_get_latency_histogram(Object *obj, Visitor *v,
+                                     const char *name, void *opaque,
+                                     Error **errp)
+{
+    RemotePortMemoryMaster *s = REMOTE_PORT_MEMORY_MASTER(obj);
+    uint64List *list = NULL;
+    int i;
+
+    for (i = RP_LATENCY_BUCKETS - 1; i >= 0; i--) {
+        QAPI_LIST_PREPEND(list, s->latency.hist[i]);
+    }
+    visit_type_uint64List(v, name, &list, errp);
+    qapi_free_uint64List(list);
+}
+
+static void rp_get_latency_per_cpu(Object *obj, Visitor *v,
+                                   const char *name, void *opaque,
+                                   Error **errp)
+{
+    RemotePortMemoryMaster *s = REMOTE_PORT_MEMORY_MASTER(obj);
+    GArray *per_cpu = s->latency.per_cpu_ns;
+    uint64List *list = NULL;
+    int i;
+
+    for (i = per_cpu->len - 1; i >= 0; i--) {
+        QAPI_LIST_PREPEND(list, g_array_index(per_cpu, uint64_t, i));
+    }
+    visit_type_uint64List(v, name, &list, errp);
+    qapi_free_uint64List(list);
+}
+
 static void rp_memory_master_init(Object *obj)
 {
     RemotePortMemoryMaster *rpms = REMOTE_PORT_MEMORY_MASTER(obj);
@@ -233,6 +333,26 @@ static void rp_memory_master_init(Object *obj)
                              (Object **)&rpms->rp,
                              qdev_prop_allow_set_link,
                              OBJ_PROP_LINK_STRONG);
+
+    rpms->latency.per_cpu_ns = g_array_new(false, true, sizeof(uint64_t));
+    object_property_add_uint64_ptr(obj, "latency-count",
+                                   &rpms->latency.count, OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "latency-total-ns",
+                                   &rpms->latency.total_ns,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "latency-max-ns",
+                                   &rpms->latency.max_ns, OBJ_PROP_FLAG_READ);
+    object_property_add(obj, "latency-histogram", "uint64List",
+                        rp_get_latency_histogram, NULL, NULL, NULL);
+    object_property_add(obj, "latency-per-cpu-ns", "uint64List",
+                        rp_get_latency_per_cpu, NULL, NULL, NULL);
+}
+
+static void rp_memory_master_finalize(Object *obj)
+{
+    RemotePortMemoryMaster *rpms = REMOTE_PORT_MEMORY_MASTER(obj);
+
+    g_array_free(rpms->latency.per_cpu_ns, true);
 }
 
 static bool rp_parse_reg(FDTGenericMMap *obj, FDTGenericRegPropInfo reg,
@@ -272,6 +392,8 @@ static Property rp_properties[] = {
     DEFINE_PROP_BOOL("relative", RemotePortMemoryMaster, relative, false),
     DEFINE_PROP_UINT32("max-access-size", RemotePortMemoryMaster,
                        max_access_size, RP_MAX_ACCESS_SIZE),
+    DEFINE_PROP_BOOL("annotate-timing", RemotePortMemoryMaster,
+                     annotate_timing, false),
     DEFINE_PROP_END_OF_LIST()
 };
 
@@ -289,6 +411,7 @@ static const TypeInfo rp_info = {
     .parent        = TYPE_SYS_BUS_DEVICE,
     .instance_size = sizeof(RemotePortMemoryMaster),
     .instance_init = rp_memory_master_init,
+    .instance_finalize = rp_memory_master_finalize,
     .class_init    = rp_memory_master_class_init,
     .interfaces    = (InterfaceInfo[]) {
         { TYPE_FDT_GENERIC_MMAP },
@@ -25,6 +25,7 @@
 
 #include "hw/remote-port-proto.h"
 #include "hw/remote-port-device.h"
+#include "hw/remote-port.h"
 #include "hw/remote-port-memory-slave.h"
 
 #ifndef REMOTE_PORT_ERR_DEBUG
@@ -40,31 +41,34 @@
     } \
 } while (0);
 
-/* Slow path dealing with odd stuff like byte-enables.  */
+/*
+ * Slow path dealing with odd stuff like byte-enables and streaming.
+ * Enabled bytes are grouped into runs that are contiguous on the bus,
+ * so a partial strobe or a FIFO-style stream costs one DMA operation
+ * per run or beat instead of one per byte.
+ */
 static MemTxResult process_data_slow(RemotePortMemorySlave *s,
                                      AddressSpace *as,
                                      struct rp_pkt *pkt,
                                      DMADirection dir,
                                      uint8_t *data, uint8_t *byte_en)
 {
-    unsigned int i;
-    unsigned int byte_en_len = pkt->busaccess_ext_base.byte_enable_len;
-    unsigned int sw = pkt->busaccess.stream_width;
+    uint32_t byte_en_len = pkt->busaccess_ext_base.byte_enable_len;
+    uint32_t sw = pkt->busaccess.stream_width;
+    uint32_t pos = 0;
+    uint32_t run;
     MemTxResult ret = MEMTX_OK;
 
     assert(sw);
 
-    for (i = 0; i < pkt->busaccess.len; i++) {
-        if (byte_en && !byte_en[i % byte_en_len]) {
-            continue;
-        }
-
-        ret = dma_memory_rw_attr(as, pkt->busaccess.addr + i % sw,
-                                 data + i, 1, dir, s->attr);
-
+    while ((run = rp_busaccess_next_run(&pos, pkt->busaccess.len, sw,
+                                        byte_en, byte_en_len))) {
+        ret = dma_memory_rw_attr(as, pkt->busaccess.addr + pos % sw,
+                                 data + pos, run, dir, s->attr);
         if (ret != MEMTX_OK) {
             break;
         }
+        pos += run;
     }
 
     return ret;
@@ -151,10 +155,12 @@ static void rp_cmd_rw(RemotePortMemorySlave *s, struct rp_pkt *pkt,
         qemu_hexdump(stderr, ": read: ",
                      (const char *) data, pkt->busaccess.len);
     }
-    /* delay here could be set to the annotated cost of doing issuing
-       these accesses. QEMU doesn't support this kind of annotations
-       at the moment. So we just clear the delay.  */
-    delay = 0;
+    /*
+     * Annotate the configured cost of the access. QEMU doesn't model bus
+     * timing itself, so this defaults to zero.
+     */
+    delay = dir == DMA_DIRECTION_TO_DEVICE ? s->read_latency
+                                           : s->write_latency;
 
     rp_encode_busaccess_in_rsp_init(&in, pkt);
     in.clk = pkt->busaccess.timestamp + delay;
@@ -181,12 +187,197 @@ static void rp_cmd_rw(RemotePortMemorySlave *s, struct rp_pkt *pkt,
     rp_write(s->rp, (void *)s->rsp.pkt, enclen);
 }
 
+/*
+ * Direct memory interface.
+ *
+ * The peer may ask for direct access to RAM that is backed by a shared
+ * file (e.g. RAM created under -machine-path). Grants cover the flat
+ * range containing the requested address and are revoked as soon as that
+ * part of the memory map changes. Ranges behind an IOMMU or XMPU are not
+ * RAM in the flat view and are never granted, so those keep going
+ * through rp_cmd_rw().
+ *
+ * Note that QEMU does not see accesses made through a grant: writes
+ * neither mark pages dirty nor invalidate translated code.
+ *
+ * Invalidations are sent from the memory listener and wait for the
+ * peer's acknowledgement, so the peer stops using a range before the
+ * new map takes effect. No grants are handed out while one is pending.
+ */
+static char *rp_dmi_backing_path(MemoryRegion *mr)
+{
+#ifdef CONFIG_LINUX
+    g_autofree char *link = NULL;
+    char *path;
+    int fd = memory_region_get_fd(mr);
+
+    /* The peer must see our stores, so private mappings won't do.  */
+    if (fd < 0 || !qemu_ram_is_shared(mr->ram_block)) {
+        return NULL;
+    }
+    link = g_strdup_printf("/proc/self/fd/%d", fd);
+    path = g_file_read_link(link, NULL);
+
+    /* memfd and unlinked files cannot be opened by the peer.  */
+    if (path && (path[0] != '/' || g_str_has_prefix(path, "/memfd:") ||
+                 g_str_has_suffix(path, " (deleted)"))) {
+        g_free(path);
+        path = NULL;
+    }
+    return path;
+#else
+    return NULL;
+#endif
+}
+
+static void rp_dmi_invalidate(RemotePortMemorySlave *s,
+                              RemotePortDMIGrant *grant)
+{
+    struct rp_pkt_dmi pkt;
+    RemotePortRespSlot *rsp_slot;
+    size_t enclen;
+    uint32_t id;
+
+    id = rp_new_id(s->rp);
+    enclen = rp_encode_dmi_inv(id, s->dmi.dev, &pkt,
+                               rp_normalized_vmclk(s->rp),
+                               grant->addr, grant->len, 0);
+    trace_remote_port_memory_slave_dmi_inv(s->dmi.dev, grant->addr,
+                                           grant->len);
+
+    rp_rsp_mutex_lock(s->rp);
+    rp_write(s->rp, (void *) &pkt, enclen);
+
+    rsp_slot = rp_dev_wait_resp(s->rp, s->dmi.dev, id);
+    assert(rsp_slot->rsp.pkt->hdr.id == id);
+    rp_resp_slot_done(s->rp, rsp_slot);
+    rp_rsp_mutex_unlock(s->rp);
+}
+
+static void rp_dmi_region_del(MemoryListener *listener,
+                              MemoryRegionSection *section)
+{
+    RemotePortMemorySlave *s = container_of(listener, RemotePortMemorySlave,
+                                            dmi.listener);
+    hwaddr start = section->offset_within_address_space;
+    hwaddr last = start + int128_get64(int128_sub(section->size,
+                                                  int128_one()));
+    int i;
+
+    /*
+     * The new map is not visible until we return, so the peer has
+     * dropped the grant by the time it is. Waiting for the peer runs
+     * other packets, which may change the grants; rescan after each one.
+     */
+    s->dmi.revoking++;
+    i = 0;
+    while (i < s->dmi.grants->len) {
+        RemotePortDMIGrant g = g_array_index(s->dmi.grants,
+                                             RemotePortDMIGrant, i);
+
+        if (g.addr <= last && start <= g.addr + g.len - 1) {
+            g_array_remove_index_fast(s->dmi.grants, i);
+            rp_dmi_invalidate(s, &g);
+            i = 0;
+        } else {
+            i++;
+        }
+    }
+    s->dmi.revoking--;
+}
+
+static void rp_dmi_add_grant(RemotePortMemorySlave *s, hwaddr addr,
+                             hwaddr len)
+{
+    RemotePortDMIGrant grant = { .addr = addr, .len = len };
+    int i;
+
+    for (i = 0; i < s->dmi.grants->len; i++) {
+        RemotePortDMIGrant *g = &g_array_index(s->dmi.grants,
+                                               RemotePortDMIGrant, i);
+
+        if (g->addr == addr && g->len == len) {
+            return;
+        }
+    }
+    g_array_append_val(s->dmi.grants, grant);
+
+    if (!s->dmi.listening) {
+        s->dmi.listener = (MemoryListener) {
+            .name = "remote-port-dmi",
+            .region_del = rp_dmi_region_del,
+        };
+        memory_listener_register(&s->dmi.listener, &s->as);
+        s->dmi.listening = true;
+    }
+}
+
+static void rp_memory_slave_dmi_req(RemotePortDevice *dev, struct rp_pkt *pkt)
+{
+    RemotePortMemorySlave *s = REMOTE_PORT_MEMORY_SLAVE(dev);
+    uint64_t want = pkt->dmi.len ? pkt->dmi.len : UINT64_MAX - pkt->dmi.addr;
+    g_autofree char *path = NULL;
+    uint32_t result = RP_DMI_RESULT_error;
+    uint64_t attr = 0, addr = 0, len = 0, file_offset = 0;
+    uint32_t path_len = 0;
+    MemoryRegionSection sec;
+    size_t pktlen;
+    size_t enclen;
+
+    assert(!(pkt->hdr.flags & RP_PKT_FLAGS_response));
+    s->dmi.dev = pkt->hdr.dev;
+
+    sec = memory_region_find(s->as.root, pkt->dmi.addr, want ? want : 1);
+    if (sec.mr && !s->dmi.revoking) {
+        if (memory_region_is_ram(sec.mr) &&
+            !memory_region_is_ram_device(sec.mr)) {
+            path = rp_dmi_backing_path(sec.mr);
+        }
+        if (path) {
+            attr = RP_DMI_ATTR_read;
+            if (!sec.readonly) {
+                attr |= RP_DMI_ATTR_write;
+            }
+            attr &= pkt->dmi.attributes;
+        }
+        if (attr) {
+            uint8_t *host = memory_region_get_ram_ptr(sec.mr);
+
+            addr = sec.offset_within_address_space;
+            len = int128_get64(sec.size);
+            file_offset = host + sec.offset_within_region -
+                          (uint8_t *)qemu_ram_get_host_addr(sec.mr->ram_block);
+            path_len = strlen(path) + 1;
+            result = RP_DMI_RESULT_ok;
+            rp_dmi_add_grant(s, addr, len);
+        }
+    }
+    if (sec.mr) {
+        memory_region_unref(sec.mr);
+    }
+
+    trace_remote_port_memory_slave_dmi_req(pkt->hdr.dev, pkt->dmi.addr,
+                                           addr, len, attr);
+
+    pktlen = sizeof pkt->dmi + path_len;
+    rp_dpkt_alloc(&s->rsp, pktlen);
+    enclen = rp_encode_dmi_resp(pkt->hdr.id, pkt->hdr.dev, &s->rsp.pkt->dmi,
+                                pkt->dmi.timestamp, attr, addr, len,
+                                file_offset, result, path_len,
+                                pkt->hdr.flags);
+    if (path_len) {
+        memcpy(rp_dmi_pathptr(&s->rsp.pkt->dmi), path, path_len);
+    }
+    rp_write(s->rp, (void *)s->rsp.pkt, enclen + path_len);
+}
+
 static void rp_memory_slave_realize(DeviceState *dev, Error **errp)
 {
     RemotePortMemorySlave *s = REMOTE_PORT_MEMORY_SLAVE(dev);
 
     s->peer = rp_get_peer(s->rp);
     address_space_init(&s->as, s->mr ? s->mr : get_system_memory(), "dma");
+    s->dmi.grants = g_array_new(false, false, sizeof(RemotePortDMIGrant));
 }
 
 static void rp_memory_slave_write(RemotePortDevice *s, struct rp_pkt *pkt)
@@ -201,6 +392,44 @@ static void rp_memory_slave_read(RemotePortDevice *s, struct rp_pkt *pkt)
                      DMA_DIRECTION_TO_DEVICE);
 }
 
+/*
+ * Plain RAM accesses can be served from a remote-port dispatch thread.
+ * Anything else could need the BQL, which a vCPU waiting on the peer may
+ * be holding, so it stays in the main loop.
+ */
+static bool rp_memory_slave_dispatch_lockless(RemotePortDevice *dev,
+                                              struct rp_pkt *pkt)
+{
+    RemotePortMemorySlave *s = REMOTE_PORT_MEMORY_SLAVE(dev);
+    bool is_write = pkt->hdr.cmd == RP_CMD_write;
+    MemTxAttrs attrs = {
+        .secure = !!(pkt->busaccess.attributes & RP_BUS_ATTR_SECURE),
+        .requester_id = pkt->busaccess.master_id,
+    };
+    hwaddr len = pkt->busaccess.len;
+    hwaddr plen, xlat;
+    MemoryRegion *mr;
+
+    if (!is_write && pkt->hdr.cmd != RP_CMD_read) {
+        return false;
+    }
+    /* The ATS cache and the physical address spaces are main loop state.  */
+    if (s->ats_cache ||
+        (pkt->busaccess.attributes & RP_BUS_ATTR_PHYS_ADDR)) {
+        return false;
+    }
+
+    if (pkt->busaccess.stream_width) {
+        len = MIN(len, pkt->busaccess.stream_width);
+    }
+    plen = len;
+
+    RCU_READ_LOCK_GUARD();
+    mr = address_space_translate(&s->as, pkt->busaccess.addr, &xlat, &plen,
+                                 is_write, attrs);
+    return plen >= len && memory_access_is_direct(mr, is_write);
+}
+
 static void rp_memory_slave_init(Object *obj)
 {
     RemotePortMemorySlave *rpms = REMOTE_PORT_MEMORY_SLAVE(obj);
@@ -223,9 +452,22 @@ static void rp_memory_slave_unrealize(DeviceState *dev)
 {
     RemotePortMemorySlave *s = REMOTE_PORT_MEMORY_SLAVE(dev);
 
+    if (s->dmi.listening) {
+        /* Don't send invalidations to a peer that is going away.  */
+        g_array_set_size(s->dmi.grants, 0);
+        memory_listener_unregister(&s->dmi.listener);
+    }
+    g_array_free(s->dmi.grants, true);
     address_space_destroy(&s->as);
 }
 
+static Property rp_properties[] = {
+    DEFINE_PROP_UINT64("read-latency", RemotePortMemorySlave, read_latency, 0),
+    DEFINE_PROP_UINT64("write-latency", RemotePortMemorySlave, write_latency,
+                       0),
+    DEFINE_PROP_END_OF_LIST()
+};
+
 static void rp_memory_slave_class_init(ObjectClass *oc, void *data)
 {
     RemotePortDeviceClass *rpdc = REMOTE_PORT_DEVICE_CLASS(oc);
@@ -233,8 +475,11 @@ static void rp_memory_slave_class_init(ObjectClass *oc, void *data)
 
     rpdc->ops[RP_CMD_write] = rp_memory_slave_write;
     rpdc->ops[RP_CMD_read] = rp_memory_slave_read;
+    rpdc->ops[RP_CMD_dmi_req] = rp_memory_slave_dmi_req;
+    rpdc->dispatch_lockless = rp_memory_slave_dispatch_lockless;
     dc->realize = rp_memory_slave_realize;
     dc->unrealize = rp_memory_slave_unrealize;
+    device_class_set_props(dc, rp_properties);
 }
 
 static const TypeInfo rp_info = {
@@ -100,6 +100,9 @@ static const char *rp_cmd_names[RP_CMD_max + 1] = {
     [RP_CMD_sync] = "sync",
     [RP_CMD_ats_req] = "ats_request",
     [RP_CMD_ats_inv] = "ats_invalidation",
+    [RP_CMD_dmi_req] = "dmi_request",
+    [RP_CMD_dmi_inv] = "dmi_invalidation",
+    [RP_CMD_interrupt_vec] = "interrupt_vector",
 };
 
 const char *rp_cmd_to_string(enum rp_cmd cmd)
@@ -196,6 +199,35 @@ int rp_decode_payload(struct rp_pkt *pkt)
         pkt->interrupt.val = pkt->interrupt.val;
         used += pkt->hdr.len;
         break;
+    case RP_CMD_interrupt_vec:
+    {
+        uint32_t *words = rp_interrupt_vec_changed(&pkt->interrupt_vec);
+        uint32_t i;
+
+        assert(pkt->hdr.len >= sizeof pkt->interrupt_vec - sizeof pkt->hdr);
+        pkt->interrupt_vec.timestamp = be64toh(pkt->interrupt_vec.timestamp);
+        pkt->interrupt_vec.base = be32toh(pkt->interrupt_vec.base);
+        pkt->interrupt_vec.nwords = be32toh(pkt->interrupt_vec.nwords);
+        /*
+         * Each word has a changed and a level bitmap. Drop the update of a
+         * packet too short for its bitmaps rather than read past its end.
+         */
+        if (pkt->interrupt_vec.nwords >
+            (pkt->hdr.len - (sizeof pkt->interrupt_vec - sizeof pkt->hdr)) /
+            (2 * sizeof *words)) {
+            pkt->interrupt_vec.nwords = 0;
+        }
+        for (i = 0; i < pkt->interrupt_vec.nwords * 2; i++) {
+            uint32_t w;
+
+            /* The bitmaps aren't necessarily aligned.  */
+            memcpy(&w, &words[i], sizeof w);
+            w = be32toh(w);
+            memcpy(&words[i], &w, sizeof w);
+        }
+        used += pkt->hdr.len;
+        break;
+    }
     case RP_CMD_sync:
         pkt->sync.timestamp = be64toh(pkt->interrupt.timestamp);
         used += pkt->hdr.len;
@@ -207,6 +239,18 @@ int rp_decode_payload(struct rp_pkt *pkt)
         pkt->ats.len = be64toh(pkt->ats.len);
         pkt->ats.result = be32toh(pkt->ats.result);
         break;
+    case RP_CMD_dmi_req:
+    case RP_CMD_dmi_inv:
+        assert(pkt->hdr.len >= sizeof pkt->dmi - sizeof pkt->hdr);
+        pkt->dmi.timestamp = be64toh(pkt->dmi.timestamp);
+        pkt->dmi.attributes = be64toh(pkt->dmi.attributes);
+        pkt->dmi.addr = be64toh(pkt->dmi.addr);
+        pkt->dmi.len = be64toh(pkt->dmi.len);
+        pkt->dmi.result = be32toh(pkt->dmi.result);
+        pkt->dmi.file_offset = be64toh(pkt->dmi.file_offset);
+        pkt->dmi.path_len = be32toh(pkt->dmi.path_len);
+        used += pkt->hdr.len;
+        break;
     default:
         break;
     }
@@ -392,6 +436,32 @@ size_t rp_encode_interrupt(uint32_t id, uint32_t dev,
     return rp_encode_interrupt_f(id, dev, pkt, clk, line, vector, val, 0);
 }
 
+size_t rp_encode_interrupt_vec(uint32_t id, uint32_t dev,
+                               struct rp_pkt_interrupt_vec *pkt,
+                               int64_t clk, uint32_t base, uint32_t nwords,
+                               const uint32_t *changed,
+                               const uint32_t *levels,
+                               uint32_t flags)
+{
+    uint32_t *words = rp_interrupt_vec_changed(pkt);
+    size_t bitmaps = nwords * 2 * sizeof *words;
+    uint32_t i;
+
+    rp_encode_hdr(&pkt->hdr, RP_CMD_interrupt_vec, id, dev,
+                  sizeof *pkt - sizeof pkt->hdr + bitmaps, flags);
+    pkt->timestamp = htobe64(clk);
+    pkt->base = htobe32(base);
+    pkt->nwords = htobe32(nwords);
+    for (i = 0; i < nwords; i++) {
+        uint32_t c = htobe32(changed[i]);
+        uint32_t l = htobe32(levels[i]);
+
+        memcpy(&words[i], &c, sizeof c);
+        memcpy(&words[nwords + i], &l, sizeof l);
+    }
+    return sizeof *pkt + bitmaps;
+}
+
 static size_t rp_encode_ats_common(uint32_t cmd, uint32_t id, uint32_t dev,
                          struct rp_pkt_ats *pkt,
                          int64_t clk, uint64_t attr, uint64_t addr,
@@ -427,6 +497,47 @@ size_t rp_encode_ats_inv(uint32_t id, uint32_t dev,
                                 addr, len, result, flags);
 }
 
+static size_t rp_encode_dmi_common(uint32_t cmd, uint32_t id, uint32_t dev,
+                                   struct rp_pkt_dmi *pkt,
+                                   int64_t clk, uint64_t attr, uint64_t addr,
+                                   uint64_t len, uint64_t file_offset,
+                                   uint32_t result, uint32_t path_len,
+                                   uint32_t flags)
+{
+    rp_encode_hdr(&pkt->hdr, cmd, id, dev,
+                  sizeof *pkt - sizeof pkt->hdr + path_len, flags);
+    pkt->timestamp = htobe64(clk);
+    pkt->attributes = htobe64(attr);
+    pkt->addr = htobe64(addr);
+    pkt->len = htobe64(len);
+    pkt->result = htobe32(result);
+    pkt->file_offset = htobe64(file_offset);
+    pkt->path_len = htobe32(path_len);
+    pkt->reserved0 = 0;
+    return sizeof *pkt;
+}
+
+size_t rp_encode_dmi_resp(uint32_t id, uint32_t dev,
+                          struct rp_pkt_dmi *pkt,
+                          int64_t clk, uint64_t attr, uint64_t addr,
+                          uint64_t len, uint64_t file_offset,
+                          uint32_t result, uint32_t path_len,
+                          uint32_t flags)
+{
+    return rp_encode_dmi_common(RP_CMD_dmi_req, id, dev, pkt, clk, attr,
+                                addr, len, file_offset, result, path_len,
+                                flags | RP_PKT_FLAGS_response);
+}
+
+size_t rp_encode_dmi_inv(uint32_t id, uint32_t dev,
+                         struct rp_pkt_dmi *pkt,
+                         int64_t clk, uint64_t addr, uint64_t len,
+                         uint32_t flags)
+{
+    return rp_encode_dmi_common(RP_CMD_dmi_inv, id, dev, pkt, clk, 0,
+                                addr, len, 0, 0, 0, flags);
+}
+
 static size_t rp_encode_sync_common(uint32_t id, uint32_t dev,
                                     struct rp_pkt_sync *pkt,
                                     int64_t clk, uint32_t flags)
@@ -476,6 +587,12 @@ void rp_process_caps(struct rp_peer_state *peer,
         case CAP_ATS:
             peer->caps.ats = true;
             break;
+        case CAP_DMI:
+            peer->caps.dmi = true;
+            break;
+        case CAP_WIRE_VECTOR:
+            peer->caps.wire_vector = true;
+            break;
         }
     }
 }
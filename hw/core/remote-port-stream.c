@@ -147,6 +147,7 @@ static size_t rp_stream_stream_push(StreamSink *obj, uint8_t *buf,
     struct rp_pkt_busaccess_ext_base pkt;
     struct rp_encode_busaccess_in in = {0};
     uint64_t rp_attr = eop ? RP_BUS_ATTR_EOP : 0;
+    struct iovec iov[2];
     int64_t clk;
     int enclen;
 
@@ -164,9 +165,13 @@ static size_t rp_stream_stream_push(StreamSink *obj, uint8_t *buf,
     trace_remote_port_stream_tx_busaccess(rp_cmd_to_string(in.cmd),
         in.id, in.flags, in.dev, in.addr, in.size, in.attr);
 
+    iov[0].iov_base = &pkt;
+    iov[0].iov_len = enclen;
+    iov[1].iov_base = buf;
+    iov[1].iov_len = len;
+
     rp_rsp_mutex_lock(s->rp);
-    rp_write(s->rp, (void *) &pkt, enclen);
-    rp_write(s->rp, buf, len);
+    rp_writev(s->rp, iov, 2);
     rsp = rp_wait_resp(s->rp);
     assert(rsp.pkt->hdr.id == be32_to_cpu(pkt.hdr.id));
 
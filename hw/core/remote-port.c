@@ -18,7 +18,10 @@
 #include "hw/hw.h"
 #include "hw/ptimer.h"
 #include "qemu/sockets.h"
+#include "qemu/iov.h"
+#include "qemu/timer.h"
 #include "qemu/thread.h"
+#include "qemu/rcu.h"
 #include "qemu/log.h"
 #include "qapi/error.h"
 #include "qemu/error-report.h"
@@ -128,11 +131,117 @@ static void rp_fatal_error(RemotePort *s, const char *reason)
     exit(EXIT_FAILURE);
 }
 
+/*
+ * Native socket transport, used instead of the chardev when the "socket"
+ * property is set. Keeping the fd to ourselves lets us tune the socket
+ * for latency and push several buffers per syscall.
+ */
+static ssize_t rp_sock_recv(RemotePort *s, void *buf, size_t count)
+{
+    uint8_t *p = buf;
+    size_t done = 0;
+    int64_t deadline = 0;
+
+    while (done < count) {
+        ssize_t r;
+
+#ifdef MSG_DONTWAIT
+        if (s->sock.busy_poll) {
+            /*
+             * Spin for a while before sleeping in the kernel, a response
+             * from a peer on a nearby host typically arrives well within
+             * the wake-up latency of a blocked thread.
+             */
+            r = recv(s->sock.fd, p + done, count - done, MSG_DONTWAIT);
+            if (r < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                int64_t now = get_clock();
+
+                if (!deadline) {
+                    deadline = now + s->sock.busy_poll * SCALE_US;
+                }
+                if (now < deadline) {
+                    continue;
+                }
+                r = recv(s->sock.fd, p + done, count - done, 0);
+            }
+        } else
+#endif
+        {
+            r = recv(s->sock.fd, p + done, count - done, 0);
+        }
+        if (r < 0 && errno == EINTR) {
+            continue;
+        }
+        if (r <= 0) {
+            return done ? done : r;
+        }
+        done += r;
+        deadline = 0;
+    }
+    return done;
+}
+
+static int rp_sock_open(RemotePort *s, Error **errp)
+{
+    SocketAddress *addr;
+    int fd;
+
+    addr = socket_parse(s->sock.desc, errp);
+    if (!addr) {
+        return -1;
+    }
+
+    if (s->sock.server) {
+        int listen_fd = socket_listen(addr, 1, errp);
+
+        if (listen_fd < 0) {
+            qapi_free_SocketAddress(addr);
+            return -1;
+        }
+        info_report("%s: Waiting for a connection on %s", s->prefix,
+                    s->sock.desc);
+        do {
+            fd = qemu_accept(listen_fd, NULL, NULL);
+        } while (fd < 0 && errno == EINTR);
+        if (fd < 0) {
+            error_setg_errno(errp, errno, "Unable to accept on '%s'",
+                             s->sock.desc);
+        }
+        close(listen_fd);
+    } else {
+        fd = socket_connect(addr, errp);
+    }
+
+    if (fd >= 0) {
+        qemu_socket_set_block(fd);
+        if (addr->type == SOCKET_ADDRESS_TYPE_INET && s->sock.nodelay) {
+            socket_set_nodelay(fd);
+        }
+#ifdef SO_BUSY_POLL
+        if (s->sock.busy_poll) {
+            int v = s->sock.busy_poll;
+
+            /* Best effort, raising it may need CAP_NET_ADMIN.  */
+            if (setsockopt(fd, SOL_SOCKET, SO_BUSY_POLL, &v, sizeof v)) {
+                warn_report("%s: Unable to set SO_BUSY_POLL: %s",
+                            s->prefix, strerror(errno));
+            }
+        }
+#endif
+    }
+    qapi_free_SocketAddress(addr);
+    return fd;
+}
+
 static ssize_t rp_recv(RemotePort *s, void *buf, size_t count)
 {
     ssize_t r;
 
-    r = qemu_chr_fe_read_all(&s->chr, buf, count);
+    if (s->sock.fd >= 0) {
+        r = rp_sock_recv(s, buf, count);
+    } else {
+        r = qemu_chr_fe_read_all(&s->chr, buf, count);
+    }
     if (r <= 0) {
         return r;
     }
@@ -145,31 +254,85 @@ static ssize_t rp_recv(RemotePort *s, void *buf, size_t count)
     return r;
 }
 
-ssize_t rp_write(RemotePort *s, const void *buf, size_t count)
+ssize_t rp_writev(RemotePort *s, const struct iovec *iov, int iovcnt)
 {
-    ssize_t r;
+    size_t count = iov_size(iov, iovcnt);
+    ssize_t r = 0;
+    int i;
 
     qemu_mutex_lock(&s->write_mutex);
-    r = qemu_chr_fe_write_all(&s->chr, buf, count);
+    if (s->capture) {
+        /* Packets are at most split in a header and a payload.  */
+        assert(iovcnt <= 2);
+        rp_capture_pkt(s->capture, RP_CAPTURE_DIR_OUT, rp_normalized_vmclk(s),
+                       iov[0].iov_base, iov[0].iov_len,
+                       iovcnt > 1 ? iov[1].iov_base : NULL,
+                       iovcnt > 1 ? iov[1].iov_len : 0);
+    }
+    if (s->sock.fd >= 0) {
+        r = iov_send(s->sock.fd, iov, iovcnt, 0, count);
+    } else {
+        for (i = 0; i < iovcnt; i++) {
+            ssize_t n = qemu_chr_fe_write_all(&s->chr, iov[i].iov_base,
+                                              iov[i].iov_len);
+            if (n != iov[i].iov_len) {
+                r = n < 0 ? n : r + n;
+                break;
+            }
+            r += n;
+        }
+    }
+    if (r == count) {
+        s->stats.tx_packets++;
+        s->stats.tx_bytes += count;
+    }
     qemu_mutex_unlock(&s->write_mutex);
-    assert(r == count);
-    if (r <= 0) {
-        error_report("%s: Disconnected r=%zd buf=%p count=%zd\n",
-                     s->prefix, r, buf, count);
+    if (r != count) {
+        error_report("%s: Disconnected r=%zd count=%zd\n",
+                     s->prefix, r, count);
         rp_fatal_error(s, "Bad write");
     }
     return r;
 }
 
+ssize_t rp_write(RemotePort *s, const void *buf, size_t count)
+{
+    struct iovec iov = {
+        .iov_base = (void *)buf,
+        .iov_len = count,
+    };
+
+    return rp_writev(s, &iov, 1);
+}
+
 static unsigned int rp_has_work(RemotePort *s)
 {
-    unsigned int work = s->rx_queue.wpos - s->rx_queue.rpos;
-    return work;
+    unsigned int work = qatomic_load_acquire(&s->rx_queue.wpos) -
+                        qatomic_read(&s->rx_queue.rpos);
+    /* dispatch_bounced is under rsp_mutex, which callers hold.  */
+    return work + g_queue_get_length(&s->dispatch_bounced);
+}
+
+/*
+ * Sleep until the protocol thread makes progress. Called with rsp_mutex
+ * held. Registering as a waiter lets rp_pt_handover_pkt skip the mutex
+ * and the signal when nobody sleeps.
+ */
+static void rp_wait_progress(RemotePort *s)
+{
+    qatomic_inc(&s->rx_queue.waiters);
+    smp_mb();
+    if (!rp_has_work(s)) {
+        qemu_cond_wait(&s->progress_cond, &s->rsp_mutex);
+    }
+    qatomic_dec(&s->rx_queue.waiters);
 }
 
 /* Response handling.  */
 RemotePortRespSlot *rp_dev_wait_resp(RemotePort *s, uint32_t dev, uint32_t id)
 {
+    int64_t start = get_clock();
+    uint64_t rtt;
     int i;
 
     assert(s->devs[dev]);
@@ -199,10 +362,14 @@ RemotePortRespSlot *rp_dev_wait_resp(RemotePort *s, uint32_t dev, uint32_t id)
         if (s->dev_state[dev].rsp_queue[i].valid) {
             break;
         }
-        if (!rp_has_work(s)) {
-            qemu_cond_wait(&s->progress_cond, &s->rsp_mutex);
-        }
+        rp_wait_progress(s);
     }
+
+    /* Accounted under rsp_mutex, which callers hold on return.  */
+    rtt = get_clock() - start;
+    s->stats.rtt_count++;
+    s->stats.rtt_total_ns += rtt;
+    s->stats.rtt_max_ns = MAX(s->stats.rtt_max_ns, rtt);
     return &s->dev_state[dev].rsp_queue[i];
 }
 
@@ -217,9 +384,7 @@ RemotePortDynPkt rp_wait_resp(RemotePort *s)
             break;
         }
         D(qemu_log("%s: wait for progress\n", __func__));
-        if (!rp_has_work(s)) {
-            qemu_cond_wait(&s->progress_cond, &s->rsp_mutex);
-        }
+        rp_wait_progress(s);
     }
     return s->rspqueue;
 }
@@ -282,17 +447,20 @@ static void rp_say_hello(RemotePort *s)
         CAP_BUSACCESS_EXT_BYTE_EN,
         CAP_WIRE_POSTED_UPDATES,
         CAP_ATS,
+        CAP_DMI,
+        CAP_WIRE_VECTOR,
     };
+    struct iovec iov[2];
     size_t len;
 
     len = rp_encode_hello_caps(s->current_id++, 0, &pkt, RP_VERSION_MAJOR,
                                RP_VERSION_MINOR,
                                caps, caps, sizeof caps / sizeof caps[0]);
-    rp_write(s, (void *) &pkt, len);
-
-    if (sizeof caps) {
-        rp_write(s, caps, sizeof caps);
-    }
+    iov[0].iov_base = &pkt;
+    iov[0].iov_len = len;
+    iov[1].iov_base = caps;
+    iov[1].iov_len = sizeof caps;
+    rp_writev(s, iov, 2);
 }
 
 static void rp_say_sync(RemotePort *s, int64_t clk)
@@ -389,32 +557,49 @@ static Chardev *rp_autocreate_chardev(RemotePort *s, char *name)
     return chr;
 }
 
+static void rp_dispatch_process_bounced(RemotePort *s);
+
+/*
+ * Claim the next packet in rx_queue. There may be several consumers
+ * (the main loop and threads waiting for responses, possibly recursing
+ * through device callbacks), so the claim is a cmpxchg on rpos. Claiming
+ * before processing keeps packets ordered across recursion.
+ */
+static bool rp_rx_queue_claim(RemotePort *s, unsigned int *rpos)
+{
+    unsigned int r = qatomic_read(&s->rx_queue.rpos);
+
+    while (r != qatomic_load_acquire(&s->rx_queue.wpos)) {
+        unsigned int next = (r + 1) % ARRAY_SIZE(s->rx_queue.pkt);
+        unsigned int old = qatomic_cmpxchg(&s->rx_queue.rpos, r, next);
+
+        if (old == r) {
+            *rpos = r;
+            return true;
+        }
+        r = old;
+    }
+    return false;
+}
+
+/*
+ * Drains everything published so far. The event pipe is only kicked on
+ * an empty to non-empty transition, so a single wakeup may cover a
+ * whole batch of packets.
+ */
 void rp_process(RemotePort *s)
 {
-    while (true) {
-        struct rp_pkt *pkt;
-        unsigned int rpos;
+    unsigned int rpos;
+
+    rp_dispatch_process_bounced(s);
+    while (rp_rx_queue_claim(s, &rpos)) {
+        struct rp_pkt *pkt = s->rx_queue.pkt[rpos].pkt;
         bool actioned = false;
         RemotePortDevice *dev;
         RemotePortDeviceClass *rpdc;
 
-        qemu_mutex_lock(&s->rsp_mutex);
-        if (!rp_has_work(s)) {
-            qemu_mutex_unlock(&s->rsp_mutex);
-            break;
-        }
-        rpos = s->rx_queue.rpos;
-
-        pkt = s->rx_queue.pkt[rpos].pkt;
-        D(qemu_log("%s: io-thread rpos=%d wpos=%d cmd=%d dev=%d\n",
-                 s->prefix, s->rx_queue.rpos, s->rx_queue.wpos,
-                 pkt->hdr.cmd, pkt->hdr.dev));
-
-        /* To handle recursiveness, we need to advance the index
-         * index before processing the packet.  */
-        s->rx_queue.rpos++;
-        s->rx_queue.rpos %= ARRAY_SIZE(s->rx_queue.pkt);
-        qemu_mutex_unlock(&s->rsp_mutex);
+        D(qemu_log("%s: io-thread rpos=%d cmd=%d dev=%d\n",
+                 s->prefix, rpos, pkt->hdr.cmd, pkt->hdr.dev));
 
         dev = s->devs[pkt->hdr.dev];
         if (dev) {
@@ -433,8 +618,10 @@ void rp_process(RemotePort *s)
             assert(actioned);
         }
 
-        s->rx_queue.inuse[rpos] = false;
-        qemu_sem_post(&s->rx_queue.sem);
+        qatomic_dec(&s->dev_state[pkt->hdr.dev].queued);
+        qatomic_store_release(&s->rx_queue.inuse[rpos], false);
+        /* Only wakes the protocol thread if it waits for space.  */
+        qemu_event_set(&s->rx_queue.space);
     }
 }
 
@@ -444,6 +631,13 @@ static void rp_event_read(void *opaque)
     unsigned char buf[32];
     ssize_t r;
 
+    /*
+     * Re-arm the notification before looking at the queue, anything
+     * published from here on kicks us again.
+     */
+    qatomic_set(&s->rx_queue.kicked, false);
+    smp_mb();
+
     /* We don't care about the data. Just read it out to clear the event.  */
     do {
 #ifdef _WIN32
@@ -475,41 +669,303 @@ static void rp_event_notify(RemotePort *s)
     }
 }
 
-/* Handover a pkt to CPU or IO-thread context.  */
-static void rp_pt_handover_pkt(RemotePort *s, RemotePortDynPkt *dpkt)
+/*
+ * Dispatch threads.
+ *
+ * Packets for devices implementing dispatch_lockless are handed straight
+ * from the protocol thread to a dispatch thread, bypassing the main loop.
+ * To keep per-device ordering a device only ever has packets pending in
+ * one place: lockless packets are dispatched only if none are queued for
+ * the main loop, and once a device has packets in a dispatcher all of its
+ * packets go there.
+ *
+ * The memory map may change between the protocol thread vetting a packet
+ * and a dispatch thread handling it, so dispatch threads vet it again in
+ * the RCU read section they handle it in. Packets that no longer qualify,
+ * or that only followed the device's dispatched ones, are bounced to the
+ * main loop through dispatch_bounced. The dispatch thread waits for them
+ * to be handled before moving on.
+ */
+struct RemotePortDispatcher {
+    RemotePort *s;
+    QemuThread thread;
+    QemuMutex mutex;
+    QemuCond work_cond;
+    QemuCond done_cond;
+    /* RemotePortDynPkt's to handle and spare ones.  */
+    GQueue queue;
+    GQueue spare;
+    unsigned int pending;
+    /* A packet is waiting in dispatch_bounced.  */
+    bool bouncing;
+    bool stop;
+};
+
+static RemotePortDispatcher *rp_dispatcher(RemotePort *s, uint32_t dev)
 {
-    bool full;
+    return &s->dispatchers[dev % s->dispatch_threads];
+}
 
-    /* Take the rsp lock around the wpos update, otherwise
-       rp_wait_resp will race with us.  */
+/* Called with d->mutex held once @dpkt has been handled.  */
+static void rp_dispatch_done(RemotePortDispatcher *d, RemotePortDynPkt *dpkt)
+{
+    g_queue_push_head(&d->spare, dpkt);
+    d->s->dev_state[dpkt->pkt->hdr.dev].dispatched--;
+    d->pending--;
+    qemu_cond_broadcast(&d->done_cond);
+}
+
+/* Hand @dpkt over to whoever processes the rx_queue, see rp_process.  */
+static void rp_dispatch_bounce(RemotePort *s, RemotePortDynPkt *dpkt)
+{
     qemu_mutex_lock(&s->rsp_mutex);
-    s->rx_queue.wpos++;
-    s->rx_queue.wpos %= ARRAY_SIZE(s->rx_queue.pkt);
-    smp_mb();
-    rp_event_notify(s);
+    g_queue_push_tail(&s->dispatch_bounced, dpkt);
+    if (!qatomic_xchg(&s->rx_queue.kicked, true)) {
+        rp_event_notify(s);
+    }
     qemu_cond_signal(&s->progress_cond);
     qemu_mutex_unlock(&s->rsp_mutex);
+}
 
-    do {
-        full = s->rx_queue.inuse[s->rx_queue.wpos];
-        if (full) {
-            qemu_log("%s: FULL rx queue %d\n", __func__, s->rx_queue.wpos);
-	    if (qemu_sem_timedwait(&s->rx_queue.sem, 2 * 1000) != 0) {
-#ifndef _WIN32
-                int sval;
+static void rp_dispatch_process_bounced(RemotePort *s)
+{
+    RemotePortDynPkt *dpkt;
 
-#ifndef CONFIG_SEM_TIMEDWAIT
-                sval = s->rx_queue.sem.count;
-#else
-                sem_getvalue(&s->rx_queue.sem.sem, &sval);
-#endif
-                qemu_log("semwait: %d rpos=%u wpos=%u\n", sval,
-                         s->rx_queue.rpos, s->rx_queue.wpos);
-#endif
-                qemu_log("Deadlock?\n");
-	    }
+    if (!s->dispatch_threads) {
+        return;
+    }
+
+    while (true) {
+        RemotePortDispatcher *d;
+        RemotePortDevice *dev;
+        RemotePortDeviceClass *rpdc;
+
+        qemu_mutex_lock(&s->rsp_mutex);
+        dpkt = g_queue_pop_head(&s->dispatch_bounced);
+        qemu_mutex_unlock(&s->rsp_mutex);
+        if (!dpkt) {
+            break;
+        }
+
+        d = rp_dispatcher(s, dpkt->pkt->hdr.dev);
+        dev = s->devs[dpkt->pkt->hdr.dev];
+        rpdc = REMOTE_PORT_DEVICE_GET_CLASS(dev);
+        rpdc->ops[dpkt->pkt->hdr.cmd](dev, dpkt->pkt);
+
+        qemu_mutex_lock(&d->mutex);
+        d->bouncing = false;
+        rp_dispatch_done(d, dpkt);
+        qemu_mutex_unlock(&d->mutex);
+    }
+}
+
+static void *rp_dispatch_thread(void *arg)
+{
+    RemotePortDispatcher *d = arg;
+    RemotePort *s = d->s;
+
+    rcu_register_thread();
+
+    qemu_mutex_lock(&d->mutex);
+    while (true) {
+        RemotePortDynPkt *dpkt;
+        RemotePortDevice *dev;
+        RemotePortDeviceClass *rpdc;
+        bool handled;
+
+        dpkt = g_queue_pop_head(&d->queue);
+        if (!dpkt) {
+            if (d->stop) {
+                break;
+            }
+            qemu_cond_wait(&d->work_cond, &d->mutex);
+            continue;
+        }
+        qemu_mutex_unlock(&d->mutex);
+
+        dev = s->devs[dpkt->pkt->hdr.dev];
+        rpdc = REMOTE_PORT_DEVICE_GET_CLASS(dev);
+        WITH_RCU_READ_LOCK_GUARD() {
+            handled = rpdc->dispatch_lockless(dev, dpkt->pkt);
+            if (handled) {
+                rpdc->ops[dpkt->pkt->hdr.cmd](dev, dpkt->pkt);
+            }
+        }
+
+        qemu_mutex_lock(&d->mutex);
+        if (handled) {
+            rp_dispatch_done(d, dpkt);
+            continue;
+        }
+
+        /* Later packets of the device must wait for this one.  */
+        d->bouncing = true;
+        qemu_mutex_unlock(&d->mutex);
+        rp_dispatch_bounce(s, dpkt);
+        qemu_mutex_lock(&d->mutex);
+        while (d->bouncing && !d->stop) {
+            qemu_cond_wait(&d->done_cond, &d->mutex);
+        }
+        if (d->bouncing) {
+            break;
+        }
+    }
+    qemu_mutex_unlock(&d->mutex);
+
+    rcu_unregister_thread();
+    return NULL;
+}
+
+static void rp_dispatch_wait_all(RemotePort *s)
+{
+    unsigned int i;
+
+    for (i = 0; i < s->dispatch_threads; i++) {
+        RemotePortDispatcher *d = &s->dispatchers[i];
+
+        qemu_mutex_lock(&d->mutex);
+        while (d->pending) {
+            qemu_cond_wait(&d->done_cond, &d->mutex);
+        }
+        qemu_mutex_unlock(&d->mutex);
+    }
+}
+
+/*
+ * Try to hand a request over to a dispatch thread. Returns false if it
+ * must go through the main loop instead.
+ */
+static bool rp_dispatch_pkt(RemotePort *s, RemotePortDynPkt *dpkt)
+{
+    struct rp_pkt *pkt = dpkt->pkt;
+    uint32_t devnr = pkt->hdr.dev;
+    RemotePortDevice *dev = s->devs[devnr];
+    RemotePortDeviceClass *rpdc;
+    RemotePortDispatcher *d;
+    RemotePortDynPkt *item;
+    bool lockless;
+
+    if (!s->dispatch_threads || !dev) {
+        return false;
+    }
+
+    rpdc = REMOTE_PORT_DEVICE_GET_CLASS(dev);
+    if (!rpdc->dispatch_lockless || !rpdc->ops[pkt->hdr.cmd]) {
+        return false;
+    }
+
+    if (qatomic_read(&s->dev_state[devnr].queued)) {
+        return false;
+    }
+    lockless = rpdc->dispatch_lockless(dev, pkt);
+
+    d = rp_dispatcher(s, devnr);
+    qemu_mutex_lock(&d->mutex);
+    if (!lockless && !s->dev_state[devnr].dispatched) {
+        qemu_mutex_unlock(&d->mutex);
+        return false;
+    }
+    item = g_queue_pop_head(&d->spare);
+    if (!item) {
+        item = g_new0(RemotePortDynPkt, 1);
+        rp_dpkt_alloc(item, sizeof item->pkt->busaccess + 1024);
+    }
+    /* Leave a spare buffer in the rx slot so it can be reused right away.  */
+    rp_dpkt_swap(item, dpkt);
+    g_queue_push_tail(&d->queue, item);
+    s->dev_state[devnr].dispatched++;
+    d->pending++;
+    qemu_cond_signal(&d->work_cond);
+    qemu_mutex_unlock(&d->mutex);
+    return true;
+}
+
+static void rp_dispatch_init(RemotePort *s)
+{
+    unsigned int i;
+
+    g_queue_init(&s->dispatch_bounced);
+    s->dispatchers = g_new0(RemotePortDispatcher, s->dispatch_threads);
+    for (i = 0; i < s->dispatch_threads; i++) {
+        RemotePortDispatcher *d = &s->dispatchers[i];
+
+        d->s = s;
+        qemu_mutex_init(&d->mutex);
+        qemu_cond_init(&d->work_cond);
+        qemu_cond_init(&d->done_cond);
+        g_queue_init(&d->queue);
+        g_queue_init(&d->spare);
+        qemu_thread_create(&d->thread, "remote-port-dispatch",
+                           rp_dispatch_thread, d, QEMU_THREAD_JOINABLE);
+    }
+}
+
+static void rp_dispatch_free_queue(GQueue *queue)
+{
+    RemotePortDynPkt *dpkt;
+
+    while ((dpkt = g_queue_pop_head(queue))) {
+        rp_dpkt_free(dpkt);
+        g_free(dpkt);
+    }
+}
+
+static void rp_dispatch_cleanup(RemotePort *s)
+{
+    unsigned int i;
+
+    for (i = 0; i < s->dispatch_threads; i++) {
+        RemotePortDispatcher *d = &s->dispatchers[i];
+
+        qemu_mutex_lock(&d->mutex);
+        d->stop = true;
+        qemu_cond_signal(&d->work_cond);
+        qemu_cond_broadcast(&d->done_cond);
+        qemu_mutex_unlock(&d->mutex);
+        qemu_thread_join(&d->thread);
+
+        rp_dispatch_free_queue(&d->queue);
+        rp_dispatch_free_queue(&d->spare);
+        qemu_cond_destroy(&d->done_cond);
+        qemu_cond_destroy(&d->work_cond);
+        qemu_mutex_destroy(&d->mutex);
+    }
+    rp_dispatch_free_queue(&s->dispatch_bounced);
+    g_free(s->dispatchers);
+    s->dispatchers = NULL;
+}
+
+/* Handover a pkt to CPU or IO-thread context.  */
+static void rp_pt_handover_pkt(RemotePort *s, RemotePortDynPkt *dpkt)
+{
+    unsigned int wpos;
+
+    qatomic_inc(&s->dev_state[dpkt->pkt->hdr.dev].queued);
+
+    wpos = (s->rx_queue.wpos + 1) % ARRAY_SIZE(s->rx_queue.pkt);
+    qatomic_store_release(&s->rx_queue.wpos, wpos);
+    smp_mb();
+
+    /* Only go through the event pipe when the main loop isn't already due.  */
+    if (!qatomic_xchg(&s->rx_queue.kicked, true)) {
+        rp_event_notify(s);
+    }
+    /* Pairs with rp_wait_progress.  */
+    if (qatomic_read(&s->rx_queue.waiters)) {
+        qemu_mutex_lock(&s->rsp_mutex);
+        qemu_cond_signal(&s->progress_cond);
+        qemu_mutex_unlock(&s->rsp_mutex);
+    }
+
+    /* Wait for the next slot to be freed if the queue is full.  */
+    while (qatomic_load_acquire(&s->rx_queue.inuse[wpos])) {
+        qemu_event_reset(&s->rx_queue.space);
+        if (!qatomic_load_acquire(&s->rx_queue.inuse[wpos])) {
+            break;
         }
-    } while (full);
+        D(qemu_log("%s: FULL rx queue %d\n", __func__, wpos));
+        qemu_event_wait(&s->rx_queue.space);
+    }
 }
 
 static bool rp_pt_cmd_sync(RemotePort *s, struct rp_pkt *pkt)
@@ -597,12 +1053,23 @@ static bool rp_pt_process_pkt(RemotePort *s, RemotePortDynPkt *dpkt)
         if (rp_pt_cmd_sync(s, pkt)) {
             return true;
         }
-        /* Fall-through.  */
+        /* Whatever was dispatched before the sync must be done by then.  */
+        if (s->dispatch_threads) {
+            rp_dispatch_wait_all(s);
+        }
+        rp_pt_handover_pkt(s, dpkt);
+        break;
     case RP_CMD_read:
     case RP_CMD_write:
     case RP_CMD_interrupt:
+    case RP_CMD_interrupt_vec:
     case RP_CMD_ats_req:
     case RP_CMD_ats_inv:
+    case RP_CMD_dmi_req:
+    case RP_CMD_dmi_inv:
+        if (rp_dispatch_pkt(s, dpkt)) {
+            return true;
+        }
         rp_pt_handover_pkt(s, dpkt);
         break;
     default:
@@ -615,6 +1082,7 @@ static bool rp_pt_process_pkt(RemotePort *s, RemotePortDynPkt *dpkt)
 static int rp_read_pkt(RemotePort *s, RemotePortDynPkt *dpkt)
 {
     struct rp_pkt *pkt = dpkt->pkt;
+    struct rp_pkt_hdr raw_hdr;
     int used;
     int r;
 
@@ -622,6 +1090,7 @@ static int rp_read_pkt(RemotePort *s, RemotePortDynPkt *dpkt)
     if (r <= 0) {
         return r;
     }
+    raw_hdr = pkt->hdr;
     used = rp_decode_hdr((void *) &pkt->hdr);
     assert(used == sizeof pkt->hdr);
 
@@ -633,9 +1102,19 @@ static int rp_read_pkt(RemotePort *s, RemotePortDynPkt *dpkt)
         if (r <= 0) {
             return r;
         }
+        if (s->capture) {
+            rp_capture_pkt(s->capture, RP_CAPTURE_DIR_IN,
+                           rp_normalized_vmclk(s), &raw_hdr, sizeof raw_hdr,
+                           &pkt->hdr + 1, pkt->hdr.len);
+        }
         rp_decode_payload(pkt);
+    } else if (s->capture) {
+        rp_capture_pkt(s->capture, RP_CAPTURE_DIR_IN, rp_normalized_vmclk(s),
+                       &raw_hdr, sizeof raw_hdr, NULL, 0);
     }
 
+    s->stats.rx_packets++;
+    s->stats.rx_bytes += sizeof pkt->hdr + pkt->hdr.len;
     return used + r;
 }
 
@@ -645,6 +1124,9 @@ static void *rp_protocol_thread(void *arg)
     unsigned int i;
     int r;
 
+    /* dispatch_lockless() implementations may look at the memory map.  */
+    rcu_register_thread();
+
     /* Make sure we have a decent bufsize to start with.  */
     rp_dpkt_alloc(&s->rsp, sizeof s->rsp.pkt->busaccess + 1024);
     rp_dpkt_alloc(&s->rspqueue, sizeof s->rspqueue.pkt->busaccess + 1024);
@@ -682,6 +1164,7 @@ static void *rp_protocol_thread(void *arg)
     if (!s->finalizing) {
         rp_fatal_error(s, "Disconnected");
     }
+    rcu_unregister_thread();
     return NULL;
 }
 
@@ -713,7 +1196,12 @@ static void rp_realize(DeviceState *dev, Error **errp)
     qemu_mutex_init(&s->rsp_mutex);
     qemu_cond_init(&s->progress_cond);
 
-    if (!qemu_chr_fe_get_driver(&s->chr)) {
+    if (s->sock.desc) {
+        s->sock.fd = rp_sock_open(s, errp);
+        if (s->sock.fd < 0) {
+            return;
+        }
+    } else if (!qemu_chr_fe_get_driver(&s->chr)) {
         char *name;
         Chardev *chr = NULL;
         static int nr = 0;
@@ -754,7 +1242,9 @@ static void rp_realize(DeviceState *dev, Error **errp)
     /* Force RP sockets into blocking mode since our RP-thread will deal
      * with the IO and bypassing QEMUs main-loop.
      */
-    qemu_chr_fe_set_blocking(&s->chr, true);
+    if (s->sock.fd < 0) {
+        qemu_chr_fe_set_blocking(&s->chr, true);
+    }
 
 #ifdef _WIN32
     /* Create a socket connection between two sockets. We auto-bind
@@ -844,7 +1334,19 @@ static void rp_realize(DeviceState *dev, Error **errp)
     ptimer_set_freq(s->sync.ptimer_resp, 1000 * 1000 * 1000);
     ptimer_transaction_commit(s->sync.ptimer_resp);
 
-    qemu_sem_init(&s->rx_queue.sem, ARRAY_SIZE(s->rx_queue.pkt) - 1);
+    qemu_event_init(&s->rx_queue.space, false);
+
+    /* Last, so that nothing can fail once the capture thread is running.  */
+    if (s->capture_path) {
+        s->capture = rp_capture_open(s->capture_path, errp);
+        if (!s->capture) {
+            return;
+        }
+    }
+
+    if (s->dispatch_threads) {
+        rp_dispatch_init(s);
+    }
 }
 
 static void rp_unrealize(DeviceState *dev)
@@ -857,12 +1359,31 @@ static void rp_unrealize(DeviceState *dev)
     qemu_set_fd_handler(s->event.pipe.read, NULL, NULL, s);
 
     info_report("%s: Wait for remote-port to disconnect\n", s->prefix);
-    qemu_chr_fe_disconnect(&s->chr);
+    if (s->sock.fd >= 0) {
+        /* Kick the protocol thread out of recv.  */
+        shutdown(s->sock.fd, SHUT_RDWR);
+    } else {
+        qemu_chr_fe_disconnect(&s->chr);
+    }
     qemu_thread_join(&s->thread);
+    qemu_event_destroy(&s->rx_queue.space);
+    if (s->dispatch_threads) {
+        rp_dispatch_cleanup(s);
+    }
+    if (s->capture) {
+        rp_capture_close(s->capture);
+        s->capture = NULL;
+    }
 
     close(s->event.pipe.read);
     close(s->event.pipe.write);
-    object_unparent(OBJECT(s->chrdev));
+    if (s->sock.fd >= 0) {
+        close(s->sock.fd);
+        s->sock.fd = -1;
+    }
+    if (s->chrdev) {
+        object_unparent(OBJECT(s->chrdev));
+    }
 }
 
 static const VMStateDescription vmstate_rp = {
@@ -881,6 +1402,12 @@ static Property rp_properties[] = {
     DEFINE_PROP_BOOL("sync", RemotePort, do_sync, false),
     DEFINE_PROP_UINT64("sync-quantum", RemotePort, peer.local_cfg.quantum,
                        1000000),
+    DEFINE_PROP_UINT32("dispatch-threads", RemotePort, dispatch_threads, 0),
+    DEFINE_PROP_STRING("capture", RemotePort, capture_path),
+    DEFINE_PROP_STRING("socket", RemotePort, sock.desc),
+    DEFINE_PROP_BOOL("socket-server", RemotePort, sock.server, false),
+    DEFINE_PROP_BOOL("nodelay", RemotePort, sock.nodelay, true),
+    DEFINE_PROP_UINT32("busy-poll", RemotePort, sock.busy_poll, 0),
     DEFINE_PROP_END_OF_LIST(),
 };
 
@@ -890,6 +1417,24 @@ static void rp_init(Object *obj)
     int t;
     int i;
 
+    s->sock.fd = -1;
+
+    object_property_add_uint64_ptr(obj, "tx-packets", &s->stats.tx_packets,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "tx-bytes", &s->stats.tx_bytes,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "rx-packets", &s->stats.rx_packets,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "rx-bytes", &s->stats.rx_bytes,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "rtt-count", &s->stats.rtt_count,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "rtt-total-ns",
+                                   &s->stats.rtt_total_ns,
+                                   OBJ_PROP_FLAG_READ);
+    object_property_add_uint64_ptr(obj, "rtt-max-ns", &s->stats.rtt_max_ns,
+                                   OBJ_PROP_FLAG_READ);
+
     for (i = 0; i < REMOTE_PORT_MAX_DEVS; ++i) {
         char *name = g_strdup_printf("remote-port-dev%d", i);
         object_property_add_link(obj, name, TYPE_REMOTE_PORT_DEVICE,
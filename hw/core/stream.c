@@ -1,6 +1,7 @@
 #include "qemu/osdep.h"
 #include "hw/stream.h"
 #include "qemu/module.h"
+#include "qemu/iov.h"
 
 size_t
 stream_push(StreamSink *sink, uint8_t *buf, size_t len, bool eop)
@@ -10,6 +11,33 @@ stream_push(StreamSink *sink, uint8_t *buf, size_t len, bool eop)
     return k->push(sink, buf, len, eop);
 }
 
+size_t
+stream_push_iov(StreamSink *sink, const struct iovec *iov, int iovcnt,
+                bool eop)
+{
+    StreamSinkClass *k =  STREAM_SINK_GET_CLASS(sink);
+    g_autofree uint8_t *buf = NULL;
+    size_t len;
+
+    if (k->push_iov) {
+        return k->push_iov(sink, iov, iovcnt, eop);
+    }
+
+    /* push may scribble over its buffer, so never hand out the iovec. */
+    len = iov_size(iov, iovcnt);
+    buf = g_malloc(len);
+    iov_to_buf(iov, iovcnt, 0, buf, len);
+    return k->push(sink, buf, len, eop);
+}
+
+bool
+stream_has_push_iov(StreamSink *sink)
+{
+    StreamSinkClass *k =  STREAM_SINK_GET_CLASS(sink);
+
+    return k->push_iov != NULL;
+}
+
 bool
 stream_can_push(StreamSink *sink, StreamCanPushNotifyFn notify,
                 void *notify_opaque)
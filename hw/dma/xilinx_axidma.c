@@ -32,6 +32,7 @@
 #include "hw/qdev-properties.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "qemu/iov.h"
 
 #include "sysemu/dma.h"
 #include "hw/stream.h"
@@ -113,6 +114,11 @@ struct Stream {
     uint32_t regs[R_MAX];
     uint8_t app[20];
     unsigned char txbuf[16 * 1024];
+    /* Guest buffers of the frame being sent, mapped for zero-copy pushes. */
+    struct iovec txiov[16];
+    /* Descriptors of those buffers, completed once they have been pushed. */
+    hwaddr txdesc[16];
+    int txiovcnt;
 };
 
 struct XilinxAXIDMAStreamSink {
@@ -212,6 +218,14 @@ static void stream_desc_store(struct Stream *s, hwaddr addr)
                         d, sizeof *d);
 }
 
+static void stream_desc_complete(struct Stream *s, hwaddr addr)
+{
+    uint32_t status = cpu_to_le32(SDESC_STATUS_COMPLETE);
+
+    address_space_write(&s->dma->as, addr + offsetof(struct SDesc, status),
+                        MEMTXATTRS_UNSPECIFIED, &status, sizeof status);
+}
+
 static void stream_update_irq(struct Stream *s)
 {
     unsigned int pending, mask, irq;
@@ -262,6 +276,57 @@ static void stream_complete(struct Stream *s)
     ptimer_transaction_commit(s->ptimer);
 }
 
+static void stream_flush_mem2s(struct Stream *s, StreamSink *tx_data_dev,
+                               bool eop)
+{
+    int i;
+
+    if (!s->txiovcnt) {
+        return;
+    }
+
+    stream_push_iov(tx_data_dev, s->txiov, s->txiovcnt, eop);
+    for (i = 0; i < s->txiovcnt; i++) {
+        dma_memory_unmap(&s->dma->as, s->txiov[i].iov_base,
+                         s->txiov[i].iov_len, DMA_DIRECTION_TO_DEVICE,
+                         s->txiov[i].iov_len);
+        stream_desc_complete(s, s->txdesc[i]);
+    }
+    s->txiovcnt = 0;
+}
+
+/*
+ * Try to map a whole descriptor buffer and queue it for a zero-copy push.
+ * Returns false if the buffer is not directly accessible (MMIO, IOMMU
+ * bounce or too many segments), in which case the caller must copy it.
+ */
+static bool stream_map_mem2s(struct Stream *s, hwaddr desc, uint64_t addr,
+                             uint32_t len)
+{
+    dma_addr_t maplen = len;
+    void *p;
+
+    if (s->txiovcnt == ARRAY_SIZE(s->txiov)) {
+        return false;
+    }
+
+    p = dma_memory_map(&s->dma->as, addr, &maplen, DMA_DIRECTION_TO_DEVICE,
+                       MEMTXATTRS_UNSPECIFIED);
+    if (!p) {
+        return false;
+    }
+    if (maplen < len) {
+        dma_memory_unmap(&s->dma->as, p, maplen, DMA_DIRECTION_TO_DEVICE, 0);
+        return false;
+    }
+
+    s->txiov[s->txiovcnt].iov_base = p;
+    s->txiov[s->txiovcnt].iov_len = len;
+    s->txdesc[s->txiovcnt] = desc;
+    s->txiovcnt++;
+    return true;
+}
+
 static void stream_process_mem2s(struct Stream *s, StreamSink *tx_data_dev,
                                  StreamSink *tx_control_dev)
 {
@@ -269,11 +334,19 @@ static void stream_process_mem2s(struct Stream *s, StreamSink *tx_data_dev,
     uint32_t txlen;
     uint64_t addr;
     bool eop;
+    bool zero_copy;
+    bool queued;
 
     if (!stream_running(s) || stream_idle(s)) {
         return;
     }
 
+    /*
+     * Sinks that take iovecs get the descriptor buffers straight from guest
+     * RAM, a frame spanning several descriptors being pushed in one go.
+     */
+    zero_copy = stream_has_push_iov(tx_data_dev);
+
     while (1) {
         stream_desc_load(s, s->regs[R_CURDESC]);
 
@@ -283,6 +356,7 @@ static void stream_process_mem2s(struct Stream *s, StreamSink *tx_data_dev,
         }
 
         if (stream_desc_sof(&s->desc)) {
+            stream_flush_mem2s(s, tx_data_dev, false);
             stream_push(tx_control_dev, s->desc.app, sizeof(s->desc.app), true);
         }
 
@@ -290,6 +364,18 @@ static void stream_process_mem2s(struct Stream *s, StreamSink *tx_data_dev,
 
         eop = stream_desc_eof(&s->desc);
         addr = s->desc.buffer_address;
+        queued = false;
+        if (zero_copy && txlen) {
+            if (stream_map_mem2s(s, s->regs[R_CURDESC], addr, txlen)) {
+                txlen = 0;
+                queued = true;
+            } else {
+                stream_flush_mem2s(s, tx_data_dev, false);
+            }
+        }
+        if (eop) {
+            stream_flush_mem2s(s, tx_data_dev, true);
+        }
         while (txlen) {
             unsigned int len;
 
@@ -306,9 +392,14 @@ static void stream_process_mem2s(struct Stream *s, StreamSink *tx_data_dev,
             stream_complete(s);
         }
 
-        /* Update the descriptor.  */
-        s->desc.status = txlen | SDESC_STATUS_COMPLETE;
-        stream_desc_store(s, s->regs[R_CURDESC]);
+        /*
+         * Update the descriptor. Queued ones are only completed by
+         * stream_flush_mem2s(), once their data has been pushed.
+         */
+        if (!queued) {
+            s->desc.status = txlen | SDESC_STATUS_COMPLETE;
+            stream_desc_store(s, s->regs[R_CURDESC]);
+        }
 
         /* Advance.  */
         prev_d = s->regs[R_CURDESC];
@@ -318,6 +409,9 @@ static void stream_process_mem2s(struct Stream *s, StreamSink *tx_data_dev,
             break;
         }
     }
+
+    /* Don't keep guest mappings once the ring has run dry.  */
+    stream_flush_mem2s(s, tx_data_dev, false);
 }
 
 static size_t stream_process_s2mem(struct Stream *s, unsigned char *buf,
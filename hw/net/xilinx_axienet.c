@@ -28,6 +28,7 @@
 #include "qapi/error.h"
 #include "qemu/log.h"
 #include "qemu/module.h"
+#include "qemu/iov.h"
 #include "net/net.h"
 #include "net/checksum.h"
 
@@ -877,43 +878,18 @@ xilinx_axienet_control_stream_push(StreamSink *obj, uint8_t *buf, size_t len,
     return len;
 }
 
-static size_t
-xilinx_axienet_data_stream_push(StreamSink *obj, uint8_t *buf, size_t size,
-                                bool eop)
+/* Send a complete frame, applying the checksum offload if requested.  */
+static void axienet_tx_frame(XilinxAXIEnet *s, const struct iovec *iov,
+                             int iovcnt)
 {
-    XilinxAXIEnetStreamSink *ds = XILINX_AXI_ENET_DATA_STREAM(obj);
-    XilinxAXIEnet *s = ds->enet;
-
-    /* TX enable ?  */
-    if (!(s->tc & TC_TX)) {
-        return size;
-    }
-
-    if (s->txpos + size > s->c_txmem) {
-        qemu_log_mask(LOG_GUEST_ERROR, "%s: Packet larger than txmem\n",
-                      TYPE_XILINX_AXI_ENET);
-        s->txpos = 0;
-        return size;
-    }
-
-    if (s->txpos == 0 && eop) {
-        /* Fast path single fragment.  */
-        s->txpos = size;
-    } else {
-        memcpy(s->txmem + s->txpos, buf, size);
-        buf = s->txmem;
-        s->txpos += size;
-
-        if (!eop) {
-            return size;
-        }
-    }
+    g_autofree struct iovec *frame = NULL;
+    size_t size = iov_size(iov, iovcnt);
+    uint8_t csum_buf[2];
 
     /* Jumbo or vlan sizes ?  */
     if (!(s->tc & TC_JUM)) {
-        if (s->txpos > 1518 && s->txpos <= 1522 && !(s->tc & TC_VLAN)) {
-            s->txpos = 0;
-            return size;
+        if (size > 1518 && size <= 1522 && !(s->tc & TC_VLAN)) {
+            return;
         }
     }
 
@@ -922,30 +898,99 @@ xilinx_axienet_data_stream_push(StreamSink *obj, uint8_t *buf, size_t size,
         unsigned int write_off = s->hdr[1] & 0xffff;
         uint32_t tmp_csum;
         uint16_t csum;
+        int cnt;
+
+        if (start_off > size || write_off + sizeof(csum_buf) > size) {
+            qemu_log_mask(LOG_GUEST_ERROR, "%s: Bad checksum offsets\n",
+                          TYPE_XILINX_AXI_ENET);
+            return;
+        }
 
-        tmp_csum = net_checksum_add(s->txpos - start_off,
-                                    buf + start_off);
+        tmp_csum = net_checksum_add_iov(iov, iovcnt, start_off,
+                                        size - start_off, 0);
         /* Accumulate the seed.  */
         tmp_csum += s->hdr[2] & 0xffff;
 
         /* Fold the 32bit partial checksum.  */
         csum = net_checksum_finish(tmp_csum);
 
-        /* Writeback.  */
-        buf[write_off] = csum >> 8;
-        buf[write_off + 1] = csum & 0xff;
+        /*
+         * Writeback. The frame may live in guest memory, so splice the
+         * checksum in rather than patching it in place.
+         */
+        csum_buf[0] = csum >> 8;
+        csum_buf[1] = csum & 0xff;
+
+        frame = g_new(struct iovec, 2 * iovcnt + 1);
+        cnt = iov_copy(frame, iovcnt, iov, iovcnt, 0, write_off);
+        frame[cnt].iov_base = csum_buf;
+        frame[cnt].iov_len = sizeof(csum_buf);
+        cnt++;
+        cnt += iov_copy(frame + cnt, iovcnt, iov, iovcnt,
+                        write_off + sizeof(csum_buf),
+                        size - write_off - sizeof(csum_buf));
+        iov = frame;
+        iovcnt = cnt;
     }
 
-    qemu_send_packet(qemu_get_queue(s->nic), buf, s->txpos);
+    qemu_sendv_packet(qemu_get_queue(s->nic), iov, iovcnt);
 
-    s->stats.tx_bytes += s->txpos;
+    s->stats.tx_bytes += size;
     s->regs[R_IS] |= IS_TX_COMPLETE;
     enet_update_irq(s);
+}
 
-    s->txpos = 0;
+static size_t
+xilinx_axienet_data_stream_push_iov(StreamSink *obj, const struct iovec *iov,
+                                    int iovcnt, bool eop)
+{
+    XilinxAXIEnetStreamSink *ds = XILINX_AXI_ENET_DATA_STREAM(obj);
+    XilinxAXIEnet *s = ds->enet;
+    size_t size = iov_size(iov, iovcnt);
+
+    /* TX enable ?  */
+    if (!(s->tc & TC_TX)) {
+        return size;
+    }
+
+    if (s->txpos + size > s->c_txmem) {
+        qemu_log_mask(LOG_GUEST_ERROR, "%s: Packet larger than txmem\n",
+                      TYPE_XILINX_AXI_ENET);
+        s->txpos = 0;
+        return size;
+    }
+
+    if (s->txpos == 0 && eop) {
+        /* Fast path, the whole frame is here: send it without a copy.  */
+        axienet_tx_frame(s, iov, iovcnt);
+        return size;
+    }
+
+    iov_to_buf(iov, iovcnt, 0, s->txmem + s->txpos, size);
+    s->txpos += size;
+
+    if (eop) {
+        axienet_tx_frame(s, &(struct iovec) {
+                             .iov_base = s->txmem,
+                             .iov_len = s->txpos,
+                         }, 1);
+        s->txpos = 0;
+    }
     return size;
 }
 
+static size_t
+xilinx_axienet_data_stream_push(StreamSink *obj, uint8_t *buf, size_t size,
+                                bool eop)
+{
+    struct iovec iov = {
+        .iov_base = buf,
+        .iov_len = size,
+    };
+
+    return xilinx_axienet_data_stream_push_iov(obj, &iov, 1, eop);
+}
+
 static NetClientInfo net_xilinx_enet_info = {
     .type = NET_CLIENT_DRIVER_NIC,
     .size = sizeof(NICState),
@@ -1034,6 +1079,7 @@ static void xilinx_enet_data_stream_class_init(ObjectClass *klass, void *data)
     StreamSinkClass *ssc = STREAM_SINK_CLASS(klass);
 
     ssc->push = xilinx_axienet_data_stream_push;
+    ssc->push_iov = xilinx_axienet_data_stream_push_iov;
 }
 
 static const TypeInfo xilinx_enet_info = {
@@ -19,6 +19,7 @@
 #define QEMU_THREAD_POOL_H
 
 #include "block/block.h"
+#include "qapi/qapi-types-misc.h"
 
 #define THREAD_POOL_MAX_THREADS_DEFAULT         64
 
@@ -36,5 +37,6 @@ int coroutine_fn thread_pool_submit_co(ThreadPool *pool,
         ThreadPoolFunc *func, void *arg);
 void thread_pool_submit(ThreadPool *pool, ThreadPoolFunc *func, void *arg);
 void thread_pool_update_params(ThreadPool *pool, struct AioContext *ctx);
+ThreadPoolStats *thread_pool_query_stats(ThreadPool *pool);
 
 #endif
@@ -274,6 +274,18 @@ void page_set_flags(target_ulong start, target_ulong end, int flags);
 void page_reset_target_data(target_ulong start, target_ulong end);
 int page_check_range(target_ulong start, target_ulong len, int flags);
 
+/**
+ * page_find_last_used(start, last)
+ * @start: first byte of the range
+ * @last: last byte of the range
+ *
+ * Return the address of the highest page in [@start, @last] that has any
+ * flags set, or -1 if the whole range is free.  Unpopulated parts of the
+ * page table are skipped without looking at individual pages.  The
+ * mmap_lock must be held for the result to stay valid.
+ */
+target_ulong page_find_last_used(target_ulong start, target_ulong last);
+
 /**
  * page_alloc_target_data(address, size)
  * @address: guest virtual address
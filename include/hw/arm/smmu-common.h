@@ -118,6 +118,8 @@ struct SMMUState {
     GHashTable *smmu_pcibus_by_busptr;
     GHashTable *configs; /* cache for configuration data */
     GHashTable *iotlb;
+    GHashTable *iotlb_by_asid; /* ASID -> GTree of iotlb keys by IOVA */
+    uint32_t iotlb_size;
     SMMUPciBus *smmu_pcibus_by_bus_num[SMMU_PCI_BUS_MAX];
     PCIBus *pci_bus;
     QLIST_HEAD(, SMMUDevice) devices_with_notifiers;
@@ -128,6 +130,16 @@ struct SMMUState {
         MemoryRegion *mr;
         SMMUDevice *sdev;
     } tbu[SMMU_MAX_TBU];
+
+    /* Cache statistics, exposed as read-only QOM properties */
+    uint64_t iotlb_hits;
+    uint64_t iotlb_misses;
+    uint64_t iotlb_inv;          /* invalidations, including flushes */
+    uint64_t iotlb_inv_entries;  /* entries dropped by invalidations */
+    uint64_t iotlb_flushes;      /* full flushes because the IOTLB was full */
+    uint64_t cfg_cache_hits;
+    uint64_t cfg_cache_misses;
+    uint64_t cfg_cache_inv;
 };
 
 struct SMMUBaseClass {
@@ -168,6 +180,7 @@ SMMUTransTableInfo *select_tt(SMMUTransCfg *cfg, dma_addr_t iova);
 /* Return the iommu mr associated to @sid, or NULL if none */
 IOMMUMemoryRegion *smmu_iommu_mr(SMMUState *s, uint32_t sid);
 
+/* Default for the "iotlb-size" property */
 #define SMMU_IOTLB_MAX_SIZE 256
 
 SMMUTLBEntry *smmu_iotlb_lookup(SMMUState *bs, SMMUTransCfg *cfg,
@@ -43,7 +43,10 @@ typedef struct {
     RemotePortDynPkt rsp;
     GArray *iommu_notifiers;
     uint32_t rp_dev;
-    GArray *cache; /* Translation cache */
+    GPtrArray *cache; /* Translation cache, one bucket per block size */
+    uint64_t cache_entries;
+    uint64_t cache_hits;
+    uint64_t cache_misses;
 } RemotePortATS;
 
 #define TYPE_REMOTE_PORT_ATS_CACHE "remote-port-ats-cache"
@@ -0,0 +1,81 @@
+/*
+ * QEMU remote port traffic capture.
+ *
+ * Packets sent and received by a remote-port adaptor can be recorded to a
+ * file for offline analysis and replay (see contrib/remote-port-replay).
+ *
+ * This code is licensed under the GNU GPL.
+ */
+#ifndef REMOTE_PORT_CAPTURE_H
+#define REMOTE_PORT_CAPTURE_H
+
+/*
+ * File format. All fields are little-endian.
+ *
+ * The file starts with a RemotePortCaptureHeader and is followed by
+ * records, each made of a RemotePortCaptureRecord and @len bytes holding
+ * the packet exactly as it went over the wire (i.e. in network order).
+ */
+#define RP_CAPTURE_MAGIC    "RPCAPTUR"
+#define RP_CAPTURE_VERSION  1
+
+typedef struct RemotePortCaptureHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t reserved;
+} QEMU_PACKED RemotePortCaptureHeader;
+
+enum {
+    /* Received from the peer.  */
+    RP_CAPTURE_DIR_IN  = 0,
+    /* Sent to the peer.  */
+    RP_CAPTURE_DIR_OUT = 1,
+};
+
+typedef struct RemotePortCaptureRecord {
+    /* Host monotonic clock, in ns.  */
+    uint64_t host_ns;
+    /* Adaptor virtual clock (rp_normalized_vmclk), in ns.  */
+    int64_t vclk;
+    uint32_t len;
+    uint8_t dir;
+    uint8_t reserved[3];
+} QEMU_PACKED RemotePortCaptureRecord;
+
+typedef struct RemotePortCapture RemotePortCapture;
+
+/**
+ * rp_capture_open:
+ * @path: file to write the capture to
+ * @errp: returns an error if the file cannot be created
+ *
+ * Creates the capture file and starts its writer thread.
+ */
+RemotePortCapture *rp_capture_open(const char *path, Error **errp);
+
+/**
+ * rp_capture_pkt:
+ * @c: capture
+ * @dir: RP_CAPTURE_DIR_IN or RP_CAPTURE_DIR_OUT
+ * @vclk: virtual clock at the time of the transfer
+ * @hdr, @hdr_len: start of the packet
+ * @data, @data_len: rest of the packet, may be empty
+ *
+ * Records a packet in wire format. There must be at most one caller per
+ * direction at a time. This never blocks: if the writer thread falls
+ * behind, the packet is dropped and accounted as such.
+ */
+void rp_capture_pkt(RemotePortCapture *c, unsigned int dir, int64_t vclk,
+                    const void *hdr, size_t hdr_len,
+                    const void *data, size_t data_len);
+
+/**
+ * rp_capture_close:
+ * @c: capture
+ *
+ * Flushes the pending records, stops the writer thread and closes the
+ * file.
+ */
+void rp_capture_close(RemotePortCapture *c);
+
+#endif
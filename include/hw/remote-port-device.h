@@ -37,6 +37,20 @@ typedef struct RemotePortDeviceClass {
 
     void (*ops[RP_CMD_max+1])(RemotePortDevice *obj, struct rp_pkt *pkt);
 
+    /**
+     * dispatch_lockless - optional. Returns true if @pkt can be handled
+     * from one of the adaptor's dispatch threads, i.e. without the BQL and
+     * concurrently with other devices. Called from the protocol thread,
+     * and again from the dispatch thread inside the RCU read section the
+     * packet is then handled in; if that returns false, the packet is
+     * handled from the main loop instead. Packets for a given device are
+     * always handled in order, whichever context they end up in.
+     *
+     * @obj - Remote port device to recieve packet
+     * @pkt - remote port packet, not yet handled
+     */
+    bool (*dispatch_lockless)(RemotePortDevice *obj, struct rp_pkt *pkt);
+
 } RemotePortDeviceClass;
 
 uint32_t rp_new_id(RemotePort *s);
@@ -46,6 +60,8 @@ void rp_rsp_mutex_unlock(RemotePort *s);
 void rp_restart_sync_timer(RemotePort *s);
 
 ssize_t rp_write(RemotePort *s, const void *buf, size_t count);
+/* Sends a packet split in up to two buffers, with a single syscall.  */
+ssize_t rp_writev(RemotePort *s, const struct iovec *iov, int iovcnt);
 
 RemotePortDynPkt rp_wait_resp(RemotePort *s);
 
@@ -13,6 +13,7 @@
         OBJECT_CHECK(RemotePortGPIO, (obj), TYPE_REMOTE_PORT_GPIO)
 
 #define MAX_GPIOS 164
+#define RP_GPIO_WORDS DIV_ROUND_UP(MAX_GPIOS, 32)
 
 typedef struct RemotePortGPIO {
     /* private */
@@ -25,6 +26,20 @@ typedef struct RemotePortGPIO {
     uint16_t cell_offset_irq_num;
 
     bool posted_updates;
+    /* Send line changes in vector packets, if the peer supports them.  */
+    bool batch_updates;
+    /* Drop lines that return to their previous level within a batch.  */
+    bool coalesce;
+
+    /* Line changes made at batch.clk, not sent yet.  */
+    struct {
+        QEMUBH *bh;
+        int64_t clk;
+        bool pending;
+        uint32_t changed[RP_GPIO_WORDS];
+        uint32_t levels[RP_GPIO_WORDS];
+    } batch;
+
     uint32_t rp_dev;
     struct RemotePort *rp;
     struct rp_peer_state *peer;
@@ -19,6 +19,13 @@
 
 typedef struct RemotePortMemoryMaster RemotePortMemoryMaster;
 
+/*
+ * Annotated access latencies are binned by powers of two: bucket 0 holds
+ * accesses below 1us, bucket i those in [2^(9+i), 2^(10+i)) ns and the
+ * last bucket everything above.
+ */
+#define RP_LATENCY_BUCKETS 16
+
 typedef struct RemotePortMap {
     void *parent;
     MemoryRegion iomem;
@@ -42,6 +49,17 @@ struct RemotePortMemoryMaster {
     uint32_t max_access_size;
     struct RemotePort *rp;
     struct rp_peer_state *peer;
+    /* Fold the latency reported by the peer back into virtual time.  */
+    bool annotate_timing;
+
+    struct {
+        uint64_t count;
+        uint64_t total_ns;
+        uint64_t max_ns;
+        uint64_t hist[RP_LATENCY_BUCKETS];
+        /* Accumulated latency per vCPU, indexed by cpu_index.  */
+        GArray *per_cpu_ns;
+    } latency;
 };
 
 MemTxResult rp_mm_access(RemotePort *rp, uint32_t rp_dev,
@@ -54,4 +72,15 @@ MemTxResult rp_mm_access_with_def_attr(RemotePort *rp, uint32_t rp_dev,
                                        MemoryTransaction *tr,
                                        bool relative, uint64_t offset,
                                        uint32_t def_attr);
+
+/*
+ * Like rp_mm_access_with_def_attr, and additionally returns the latency
+ * annotated by the peer, i.e. the distance between the request and
+ * response timestamps in ns, through @latency if non-NULL.
+ */
+MemTxResult rp_mm_access_timed(RemotePort *rp, uint32_t rp_dev,
+                               struct rp_peer_state *peer,
+                               MemoryTransaction *tr,
+                               bool relative, uint64_t offset,
+                               uint32_t def_attr, int64_t *latency);
 #endif
@@ -18,6 +18,12 @@
         OBJECT_CHECK(RemotePortMemorySlave, (obj), \
                      TYPE_REMOTE_PORT_MEMORY_SLAVE)
 
+/* A range of RAM the peer has been given direct access to.  */
+typedef struct RemotePortDMIGrant {
+    hwaddr addr;
+    hwaddr len;
+} RemotePortDMIGrant;
+
 typedef struct RemotePortMemorySlave {
     /* private */
     SysBusDevice parent;
@@ -29,5 +35,18 @@ typedef struct RemotePortMemorySlave {
     MemTxAttrs attr;
     RemotePortDynPkt rsp;
     RemotePortATSCache *ats_cache;
+    /* Latency in ns annotated on the responses to the peer.  */
+    uint64_t read_latency;
+    uint64_t write_latency;
+
+    struct {
+        /* Channel the peer sent its DMI requests on.  */
+        uint32_t dev;
+        GArray *grants;
+        /* Invalidations waiting for the peer, no grants meanwhile.  */
+        unsigned int revoking;
+        MemoryListener listener;
+        bool listening;
+    } dmi;
 } RemotePortMemorySlave;
 #endif
@@ -71,7 +71,10 @@ enum rp_cmd {
     RP_CMD_sync        = 6,
     RP_CMD_ats_req     = 7,
     RP_CMD_ats_inv     = 8,
-    RP_CMD_max         = 8
+    RP_CMD_dmi_req     = 9,
+    RP_CMD_dmi_inv     = 10,
+    RP_CMD_interrupt_vec = 11,
+    RP_CMD_max         = 11
 };
 
 enum {
@@ -139,6 +142,21 @@ enum {
     CAP_WIRE_POSTED_UPDATES = 3,
 
     CAP_ATS = 4, /* Address translation services */
+
+    /*
+     * Direct memory interface, modelled after TLM-2.0 DMI.
+     * The peer may ask for direct access to RAM backed by a shared file
+     * (see RP_CMD_dmi_req) and must stop using a grant once it receives
+     * a matching RP_CMD_dmi_inv.
+     */
+    CAP_DMI = 5,
+
+    /*
+     * Vector wire updates (RP_CMD_interrupt_vec). Several lines of a
+     * device may be updated with one packet. Responses follow the same
+     * rules as for RP_CMD_interrupt.
+     */
+    CAP_WIRE_VECTOR = 6,
 };
 
 struct rp_pkt_hello {
@@ -251,6 +269,18 @@ struct rp_pkt_interrupt {
     uint8_t val;
 } PACKED;
 
+/*
+ * Updates the lines set in a bitmap of changed lines to the levels found
+ * in a second bitmap. Both bitmaps follow the packet, nwords 32-bit words
+ * each, changed lines first. Bit N of word W covers line base + W * 32 + N.
+ */
+struct rp_pkt_interrupt_vec {
+    struct rp_pkt_hdr hdr;
+    uint64_t timestamp;
+    uint32_t base;
+    uint32_t nwords;
+} PACKED;
+
 struct rp_pkt_sync {
     struct rp_pkt_hdr hdr;
     uint64_t timestamp;
@@ -280,6 +310,41 @@ struct rp_pkt_ats {
     uint64_t reserved3;
 } PACKED;
 
+enum {
+    RP_DMI_ATTR_read     = 1 << 0,
+    RP_DMI_ATTR_write    = 1 << 1,
+};
+
+enum {
+    RP_DMI_RESULT_ok = 0,
+    RP_DMI_RESULT_error = 1,
+};
+
+/*
+ * DMI requests carry the address of interest in addr and the wanted
+ * access rights in attributes; len is a hint (0 for "as much as possible").
+ *
+ * Responses describe the granted range [addr, addr + len) and the granted
+ * rights. The range is backed by the file whose path follows the packet
+ * (path_len bytes, NUL terminated), starting at file_offset.
+ *
+ * Invalidations carry the range that must no longer be accessed directly.
+ * The peer responds once it has dropped all pointers into that range.
+ * Requests made while invalidations are pending fail with
+ * RP_DMI_RESULT_error and can be retried later.
+ */
+struct rp_pkt_dmi {
+    struct rp_pkt_hdr hdr;
+    uint64_t timestamp;
+    uint64_t attributes;
+    uint64_t addr;
+    uint64_t len;
+    uint32_t result;
+    uint64_t file_offset;
+    uint32_t path_len;
+    uint64_t reserved0;
+} PACKED;
+
 struct rp_pkt {
     union {
         struct rp_pkt_hdr hdr;
@@ -287,8 +352,10 @@ struct rp_pkt {
         struct rp_pkt_busaccess busaccess;
         struct rp_pkt_busaccess_ext_base busaccess_ext_base;
         struct rp_pkt_interrupt interrupt;
+        struct rp_pkt_interrupt_vec interrupt_vec;
         struct rp_pkt_sync sync;
         struct rp_pkt_ats ats;
+        struct rp_pkt_dmi dmi;
     };
 };
 
@@ -305,6 +372,8 @@ struct rp_peer_state {
         bool busaccess_ext_byte_en;
         bool wire_posted_updates;
         bool ats;
+        bool dmi;
+        bool wire_vector;
     } caps;
 
     /* Used to normalize our clk.  */
@@ -404,6 +473,48 @@ rp_busaccess_byte_en_ptr(struct rp_peer_state *peer,
     return NULL;
 }
 
+/*
+ * rp_busaccess_next_run
+ *
+ * Byte-enables and stream widths split a busaccess into runs of bytes
+ * that are contiguous both in the data buffer and on the bus.
+ * Skips disabled bytes starting at *pos, moves *pos to the start of the
+ * next run and returns its length, or 0 when there are no runs left.
+ * The run starts at bus address addr + *pos % stream_width.
+ */
+static inline uint32_t
+rp_busaccess_next_run(uint32_t *pos, uint32_t len, uint32_t stream_width,
+                      const unsigned char *byte_en, uint32_t byte_en_len)
+{
+    uint32_t i = *pos;
+    uint64_t end;
+
+    if (byte_en) {
+        while (i < len && !byte_en[i % byte_en_len]) {
+            i++;
+        }
+    }
+    *pos = i;
+    if (i >= len) {
+        return 0;
+    }
+
+    /* Runs never cross a stream_width boundary.  */
+    end = (uint64_t)i - i % stream_width + stream_width;
+    if (end > len) {
+        end = len;
+    }
+    if (byte_en) {
+        uint32_t j = i + 1;
+
+        while (j < end && byte_en[j % byte_en_len]) {
+            j++;
+        }
+        end = j;
+    }
+    return end - i;
+}
+
 size_t __attribute__ ((deprecated))
 rp_encode_read(uint32_t id, uint32_t dev,
                struct rp_pkt_busaccess *pkt,
@@ -479,6 +590,31 @@ size_t rp_encode_interrupt(uint32_t id, uint32_t dev,
                            int64_t clk,
                            uint32_t line, uint64_t vector, uint8_t val);
 
+/*
+ * Encodes the packet and both bitmaps, which must have room right after
+ * @pkt. Returns the total size.
+ */
+size_t rp_encode_interrupt_vec(uint32_t id, uint32_t dev,
+                               struct rp_pkt_interrupt_vec *pkt,
+                               int64_t clk, uint32_t base, uint32_t nwords,
+                               const uint32_t *changed,
+                               const uint32_t *levels,
+                               uint32_t flags);
+
+static inline uint32_t *rp_interrupt_vec_changed(
+                                        struct rp_pkt_interrupt_vec *pkt)
+{
+    /* Right after the packet.  */
+    return (uint32_t *)(pkt + 1);
+}
+
+/* Only valid on decoded packets.  */
+static inline uint32_t *rp_interrupt_vec_levels(
+                                        struct rp_pkt_interrupt_vec *pkt)
+{
+    return rp_interrupt_vec_changed(pkt) + pkt->nwords;
+}
+
 size_t rp_encode_sync(uint32_t id, uint32_t dev,
                       struct rp_pkt_sync *pkt,
                       int64_t clk);
@@ -497,6 +633,24 @@ size_t rp_encode_ats_inv(uint32_t id, uint32_t dev,
                          int64_t clk, uint64_t attr, uint64_t addr,
                          uint64_t size, uint64_t result, uint32_t flags);
 
+size_t rp_encode_dmi_resp(uint32_t id, uint32_t dev,
+                          struct rp_pkt_dmi *pkt,
+                          int64_t clk, uint64_t attr, uint64_t addr,
+                          uint64_t len, uint64_t file_offset,
+                          uint32_t result, uint32_t path_len,
+                          uint32_t flags);
+
+size_t rp_encode_dmi_inv(uint32_t id, uint32_t dev,
+                         struct rp_pkt_dmi *pkt,
+                         int64_t clk, uint64_t addr, uint64_t len,
+                         uint32_t flags);
+
+static inline char *rp_dmi_pathptr(struct rp_pkt_dmi *pkt)
+{
+    /* Right after the packet.  */
+    return (char *)(pkt + 1);
+}
+
 void rp_process_caps(struct rp_peer_state *peer,
                      void *caps, size_t caps_len);
 
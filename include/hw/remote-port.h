@@ -12,6 +12,7 @@
 #include <stdbool.h>
 #include "hw/remote-port-proto.h"
 #include "hw/remote-port-device.h"
+#include "hw/remote-port-capture.h"
 #include "chardev/char.h"
 #include "chardev/char-fe.h"
 #include "hw/ptimer.h"
@@ -20,6 +21,8 @@
 #define TYPE_REMOTE_PORT "remote-port"
 #define REMOTE_PORT(obj) OBJECT_CHECK(RemotePort, (obj), TYPE_REMOTE_PORT)
 
+typedef struct RemotePortDispatcher RemotePortDispatcher;
+
 typedef struct RemotePortRespSlot {
             RemotePortDynPkt rsp;
             uint32_t id;
@@ -48,8 +51,35 @@ struct RemotePort {
 
     char *chardesc;
     char *chrdev_id;
+    /* Record all traffic to this file, see remote-port-capture.h.  */
+    char *capture_path;
+    RemotePortCapture *capture;
     struct rp_peer_state peer;
 
+    /*
+     * Native socket transport, bypasses the chardev layer when desc is
+     * set. busy_poll is in us, see the "busy-poll" property.
+     */
+    struct {
+        char *desc;
+        bool server;
+        bool nodelay;
+        uint32_t busy_poll;
+        int fd;
+    } sock;
+
+    /* Exposed as read-only QOM properties.  */
+    struct {
+        uint64_t tx_packets;
+        uint64_t tx_bytes;
+        uint64_t rx_packets;
+        uint64_t rx_bytes;
+        /* Round trips seen by rp_dev_wait_resp.  */
+        uint64_t rtt_count;
+        uint64_t rtt_total_ns;
+        uint64_t rtt_max_ns;
+    } stats;
+
     struct {
         ptimer_state *ptimer;
         ptimer_state *ptimer_resp;
@@ -63,11 +93,20 @@ struct RemotePort {
     QemuCond progress_cond;
 
 #define RX_QUEUE_SIZE 1024
+    /*
+     * Lock-free ring from the protocol thread (single producer, owns wpos)
+     * to rp_process callers (consumers, claim entries by moving rpos).
+     */
     struct {
         /* This array must be sized minimum 2 and always a power of 2.  */
         RemotePortDynPkt pkt[RX_QUEUE_SIZE];
         bool inuse[RX_QUEUE_SIZE];
-        QemuSemaphore sem;
+        /* Set by consumers when they free a slot, waited on when full.  */
+        QemuEvent space;
+        /* An event pipe notification is pending.  */
+        bool kicked;
+        /* Threads sleeping on progress_cond.  */
+        unsigned int waiters;
         unsigned int wpos;
         unsigned int rpos;
     } rx_queue;
@@ -85,6 +124,16 @@ struct RemotePort {
      */
     RemotePortDynPkt rspqueue;
 
+    /*
+     * Threads handling packets for devices that can run without the BQL,
+     * see RemotePortDeviceClass::dispatch_lockless. Channel N is served by
+     * dispatcher N % dispatch_threads.
+     */
+    uint32_t dispatch_threads;
+    RemotePortDispatcher *dispatchers;
+    /* Packets dispatch threads sent back to rp_process, under rsp_mutex.  */
+    GQueue dispatch_bounced;
+
     bool resets[32];
 
     const char *prefix;
@@ -97,6 +146,9 @@ struct RemotePort {
 #define RP_MAX_OUTSTANDING_TRANSACTIONS 32
     struct {
         RemotePortRespSlot rsp_queue[RP_MAX_OUTSTANDING_TRANSACTIONS];
+        /* Packets waiting in rx_queue and in a dispatcher respectively.  */
+        unsigned int queued;
+        unsigned int dispatched;
     } dev_state[REMOTE_PORT_MAX_DEVS];
 
     RemotePortDevice *devs[REMOTE_PORT_MAX_DEVS];
@@ -40,11 +40,31 @@ struct StreamSinkClass {
      * @eop: End of packet flag
      */
     size_t (*push)(StreamSink *obj, unsigned char *buf, size_t len, bool eop);
+    /**
+     * push_iov - optional scatter-gather variant of push. Same semantics as
+     * push, except that the data is described by an iovec array that may
+     * point straight into guest memory. The sink must consume the data
+     * before returning, must not modify it and must not keep references to
+     * it. Sinks that do not implement it are fed through a bounce buffer.
+     * @obj: Stream sink to push to
+     * @iov: Data to write
+     * @iovcnt: Number of elements in @iov
+     * @eop: End of packet flag
+     */
+    size_t (*push_iov)(StreamSink *obj, const struct iovec *iov, int iovcnt,
+                       bool eop);
 };
 
 size_t
 stream_push(StreamSink *sink, uint8_t *buf, size_t len, bool eop);
 
+size_t
+stream_push_iov(StreamSink *sink, const struct iovec *iov, int iovcnt,
+                bool eop);
+
+bool
+stream_has_push_iov(StreamSink *sink);
+
 bool
 stream_can_push(StreamSink *sink, StreamCanPushNotifyFn notify,
                 void *notify_opaque);
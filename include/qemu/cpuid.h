@@ -25,12 +25,18 @@
 #endif
 
 /* Leaf 1, %ecx */
+#ifndef bit_PCLMUL
+#define bit_PCLMUL      (1 << 1)
+#endif
 #ifndef bit_SSE4_1
 #define bit_SSE4_1      (1 << 19)
 #endif
 #ifndef bit_MOVBE
 #define bit_MOVBE       (1 << 22)
 #endif
+#ifndef bit_AES
+#define bit_AES         (1 << 25)
+#endif
 #ifndef bit_OSXSAVE
 #define bit_OSXSAVE     (1 << 27)
 #endif
@@ -54,6 +60,9 @@
 #ifndef bit_AVX512DQ
 #define bit_AVX512DQ    (1 << 17)
 #endif
+#ifndef bit_SHA
+#define bit_SHA         (1 << 29)
+#endif
 #ifndef bit_AVX512BW
 #define bit_AVX512BW    (1 << 30)
 #endif
@@ -0,0 +1,54 @@
+/*
+ * Event loop handler accounting
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ *
+ * Counts how often, and for how long, bottom halves, fd handlers and
+ * timers run in the main loop and in iothreads, plus how long threads
+ * wait for the BQL.  Accounting is off by default; the disabled path is
+ * a single relaxed load per dispatched handler.
+ */
+#ifndef QEMU_EVENT_LOOP_STATS_H
+#define QEMU_EVENT_LOOP_STATS_H
+
+#include "qemu/timer.h"
+#include "qapi/qapi-types-misc.h"
+
+#define EVENT_LOOP_STATS_BUCKETS 16
+
+extern bool event_loop_stats_enabled;
+
+void event_loop_stats_enable(bool enable);
+void event_loop_stats_reset(void);
+EventLoopHandlerStatsList *event_loop_stats_query(void);
+
+/*
+ * Record one run of a handler that started at @start_ns.  The handler is
+ * identified by @fn, or by @name and @line when @name is not NULL.
+ */
+void event_loop_stats_account(EventLoopHandlerKind kind, const void *fn,
+                              const char *name, int line, int64_t start_ns);
+
+/*
+ * Returns the start timestamp to pass to event_loop_stats_end(), or 0
+ * if accounting is disabled.
+ */
+static inline int64_t event_loop_stats_begin(void)
+{
+    if (likely(!qatomic_read(&event_loop_stats_enabled))) {
+        return 0;
+    }
+    return get_clock();
+}
+
+static inline void event_loop_stats_end(EventLoopHandlerKind kind,
+                                        const void *fn, const char *name,
+                                        int64_t start_ns)
+{
+    if (unlikely(start_ns)) {
+        event_loop_stats_account(kind, fn, name, 0, start_ns);
+    }
+}
+
+#endif /* QEMU_EVENT_LOOP_STATS_H */
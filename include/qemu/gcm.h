@@ -96,6 +96,11 @@ typedef struct {
 
     uint64_t HL[16];            /*!< Precalculated HTable */
     uint64_t HH[16];            /*!< Precalculated HTable */
+
+    /* Host acceleration, set up by gcm_init (see gcm.c).  */
+    unsigned int accel;
+    uint8_t Hpow[8][16];        /*!< H^1..H^8, byte reflected */
+    uint8_t aes_rk[AES_MAXNR + 1][16]; /*!< Round keys in byte order */
 }
 gcm_context;
 
@@ -195,6 +200,13 @@ int gcm_auth_decrypt( gcm_context *ctx,
                       const unsigned char *input,
                       unsigned char *output );
 
+/**
+ * \brief          Switch to the next slower implementation, for testing
+ *
+ * \return         false once the plain C implementation is in use
+ */
+bool gcm_test_next_accel(void);
+
 /**
  * \brief          Checkup routine
  *
@@ -107,6 +107,11 @@ struct qemu_plugin_dyn_cb {
         struct {
             enum qemu_plugin_op op;
             uint64_t imm;
+            /*
+             * Distance between the per-vCPU copies of the value @userp
+             * points to, or 0 for a single value shared by all vCPUs.
+             */
+            size_t stride;
         } inline_insn;
     };
 };
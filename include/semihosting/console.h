@@ -33,7 +33,8 @@ int qemu_semihosting_console_read(CPUState *cs, void *buf, int len);
  * @buf: host buffer
  * @len: buffer size
  *
- * Write len bytes from buf to the debug console.
+ * Write len bytes from buf to the debug console. The system emulation
+ * console buffers output until the end of a line, or briefly.
  *
  * Returns: number of bytes written -- this should only ever be short
  * on some sort of i/o error.
@@ -33,6 +33,8 @@ typedef struct GuestFD {
             size_t off;
         } staticfile;
     };
+    /* GuestFDHost only: buffer of a regular file, or NULL */
+    struct HostFileBuffer *hostbuf;
 } GuestFD;
 
 /*
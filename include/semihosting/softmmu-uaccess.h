@@ -56,4 +56,7 @@ void softmmu_unlock_user(CPUArchState *env, void *p,
 ssize_t softmmu_strlen_user(CPUArchState *env, target_ulong addr);
 #define target_strlen(p) softmmu_strlen_user(env, p)
 
+int softmmu_lock_user_iov(CPUArchState *env, target_ulong addr,
+                          target_ulong len, bool write, struct iovec **piov);
+
 #endif /* SEMIHOSTING_SOFTMMU_UACCESS_H */
@@ -60,6 +60,12 @@ int64_t icount_round(int64_t count);
 void icount_start_warp_timer(void);
 void icount_account_warp_timer(void);
 void icount_notify_exit(void);
+/*
+ * Move QEMU_CLOCK_VIRTUAL forward by @ns without executing instructions,
+ * e.g. to account for the annotated latency of an access to a device
+ * modelled outside of QEMU.
+ */
+void icount_stall(int64_t ns);
 
 /*
  * CPU Ticks and Clock
@@ -32,6 +32,7 @@
 #define DUMP_DH_COMPRESSED_ZLIB     (0x1)
 #define DUMP_DH_COMPRESSED_LZO      (0x2)
 #define DUMP_DH_COMPRESSED_SNAPPY   (0x4)
+#define DUMP_DH_COMPRESSED_ZSTD     (0x20)
 
 #define KDUMP_SIGNATURE             "KDUMP   "
 #define SIG_LEN                     (sizeof(KDUMP_SIGNATURE) - 1)
@@ -196,6 +197,10 @@ typedef struct DumpState {
                                   * this could be used to calculate
                                   * how much work we have
                                   * finished. */
+    int64_t start_time;          /* QEMU_CLOCK_REALTIME ms when the dump
+                                  * started */
+    int64_t end_time;            /* and when it finished, 0 while it is
+                                  * still running */
     uint8_t *guest_note;         /* ELF note content */
     size_t guest_note_size;
 } DumpState;
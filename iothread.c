@@ -17,6 +17,7 @@
 #include "qemu/module.h"
 #include "block/aio.h"
 #include "block/block.h"
+#include "block/thread-pool.h"
 #include "sysemu/event-loop-base.h"
 #include "sysemu/iothread.h"
 #include "qapi/error.h"
@@ -360,6 +361,10 @@ static int query_one_iothread(Object *object, void *opaque)
     info->poll_grow = iothread->poll_grow;
     info->poll_shrink = iothread->poll_shrink;
     info->aio_max_batch = iothread->parent_obj.aio_max_batch;
+    if (iothread->ctx->thread_pool) {
+        info->has_thread_pool = true;
+        info->thread_pool = thread_pool_query_stats(iothread->ctx->thread_pool);
+    }
 
     QAPI_LIST_APPEND(*tail, info);
     return 0;
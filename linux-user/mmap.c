@@ -262,8 +262,7 @@ unsigned long last_brk;
 static abi_ulong mmap_find_vma_reserved(abi_ulong start, abi_ulong size,
                                         abi_ulong align)
 {
-    abi_ulong addr, end_addr, incr = qemu_host_page_size;
-    int prot;
+    abi_ulong addr, end_addr, used;
     bool looped = false;
 
     if (size > reserved_va) {
@@ -279,31 +278,34 @@ static abi_ulong mmap_find_vma_reserved(abi_ulong start, abi_ulong size,
         looped = true;
     }
 
-    /* Search downward from END_ADDR, checking to see if a page is in use.  */
-    addr = end_addr;
+    /*
+     * Search downward from END_ADDR: check the whole candidate range at
+     * once and if a page is in use, restart below the highest one.
+     */
     while (1) {
-        addr -= incr;
-        if (addr > end_addr) {
+        if (end_addr <= size) {
             if (looped) {
                 /* Failure.  The entire address space has been searched.  */
                 return (abi_ulong)-1;
             }
             /* Re-start at the top of the address space.  */
-            addr = end_addr = ((reserved_va - size) & -align) + size;
+            end_addr = ((reserved_va - size) & -align) + size;
             looped = true;
-        } else {
-            prot = page_get_flags(addr);
-            if (prot) {
-                /* Page in use.  Restart below this page.  */
-                addr = end_addr = ((addr - size) & -align) + size;
-            } else if (addr && addr + size == end_addr) {
-                /* Success!  All pages between ADDR and END_ADDR are free.  */
-                if (start == mmap_next_start) {
-                    mmap_next_start = addr;
-                }
-                return addr;
+            continue;
+        }
+
+        addr = end_addr - size;
+        used = page_find_last_used(addr, end_addr - 1);
+        if (used == (abi_ulong)-1) {
+            /* Success!  All pages between ADDR and END_ADDR are free.  */
+            if (start == mmap_next_start) {
+                mmap_next_start = addr;
             }
+            return addr;
         }
+
+        /* Page in use.  Restart below this page.  */
+        end_addr = used < size ? 0 : ((used - size) & -align) + size;
     }
 }
 
@@ -23,6 +23,7 @@
 #include "qemu/config-file.h"
 #include "qemu/option.h"
 #include "qemu/timer.h"
+#include "qemu/event-loop-stats.h"
 #include "qemu/sockets.h"
 #include "qemu/help_option.h"
 #include "monitor/monitor-internal.h"
@@ -940,6 +941,49 @@ void hmp_sync_profile(Monitor *mon, const QDict *qdict)
     }
 }
 
+void hmp_event_loop_stats(Monitor *mon, const QDict *qdict)
+{
+    const char *op = qdict_get_try_str(qdict, "op");
+
+    if (op == NULL) {
+        bool on = qatomic_read(&event_loop_stats_enabled);
+
+        monitor_printf(mon, "event-loop-stats is %s\n", on ? "on" : "off");
+        return;
+    }
+    if (!strcmp(op, "on")) {
+        event_loop_stats_enable(true);
+    } else if (!strcmp(op, "off")) {
+        event_loop_stats_enable(false);
+    } else if (!strcmp(op, "reset")) {
+        event_loop_stats_reset();
+    } else {
+        Error *err = NULL;
+
+        error_setg(&err, QERR_INVALID_PARAMETER, op);
+        hmp_handle_error(mon, err);
+    }
+}
+
+void hmp_info_event_loop_stats(Monitor *mon, const QDict *qdict)
+{
+    EventLoopHandlerStatsList *list = qmp_query_event_loop_stats(NULL);
+    EventLoopHandlerStatsList *l;
+
+    monitor_printf(mon, "%-9s %-40s %10s %12s %12s\n",
+                   "kind", "handler", "count", "avg-ns", "max-ns");
+    for (l = list; l; l = l->next) {
+        EventLoopHandlerStats *s = l->value;
+
+        monitor_printf(mon, "%-9s %-40s %10" PRIu64 " %12" PRIu64
+                       " %12" PRIu64 "\n",
+                       EventLoopHandlerKind_str(s->kind), s->name, s->count,
+                       s->count ? s->total_ns / s->count : 0, s->max_ns);
+    }
+
+    qapi_free_EventLoopHandlerStatsList(list);
+}
+
 void hmp_system_reset(Monitor *mon, const QDict *qdict)
 {
     qmp_system_reset(NULL);
@@ -1912,6 +1956,20 @@ void hmp_info_iothreads(Monitor *mon, const QDict *qdict)
         monitor_printf(mon, "  poll-shrink=%" PRId64 "\n", value->poll_shrink);
         monitor_printf(mon, "  aio-max-batch=%" PRId64 "\n",
                        value->aio_max_batch);
+        if (value->has_thread_pool) {
+            ThreadPoolStats *tp = value->thread_pool;
+
+            monitor_printf(mon, "  thread-pool: threads=%" PRId64
+                           " idle=%" PRId64 " queue-depth=%" PRId64
+                           " max-queue-depth=%" PRId64 "\n",
+                           tp->threads, tp->idle_threads, tp->queue_depth,
+                           tp->max_queue_depth);
+            monitor_printf(mon, "  thread-pool: submitted=%" PRIu64
+                           " completed=%" PRIu64 " avg-wait-ns=%" PRIu64
+                           " max-wait-ns=%" PRIu64 " avg-run-ns=%" PRIu64 "\n",
+                           tp->submitted, tp->completed, tp->avg_wait_ns,
+                           tp->max_wait_ns, tp->avg_run_ns);
+        }
     }
 
     qapi_free_IOThreadInfoList(info_list);
@@ -15,6 +15,7 @@
 
 #include "qemu/osdep.h"
 #include "qemu/cutils.h"
+#include "qemu/event-loop-stats.h"
 #include "qemu/option.h"
 #include "monitor/monitor.h"
 #include "sysemu/sysemu.h"
@@ -82,6 +83,22 @@ void qmp_quit(Error **errp)
     qemu_system_shutdown_request(SHUTDOWN_CAUSE_HOST_QMP_QUIT);
 }
 
+void qmp_event_loop_stats_set(bool has_enable, bool enable,
+                              bool has_reset, bool reset, Error **errp)
+{
+    if (has_reset && reset) {
+        event_loop_stats_reset();
+    }
+    if (has_enable) {
+        event_loop_stats_enable(enable);
+    }
+}
+
+EventLoopHandlerStatsList *qmp_query_event_loop_stats(Error **errp)
+{
+    return event_loop_stats_query();
+}
+
 void qmp_stop(Error **errp)
 {
     /* if there is a dump in background, we should wait until the dump
@@ -210,11 +210,56 @@ plugin_register_cb_udata(qemu_plugin_id_t id, enum qemu_plugin_event ev,
     do_plugin_register_cb(id, ev, func, udata);
 }
 
+/*
+ * Make room for @cpu in every scoreboard. Inline ops in the code cache
+ * point into the current arrays, so they are resized with all vCPUs
+ * stopped and the code cache is flushed before anything runs again.
+ *
+ * In system mode scoreboards are sized for max_cpus upfront, so this
+ * only triggers for user-mode threads, which are created by a running
+ * vCPU (current_cpu) outside of cpu_exec.
+ */
+static void plugin_grow_scoreboards__locked(CPUState *cpu)
+{
+    size_t size = plugin.scoreboard_alloc_size;
+    struct qemu_plugin_scoreboard *score;
+
+    if (likely(cpu->cpu_index < size)) {
+        return;
+    }
+    while (cpu->cpu_index >= size) {
+        size *= 2;
+    }
+
+    if (QLIST_EMPTY(&plugin.scoreboards)) {
+        plugin.scoreboard_alloc_size = size;
+        return;
+    }
+
+    g_assert(current_cpu);
+    /* vCPUs blocked on plugin.lock could not reach a quiescent state */
+    qemu_rec_mutex_unlock(&plugin.lock);
+    start_exclusive();
+    qemu_rec_mutex_lock(&plugin.lock);
+
+    /* another thread may have grown the scoreboards in the meantime */
+    if (size > plugin.scoreboard_alloc_size) {
+        QLIST_FOREACH(score, &plugin.scoreboards, entry) {
+            g_array_set_size(score->data, size);
+        }
+        plugin.scoreboard_alloc_size = size;
+        tb_flush(current_cpu);
+    }
+    end_exclusive();
+}
+
 void qemu_plugin_vcpu_init_hook(CPUState *cpu)
 {
     bool success;
 
     qemu_rec_mutex_lock(&plugin.lock);
+    qatomic_set(&plugin.num_vcpus, MAX(plugin.num_vcpus, cpu->cpu_index + 1));
+    plugin_grow_scoreboards__locked(cpu);
     plugin_cpu_update__locked(&cpu->cpu_index, NULL, NULL);
     success = g_hash_table_insert(plugin.cpu_ht, &cpu->cpu_index,
                                   &cpu->cpu_index);
@@ -279,10 +324,11 @@ static struct qemu_plugin_dyn_cb *plugin_get_dyn_cb(GArray **arr)
     return &g_array_index(cbs, struct qemu_plugin_dyn_cb, cbs->len - 1);
 }
 
-void plugin_register_inline_op(GArray **arr,
-                               enum qemu_plugin_mem_rw rw,
-                               enum qemu_plugin_op op, void *ptr,
-                               uint64_t imm)
+static void plugin_register_inline_op__common(GArray **arr,
+                                              enum qemu_plugin_mem_rw rw,
+                                              enum qemu_plugin_op op,
+                                              void *ptr, size_t stride,
+                                              uint64_t imm)
 {
     struct qemu_plugin_dyn_cb *dyn_cb;
 
@@ -292,6 +338,33 @@ void plugin_register_inline_op(GArray **arr,
     dyn_cb->rw = rw;
     dyn_cb->inline_insn.op = op;
     dyn_cb->inline_insn.imm = imm;
+    dyn_cb->inline_insn.stride = stride;
+}
+
+void plugin_register_inline_op(GArray **arr,
+                               enum qemu_plugin_mem_rw rw,
+                               enum qemu_plugin_op op, void *ptr,
+                               uint64_t imm)
+{
+    plugin_register_inline_op__common(arr, rw, op, ptr, 0, imm);
+}
+
+/*
+ * Registration happens during translation, so the scoreboard cannot be
+ * resized under our feet: growing requires an exclusive section and
+ * flushes the code cache along with the ops registered here.
+ */
+void plugin_register_inline_op_on_entry(GArray **arr,
+                                        enum qemu_plugin_mem_rw rw,
+                                        enum qemu_plugin_op op,
+                                        qemu_plugin_u64 entry,
+                                        uint64_t imm)
+{
+    GArray *data = entry.score->data;
+
+    plugin_register_inline_op__common(arr, rw, op,
+                                      data->data + entry.offset,
+                                      g_array_get_element_size(data), imm);
 }
 
 void plugin_register_dyn_cb__udata(GArray **arr,
@@ -432,9 +505,9 @@ void qemu_plugin_flush_cb(void)
     plugin_cb__simple(QEMU_PLUGIN_EV_FLUSH);
 }
 
-void exec_inline_op(struct qemu_plugin_dyn_cb *cb)
+void exec_inline_op(struct qemu_plugin_dyn_cb *cb, int cpu_index)
 {
-    uint64_t *val = cb->userp;
+    uint64_t *val = cb->userp + cpu_index * cb->inline_insn.stride;
 
     switch (cb->inline_insn.op) {
     case QEMU_PLUGIN_INLINE_ADD_U64:
@@ -467,7 +540,7 @@ void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
                            vaddr, cb->userp);
             break;
         case PLUGIN_CB_INLINE:
-            exec_inline_op(cb);
+            exec_inline_op(cb, cpu->cpu_index);
             break;
         default:
             g_assert_not_reached();
@@ -475,6 +548,36 @@ void qemu_plugin_vcpu_mem_cb(CPUState *cpu, uint64_t vaddr,
     }
 }
 
+struct qemu_plugin_scoreboard *plugin_scoreboard_new(size_t element_size)
+{
+    struct qemu_plugin_scoreboard *score;
+
+    score = g_new0(struct qemu_plugin_scoreboard, 1);
+    score->data = g_array_new(false, true, element_size);
+
+    qemu_rec_mutex_lock(&plugin.lock);
+    g_array_set_size(score->data, plugin.scoreboard_alloc_size);
+    QLIST_INSERT_HEAD(&plugin.scoreboards, score, entry);
+    qemu_rec_mutex_unlock(&plugin.lock);
+
+    return score;
+}
+
+int plugin_num_vcpus(void)
+{
+    return qatomic_read(&plugin.num_vcpus);
+}
+
+void plugin_scoreboard_free(struct qemu_plugin_scoreboard *score)
+{
+    qemu_rec_mutex_lock(&plugin.lock);
+    QLIST_REMOVE(score, entry);
+    qemu_rec_mutex_unlock(&plugin.lock);
+
+    g_array_free(score->data, true);
+    g_free(score);
+}
+
 void qemu_plugin_atexit_cb(void)
 {
     plugin_cb__udata(QEMU_PLUGIN_EV_ATEXIT);
@@ -552,6 +655,8 @@ static void __attribute__((__constructor__)) plugin_init(void)
     plugin.id_ht = g_hash_table_new(g_int64_hash, g_int64_equal);
     plugin.cpu_ht = g_hash_table_new(g_int_hash, g_int_equal);
     QTAILQ_INIT(&plugin.ctxs);
+    QLIST_INIT(&plugin.scoreboards);
+    plugin.scoreboard_alloc_size = 16; /* avoid frequent reallocation */
     qht_init(&plugin.dyn_cb_arr_ht, plugin_dyn_cb_arr_cmp, 16,
              QHT_MODE_AUTO_RESIZE);
     atexit(qemu_plugin_atexit_cb);
@@ -47,7 +47,7 @@ static void replay_read_error(void)
 void replay_put_byte(uint8_t byte)
 {
     if (replay_file) {
-        if (putc(byte, replay_file) == EOF) {
+        if (!replay_log_write(&byte, 1)) {
             replay_write_error();
         }
     }
@@ -82,7 +82,7 @@ void replay_put_array(const uint8_t *buf, size_t size)
 {
     if (replay_file) {
         replay_put_dword(size);
-        if (fwrite(buf, 1, size, replay_file) != size) {
+        if (!replay_log_write(buf, size)) {
             replay_write_error();
         }
     }
@@ -92,11 +92,9 @@ uint8_t replay_get_byte(void)
 {
     uint8_t byte = 0;
     if (replay_file) {
-        int r = getc(replay_file);
-        if (r == EOF) {
+        if (!replay_log_read(&byte, 1)) {
             replay_read_error();
         }
-        byte = r;
     }
     return byte;
 }
@@ -138,7 +136,7 @@ void replay_get_array(uint8_t *buf, size_t *size)
 {
     if (replay_file) {
         *size = replay_get_dword();
-        if (fread(buf, 1, *size, replay_file) != *size) {
+        if (!replay_log_read(buf, *size)) {
             replay_read_error();
         }
     }
@@ -149,7 +147,7 @@ void replay_get_array_alloc(uint8_t **buf, size_t *size)
     if (replay_file) {
         *size = replay_get_dword();
         *buf = g_malloc(*size);
-        if (fread(*buf, 1, *size, replay_file) != *size) {
+        if (!replay_log_read(*buf, *size)) {
             replay_read_error();
         }
     }
@@ -158,11 +156,11 @@ void replay_get_array_alloc(uint8_t **buf, size_t *size)
 void replay_check_error(void)
 {
     if (replay_file) {
-        if (feof(replay_file)) {
+        if (replay_log_eof()) {
             error_report("replay file is over");
             qemu_system_vmstop_request_prepare();
             qemu_system_vmstop_request(RUN_STATE_PAUSED);
-        } else if (ferror(replay_file)) {
+        } else if (replay_log_error()) {
             error_report("replay file is over or something goes wrong");
             qemu_system_vmstop_request_prepare();
             qemu_system_vmstop_request(RUN_STATE_INTERNAL_ERROR);
@@ -74,7 +74,8 @@ typedef struct ReplayState {
     unsigned int data_kind;
     /*! Flag which indicates that event is not processed yet. */
     unsigned int has_unread_data;
-    /*! Temporary variable for saving current log offset. */
+    /*! Temporary variable for saving current log offset.
+        This is the offset in the uncompressed event stream. */
     uint64_t file_offset;
     /*! Next block operation id.
         This counter is global, because requests from different
@@ -108,6 +109,23 @@ int64_t replay_get_qword(void);
 void replay_get_array(uint8_t *buf, size_t *size);
 void replay_get_array_alloc(uint8_t **buf, size_t *size);
 
+/* Buffered log I/O on replay_file, see replay-log.c */
+
+/*! Starts the log I/O thread. Returns false if the log cannot be used. */
+bool replay_log_open(FILE *f, bool record, uint32_t version);
+/*! Flushes the log, writes the index and header in record mode. */
+void replay_log_close(uint32_t version);
+/*! Appends to the log. Returns false after a write error. */
+bool replay_log_write(const void *buf, size_t len);
+/*! Reads from the log. Returns false at the end of the log or on error. */
+bool replay_log_read(void *buf, size_t len);
+/*! Position in the uncompressed event stream. */
+uint64_t replay_log_tell(void);
+/*! Continues reading at a position returned by replay_log_tell. */
+void replay_log_seek(uint64_t offset);
+bool replay_log_eof(void);
+bool replay_log_error(void);
+
 /* Mutex functions for protecting replay log file and ensuring
  * synchronisation between vCPU and main-loop threads. */
 
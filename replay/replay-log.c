@@ -0,0 +1,565 @@
+/*
+ * replay-log.c
+ *
+ * Buffered, chunked and optionally compressed replay log I/O.
+ *
+ * The event stream is cut into chunks of up to REPLAY_CHUNK_SIZE bytes.
+ * In record mode the vCPU thread only copies events into memory and a
+ * writer thread compresses and writes out full chunks. In play mode a
+ * reader thread reads and decompresses chunks ahead of the consumer.
+ * Each chunk is compressed on its own, and an index of the chunks is
+ * written at the end of the log, so seeking to a snapshot's log offset
+ * only decompresses one chunk.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ *
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "qemu/error-report.h"
+#include "qemu/queue.h"
+#include "qemu/thread.h"
+#include "sysemu/replay.h"
+#include "replay-internal.h"
+#ifdef CONFIG_ZSTD
+#include <zstd.h>
+#endif
+
+/* Size of replay log header: version and file offset of the index */
+#define HEADER_SIZE             (sizeof(uint32_t) + sizeof(uint64_t))
+/* Chunk header: uncompressed and stored sizes */
+#define CHUNK_HEADER_SIZE       (2 * sizeof(uint32_t))
+
+#define REPLAY_CHUNK_SIZE       (256 * KiB)
+/* Chunks queued for the writer before the vCPU thread has to wait */
+#define REPLAY_WRITE_BEHIND     16
+/* Chunks decompressed ahead of the consumer */
+#define REPLAY_READ_AHEAD       4
+/* Favour speed, the writer has to keep up with the guest */
+#define REPLAY_ZSTD_LEVEL       1
+
+typedef struct ReplayChunk {
+    uint8_t *data;
+    /* Number of valid bytes in data */
+    size_t len;
+    /* Position of data[0] in the uncompressed event stream */
+    uint64_t offset;
+    QSIMPLEQ_ENTRY(ReplayChunk) next;
+} ReplayChunk;
+
+typedef struct ReplayChunkIndex {
+    uint64_t offset;
+    uint64_t file_offset;
+} ReplayChunkIndex;
+
+typedef struct ReplayLog {
+    FILE *f;
+    bool record;
+
+    QemuThread thread;
+    bool thread_running;
+    /* Protects the fields up to and including error */
+    QemuMutex mutex;
+    QemuCond cond;
+    QSIMPLEQ_HEAD(, ReplayChunk) queue;
+    unsigned int queued;
+    bool stop;
+    /* Play: the reader reached the end of the chunks */
+    bool eof;
+    bool error;
+
+    /* Chunk being filled or consumed, owned by the vCPU/main thread */
+    ReplayChunk *cur;
+    size_t pos;
+    /* Play: the consumer ran out of chunks */
+    bool consumer_eof;
+
+    /* Play: the reader thread's position */
+    uint64_t next_offset;
+    uint64_t chunks_end;
+
+    /* Record: filled in by the writer thread, play: loaded at open */
+    GArray *index;
+#ifdef CONFIG_ZSTD
+    ZSTD_CCtx *cctx;
+    ZSTD_DCtx *dctx;
+#endif
+} ReplayLog;
+
+static ReplayLog replay_log;
+
+static ReplayChunk *replay_chunk_new(uint64_t offset)
+{
+    ReplayChunk *c = g_new0(ReplayChunk, 1);
+
+    c->data = g_malloc(REPLAY_CHUNK_SIZE);
+    c->offset = offset;
+    return c;
+}
+
+static void replay_chunk_free(ReplayChunk *c)
+{
+    if (c) {
+        g_free(c->data);
+        g_free(c);
+    }
+}
+
+static void replay_log_set_error(ReplayLog *l)
+{
+    qemu_mutex_lock(&l->mutex);
+    l->error = true;
+    qemu_cond_broadcast(&l->cond);
+    qemu_mutex_unlock(&l->mutex);
+}
+
+/* Record mode */
+
+static bool replay_log_write_chunk(ReplayLog *l, ReplayChunk *c)
+{
+    ReplayChunkIndex entry = {
+        .offset = c->offset,
+        .file_offset = ftello(l->f),
+    };
+    uint8_t hdr[CHUNK_HEADER_SIZE];
+    const void *payload = c->data;
+    size_t stored = c->len;
+    g_autofree void *zbuf = NULL;
+
+#ifdef CONFIG_ZSTD
+    {
+        size_t cap = ZSTD_compressBound(c->len);
+        size_t r;
+
+        zbuf = g_malloc(cap);
+        r = ZSTD_compressCCtx(l->cctx, zbuf, cap, c->data, c->len,
+                              REPLAY_ZSTD_LEVEL);
+        /* Incompressible chunks are stored as they are */
+        if (!ZSTD_isError(r) && r < c->len) {
+            payload = zbuf;
+            stored = r;
+        }
+    }
+#endif
+
+    stl_be_p(hdr, c->len);
+    stl_be_p(hdr + 4, stored);
+    if (fwrite(hdr, sizeof(hdr), 1, l->f) != 1 ||
+        fwrite(payload, 1, stored, l->f) != stored) {
+        return false;
+    }
+    g_array_append_val(l->index, entry);
+    return true;
+}
+
+static void *replay_log_writer(void *opaque)
+{
+    ReplayLog *l = opaque;
+
+    while (true) {
+        ReplayChunk *c;
+
+        qemu_mutex_lock(&l->mutex);
+        while (QSIMPLEQ_EMPTY(&l->queue) && !l->stop) {
+            qemu_cond_wait(&l->cond, &l->mutex);
+        }
+        c = QSIMPLEQ_FIRST(&l->queue);
+        if (!c) {
+            qemu_mutex_unlock(&l->mutex);
+            break;
+        }
+        QSIMPLEQ_REMOVE_HEAD(&l->queue, next);
+        l->queued--;
+        qemu_cond_broadcast(&l->cond);
+        qemu_mutex_unlock(&l->mutex);
+
+        if (!l->error && !replay_log_write_chunk(l, c)) {
+            replay_log_set_error(l);
+        }
+        replay_chunk_free(c);
+    }
+    return NULL;
+}
+
+static void replay_log_submit(ReplayLog *l)
+{
+    ReplayChunk *c = l->cur;
+    uint64_t next_offset = c->offset + l->pos;
+
+    c->len = l->pos;
+    qemu_mutex_lock(&l->mutex);
+    while (l->queued >= REPLAY_WRITE_BEHIND) {
+        qemu_cond_wait(&l->cond, &l->mutex);
+    }
+    QSIMPLEQ_INSERT_TAIL(&l->queue, c, next);
+    l->queued++;
+    qemu_cond_broadcast(&l->cond);
+    qemu_mutex_unlock(&l->mutex);
+
+    /* c now belongs to the writer */
+    l->cur = replay_chunk_new(next_offset);
+    l->pos = 0;
+}
+
+bool replay_log_write(const void *buf, size_t len)
+{
+    ReplayLog *l = &replay_log;
+    const uint8_t *p = buf;
+
+    while (len) {
+        size_t n = MIN(len, REPLAY_CHUNK_SIZE - l->pos);
+
+        memcpy(l->cur->data + l->pos, p, n);
+        l->pos += n;
+        p += n;
+        len -= n;
+        if (l->pos == REPLAY_CHUNK_SIZE) {
+            replay_log_submit(l);
+        }
+    }
+    return !qatomic_read(&l->error);
+}
+
+/* Play mode */
+
+static ReplayChunk *replay_log_read_chunk(ReplayLog *l)
+{
+    uint8_t hdr[CHUNK_HEADER_SIZE];
+    uint32_t len, stored;
+    ReplayChunk *c;
+
+    if (fread(hdr, sizeof(hdr), 1, l->f) != 1) {
+        return NULL;
+    }
+    len = ldl_be_p(hdr);
+    stored = ldl_be_p(hdr + 4);
+    if (len > REPLAY_CHUNK_SIZE || stored > len) {
+        return NULL;
+    }
+
+    c = replay_chunk_new(l->next_offset);
+    c->len = len;
+    if (stored == len) {
+        if (fread(c->data, 1, len, l->f) != len) {
+            replay_chunk_free(c);
+            return NULL;
+        }
+    } else {
+#ifdef CONFIG_ZSTD
+        g_autofree void *zbuf = g_malloc(stored);
+
+        if (fread(zbuf, 1, stored, l->f) != stored ||
+            ZSTD_decompressDCtx(l->dctx, c->data, len, zbuf, stored) != len) {
+            replay_chunk_free(c);
+            return NULL;
+        }
+#else
+        error_report("Replay: the log is compressed, "
+                     "but QEMU was built without zstd");
+        replay_chunk_free(c);
+        return NULL;
+#endif
+    }
+    l->next_offset += len;
+    return c;
+}
+
+static void *replay_log_reader(void *opaque)
+{
+    ReplayLog *l = opaque;
+
+    while (true) {
+        ReplayChunk *c = NULL;
+        bool end;
+
+        qemu_mutex_lock(&l->mutex);
+        while (l->queued >= REPLAY_READ_AHEAD && !l->stop) {
+            qemu_cond_wait(&l->cond, &l->mutex);
+        }
+        end = l->stop;
+        qemu_mutex_unlock(&l->mutex);
+        if (end) {
+            break;
+        }
+
+        end = ftello(l->f) >= l->chunks_end;
+        if (!end) {
+            c = replay_log_read_chunk(l);
+        }
+
+        qemu_mutex_lock(&l->mutex);
+        if (c) {
+            QSIMPLEQ_INSERT_TAIL(&l->queue, c, next);
+            l->queued++;
+        } else if (end) {
+            l->eof = true;
+        } else {
+            l->error = true;
+        }
+        qemu_cond_broadcast(&l->cond);
+        qemu_mutex_unlock(&l->mutex);
+        if (!c) {
+            break;
+        }
+    }
+    return NULL;
+}
+
+static bool replay_log_next_chunk(ReplayLog *l)
+{
+    ReplayChunk *c;
+
+    qemu_mutex_lock(&l->mutex);
+    while (QSIMPLEQ_EMPTY(&l->queue) && !l->eof && !l->error) {
+        qemu_cond_wait(&l->cond, &l->mutex);
+    }
+    c = QSIMPLEQ_FIRST(&l->queue);
+    if (c) {
+        QSIMPLEQ_REMOVE_HEAD(&l->queue, next);
+        l->queued--;
+        qemu_cond_broadcast(&l->cond);
+    }
+    qemu_mutex_unlock(&l->mutex);
+
+    if (!c) {
+        l->consumer_eof = true;
+        return false;
+    }
+    replay_chunk_free(l->cur);
+    l->cur = c;
+    l->pos = 0;
+    return true;
+}
+
+bool replay_log_read(void *buf, size_t len)
+{
+    ReplayLog *l = &replay_log;
+    uint8_t *p = buf;
+
+    while (len) {
+        size_t n;
+
+        if (!l->cur || l->pos == l->cur->len) {
+            if (!replay_log_next_chunk(l)) {
+                return false;
+            }
+            continue;
+        }
+        n = MIN(len, l->cur->len - l->pos);
+        memcpy(p, l->cur->data + l->pos, n);
+        l->pos += n;
+        p += n;
+        len -= n;
+    }
+    return true;
+}
+
+static void replay_log_start_thread(ReplayLog *l)
+{
+    l->stop = false;
+    qemu_thread_create(&l->thread, "replay-log",
+                       l->record ? replay_log_writer : replay_log_reader,
+                       l, QEMU_THREAD_JOINABLE);
+    l->thread_running = true;
+}
+
+static void replay_log_stop_thread(ReplayLog *l)
+{
+    if (l->thread_running) {
+        qemu_mutex_lock(&l->mutex);
+        l->stop = true;
+        qemu_cond_broadcast(&l->cond);
+        qemu_mutex_unlock(&l->mutex);
+        qemu_thread_join(&l->thread);
+        l->thread_running = false;
+    }
+}
+
+static void replay_log_drop_queue(ReplayLog *l)
+{
+    ReplayChunk *c, *next;
+
+    QSIMPLEQ_FOREACH_SAFE(c, &l->queue, next, next) {
+        replay_chunk_free(c);
+    }
+    QSIMPLEQ_INIT(&l->queue);
+    l->queued = 0;
+}
+
+static bool replay_log_load_index(ReplayLog *l, uint64_t index_offset)
+{
+    uint8_t buf[2 * sizeof(uint64_t)];
+    uint32_t count, i;
+
+    if (fseeko(l->f, index_offset, SEEK_SET) ||
+        fread(buf, sizeof(uint32_t), 1, l->f) != 1) {
+        return false;
+    }
+    count = ldl_be_p(buf);
+    for (i = 0; i < count; i++) {
+        ReplayChunkIndex entry;
+
+        if (fread(buf, sizeof(buf), 1, l->f) != 1) {
+            return false;
+        }
+        entry.offset = ldq_be_p(buf);
+        entry.file_offset = ldq_be_p(buf + 8);
+        g_array_append_val(l->index, entry);
+    }
+    l->chunks_end = index_offset;
+    return true;
+}
+
+void replay_log_seek(uint64_t offset)
+{
+    ReplayLog *l = &replay_log;
+    ReplayChunkIndex *entry = NULL;
+    guint lo = 0, hi = l->index->len;
+
+    assert(!l->record);
+
+    /* Last chunk starting at or before offset */
+    while (lo < hi) {
+        guint mid = (lo + hi) / 2;
+
+        if (g_array_index(l->index, ReplayChunkIndex, mid).offset <= offset) {
+            entry = &g_array_index(l->index, ReplayChunkIndex, mid);
+            lo = mid + 1;
+        } else {
+            hi = mid;
+        }
+    }
+
+    replay_log_stop_thread(l);
+    replay_log_drop_queue(l);
+    replay_chunk_free(l->cur);
+    l->cur = NULL;
+    l->pos = 0;
+    l->eof = l->error = l->consumer_eof = false;
+
+    if (!entry || fseeko(l->f, entry->file_offset, SEEK_SET)) {
+        l->error = true;
+        return;
+    }
+    l->next_offset = entry->offset;
+    replay_log_start_thread(l);
+
+    if (replay_log_next_chunk(l)) {
+        l->pos = MIN(offset - l->cur->offset, l->cur->len);
+    }
+}
+
+uint64_t replay_log_tell(void)
+{
+    ReplayLog *l = &replay_log;
+
+    return l->cur ? l->cur->offset + l->pos : 0;
+}
+
+bool replay_log_eof(void)
+{
+    return replay_log.consumer_eof;
+}
+
+bool replay_log_error(void)
+{
+    return qatomic_read(&replay_log.error);
+}
+
+bool replay_log_open(FILE *f, bool record, uint32_t version)
+{
+    ReplayLog *l = &replay_log;
+
+    l->f = f;
+    l->record = record;
+    qemu_mutex_init(&l->mutex);
+    qemu_cond_init(&l->cond);
+    QSIMPLEQ_INIT(&l->queue);
+    l->index = g_array_new(false, false, sizeof(ReplayChunkIndex));
+
+    if (record) {
+#ifdef CONFIG_ZSTD
+        l->cctx = ZSTD_createCCtx();
+#endif
+        /* The header is written when the log is closed */
+        if (fseeko(f, HEADER_SIZE, SEEK_SET)) {
+            return false;
+        }
+        l->cur = replay_chunk_new(0);
+    } else {
+        uint8_t hdr[HEADER_SIZE];
+
+#ifdef CONFIG_ZSTD
+        l->dctx = ZSTD_createDCtx();
+#endif
+        if (fread(hdr, sizeof(hdr), 1, f) != 1 ||
+            ldl_be_p(hdr) != version ||
+            !replay_log_load_index(l, ldq_be_p(hdr + 4)) ||
+            fseeko(f, HEADER_SIZE, SEEK_SET)) {
+            return false;
+        }
+    }
+    replay_log_start_thread(l);
+    return true;
+}
+
+void replay_log_close(uint32_t version)
+{
+    ReplayLog *l = &replay_log;
+
+    if (l->record) {
+        uint8_t buf[HEADER_SIZE + sizeof(uint64_t)];
+        ReplayChunkIndex *entry;
+        uint64_t index_offset;
+        guint i;
+
+        if (l->pos) {
+            replay_log_submit(l);
+        }
+        replay_log_stop_thread(l);
+
+        /* The index of the chunks, then the header pointing to it */
+        index_offset = ftello(l->f);
+        stl_be_p(buf, l->index->len);
+        if (fwrite(buf, sizeof(uint32_t), 1, l->f) != 1) {
+            l->error = true;
+        }
+        for (i = 0; i < l->index->len; i++) {
+            entry = &g_array_index(l->index, ReplayChunkIndex, i);
+            stq_be_p(buf, entry->offset);
+            stq_be_p(buf + 8, entry->file_offset);
+            if (fwrite(buf, 2 * sizeof(uint64_t), 1, l->f) != 1) {
+                l->error = true;
+            }
+        }
+        stl_be_p(buf, version);
+        stq_be_p(buf + 4, index_offset);
+        if (fseeko(l->f, 0, SEEK_SET) ||
+            fwrite(buf, HEADER_SIZE, 1, l->f) != 1) {
+            l->error = true;
+        }
+        if (l->error) {
+            error_report("replay write error");
+        }
+    } else {
+        replay_log_stop_thread(l);
+    }
+
+    replay_log_drop_queue(l);
+    replay_chunk_free(l->cur);
+    l->cur = NULL;
+    l->pos = 0;
+    g_array_free(l->index, true);
+    l->index = NULL;
+#ifdef CONFIG_ZSTD
+    ZSTD_freeCCtx(l->cctx);
+    ZSTD_freeDCtx(l->dctx);
+    l->cctx = NULL;
+    l->dctx = NULL;
+#endif
+    qemu_cond_destroy(&l->cond);
+    qemu_mutex_destroy(&l->mutex);
+    l->f = NULL;
+}
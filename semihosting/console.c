@@ -26,19 +26,69 @@
 #include "qemu/main-loop.h"
 #include "qapi/error.h"
 #include "qemu/fifo8.h"
+#include "qemu/timer.h"
+#include "sysemu/sysemu.h"
 
-/* Access to this structure is protected by the BQL */
+#define FIFO_SIZE   1024
+
+/*
+ * Output is coalesced, guests often write a character at a time. It is
+ * passed on at the end of a line, when the buffer is full, before input
+ * is read, and otherwise OUT_DELAY_MS after the first buffered character.
+ */
+#define OUT_SIZE        1024
+#define OUT_DELAY_MS    10
+
+/*
+ * Access to this structure is protected by the BQL, except for the output
+ * buffer which has its own lock as some targets write without the BQL.
+ */
 typedef struct SemihostingConsole {
     CharBackend         backend;
     Chardev             *chr;
     GSList              *sleeping_cpus;
     bool                got;
     Fifo8               fifo;
+
+    QemuMutex           out_lock;
+    QEMUTimer           *out_timer;
+    Notifier            exit_notifier;
+    int                 out_len;
+    uint8_t             out[OUT_SIZE];
 } SemihostingConsole;
 
 static SemihostingConsole console;
 
-#define FIFO_SIZE   1024
+/* Called with out_lock held.  */
+static void console_out_flush_locked(SemihostingConsole *c)
+{
+    if (!c->out_len) {
+        return;
+    }
+    if (c->chr) {
+        qemu_chr_write_all(c->chr, c->out, c->out_len);
+    } else {
+        fwrite(c->out, 1, c->out_len, stderr);
+    }
+    c->out_len = 0;
+}
+
+static void console_out_flush(SemihostingConsole *c)
+{
+    qemu_mutex_lock(&c->out_lock);
+    console_out_flush_locked(c);
+    qemu_mutex_unlock(&c->out_lock);
+}
+
+static void console_out_timer(void *opaque)
+{
+    console_out_flush(opaque);
+}
+
+static void console_exit(Notifier *n, void *data)
+{
+    console_out_flush(container_of(n, SemihostingConsole, exit_notifier));
+}
 
 static int console_can_read(void *opaque)
 {
@@ -82,6 +132,9 @@ void qemu_semihosting_console_block_until_ready(CPUState *cs)
 
     g_assert(qemu_mutex_iothread_locked());
 
+    /* Let the guest's prompt out before it waits for an answer. */
+    console_out_flush(c);
+
     /* Block if the fifo is completely empty. */
     if (fifo8_is_empty(&c->fifo)) {
         c->sleeping_cpus = g_slist_prepend(c->sleeping_cpus, cs);
@@ -110,16 +163,47 @@ int qemu_semihosting_console_read(CPUState *cs, void *buf, int len)
 
 int qemu_semihosting_console_write(void *buf, int len)
 {
-    if (console.chr) {
-        int r = qemu_chr_write_all(console.chr, (uint8_t *)buf, len);
-        return r < 0 ? 0 : r;
-    } else {
-        return fwrite(buf, 1, len, stderr);
+    SemihostingConsole *c = &console;
+    bool was_empty;
+
+    qemu_mutex_lock(&c->out_lock);
+    if (c->out_len + len > OUT_SIZE) {
+        console_out_flush_locked(c);
+    }
+    was_empty = !c->out_len;
+    if (len > OUT_SIZE) {
+        int r;
+
+        if (c->chr) {
+            r = qemu_chr_write_all(c->chr, (uint8_t *)buf, len);
+            r = r < 0 ? 0 : r;
+        } else {
+            r = fwrite(buf, 1, len, stderr);
+        }
+        qemu_mutex_unlock(&c->out_lock);
+        return r;
     }
+
+    memcpy(c->out + c->out_len, buf, len);
+    c->out_len += len;
+    if (memchr(buf, '\n', len)) {
+        console_out_flush_locked(c);
+    } else if (was_empty) {
+        timer_mod(c->out_timer,
+                  qemu_clock_get_ms(QEMU_CLOCK_REALTIME) + OUT_DELAY_MS);
+    }
+    qemu_mutex_unlock(&c->out_lock);
+    return len;
 }
 
 void qemu_semihosting_console_init(Chardev *chr)
 {
+    qemu_mutex_init(&console.out_lock);
+    console.out_timer = timer_new_ms(QEMU_CLOCK_REALTIME,
+                                     console_out_timer, &console);
+    console.exit_notifier.notify = console_exit;
+    qemu_add_exit_notifier(&console.exit_notifier);
+
     console.chr = chr;
     if  (chr) {
         fifo8_create(&console.fifo, FIFO_SIZE);
@@ -134,6 +134,7 @@ void associate_guestfd(int guestfd, int hostfd)
     assert(gf);
     gf->type = use_gdb_syscalls() ? GuestFDGDB : GuestFDHost;
     gf->hostfd = hostfd;
+    gf->hostbuf = NULL;
 }
 
 void staticfile_guestfd(int guestfd, const uint8_t *data, size_t len)
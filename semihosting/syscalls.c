@@ -7,6 +7,8 @@
  */
 
 #include "qemu/osdep.h"
+#include "qemu/queue.h"
+#include "qemu/units.h"
 #include "exec/gdbstub.h"
 #include "semihosting/guestfd.h"
 #include "semihosting/syscalls.h"
@@ -247,6 +249,244 @@ static void gdb_gettimeofday(CPUState *cs, gdb_syscall_complete_cb complete,
  * Host semihosting syscall implementations.
  */
 
+/*
+ * Regular files get a buffer, so that the small reads and writes of
+ * guest C libraries don't each cost a host syscall. It holds either
+ * data read ahead of the guest's file position, [pos, len), or writes
+ * not yet passed on to the host, [0, len), when dirty is set. Transfers
+ * of at least HOST_BUF_SIZE bytes bypass it.
+ *
+ * Buffers are per guest fd. When the guest has a file open more than
+ * once, the buffers of its other fds are synced before each access, so
+ * that every fd sees the writes made through the others.
+ */
+#define HOST_BUF_SIZE   (64 * KiB)
+
+typedef struct HostFileBuffer {
+    int hostfd;
+    dev_t dev;
+    ino_t ino;
+    /* Another guest fd has (or had) the same file open.  */
+    bool shared;
+    bool dirty;
+    size_t pos;
+    size_t len;
+    QLIST_ENTRY(HostFileBuffer) next;
+    uint8_t data[HOST_BUF_SIZE];
+} HostFileBuffer;
+
+static QLIST_HEAD(, HostFileBuffer) host_buffers =
+    QLIST_HEAD_INITIALIZER(host_buffers);
+
+/*
+ * Pass pending writes on to the host, or give back the data read ahead,
+ * so that the host file position is the guest's one again.
+ * Returns 0 or an errno value.
+ */
+static int host_buf_sync(HostFileBuffer *hb)
+{
+    size_t done = 0;
+
+    if (hb->dirty) {
+        while (done < hb->len) {
+            ssize_t ret = write(hb->hostfd, hb->data + done, hb->len - done);
+
+            if (ret < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                /* keep what is left for a later attempt */
+                memmove(hb->data, hb->data + done, hb->len - done);
+                hb->len -= done;
+                return errno;
+            }
+            done += ret;
+        }
+        hb->dirty = false;
+    } else if (hb->pos < hb->len &&
+               lseek(hb->hostfd, (off_t)hb->pos - hb->len, SEEK_CUR) < 0) {
+        return errno;
+    }
+    hb->pos = hb->len = 0;
+    return 0;
+}
+
+/* Sync the buffers of the other fds open on @hb's file.  */
+static int host_buf_sync_others(HostFileBuffer *hb)
+{
+    HostFileBuffer *other;
+    int err = 0;
+
+    if (!hb->shared) {
+        return 0;
+    }
+    QLIST_FOREACH(other, &host_buffers, next) {
+        if (other != hb && other->dev == hb->dev && other->ino == hb->ino) {
+            int ret = host_buf_sync(other);
+
+            err = err ? err : ret;
+        }
+    }
+    return err;
+}
+
+/* Sync all the buffers of @hb's file, its own included.  */
+static int host_buf_sync_file(HostFileBuffer *hb)
+{
+    int err = host_buf_sync_others(hb);
+    int ret = host_buf_sync(hb);
+
+    return err ? err : ret;
+}
+
+static void host_buf_sync_all(void)
+{
+    HostFileBuffer *hb;
+
+    QLIST_FOREACH(hb, &host_buffers, next) {
+        host_buf_sync(hb);
+    }
+}
+
+static void host_buf_new(GuestFD *gf)
+{
+    static bool exit_registered;
+    HostFileBuffer *hb, *other;
+    struct stat st;
+
+    if (fstat(gf->hostfd, &st) < 0 || !S_ISREG(st.st_mode)) {
+        return;
+    }
+    if (!exit_registered) {
+        /* guests often exit with SYS_EXIT before closing their files */
+        atexit(host_buf_sync_all);
+        exit_registered = true;
+    }
+    hb = g_new0(HostFileBuffer, 1);
+    hb->hostfd = gf->hostfd;
+    hb->dev = st.st_dev;
+    hb->ino = st.st_ino;
+    QLIST_FOREACH(other, &host_buffers, next) {
+        if (other->dev == hb->dev && other->ino == hb->ino) {
+            other->shared = hb->shared = true;
+        }
+    }
+    QLIST_INSERT_HEAD(&host_buffers, hb, next);
+    gf->hostbuf = hb;
+}
+
+static int host_buf_free(GuestFD *gf)
+{
+    HostFileBuffer *hb = gf->hostbuf;
+    int err;
+
+    if (!hb) {
+        return 0;
+    }
+    err = host_buf_sync(hb);
+    QLIST_REMOVE(hb, next);
+    g_free(hb);
+    gf->hostbuf = NULL;
+    return err;
+}
+
+/* Returns the number of bytes read, or -errno if none could be.  */
+static ssize_t host_buf_read(HostFileBuffer *hb, uint8_t *ptr, size_t len)
+{
+    size_t done = 0;
+    int err;
+
+    if (hb->dirty) {
+        err = host_buf_sync(hb);
+        if (err) {
+            return -err;
+        }
+    }
+    while (done < len) {
+        size_t n;
+
+        if (hb->pos == hb->len) {
+            ssize_t ret = read(hb->hostfd, hb->data, HOST_BUF_SIZE);
+
+            if (ret < 0 && errno == EINTR) {
+                continue;
+            }
+            if (ret < 0 && !done) {
+                return -errno;
+            }
+            if (ret <= 0) {
+                break;
+            }
+            hb->pos = 0;
+            hb->len = ret;
+        }
+        n = MIN(len - done, hb->len - hb->pos);
+        memcpy(ptr + done, hb->data + hb->pos, n);
+        hb->pos += n;
+        done += n;
+    }
+    return done;
+}
+
+/* Returns 0 or an errno value, the write is then not buffered.  */
+static int host_buf_write(HostFileBuffer *hb, const uint8_t *ptr, size_t len)
+{
+    int err;
+
+    if (!hb->dirty || hb->len + len > HOST_BUF_SIZE) {
+        err = host_buf_sync(hb);
+        if (err) {
+            return err;
+        }
+    }
+    memcpy(hb->data + hb->len, ptr, len);
+    hb->len += len;
+    hb->dirty = true;
+    return 0;
+}
+
+#ifndef CONFIG_USER_ONLY
+/*
+ * Transfer between the host file and guest RAM without a bounce buffer.
+ * Returns false, having done nothing, if the guest buffer isn't all RAM.
+ */
+static bool host_rw_direct(CPUState *cs, gdb_syscall_complete_cb complete,
+                           GuestFD *gf, target_ulong buf, target_ulong len,
+                           bool is_read)
+{
+    struct iovec *iov;
+    int i, n, err = 0;
+    ssize_t ret, done = 0;
+
+    n = softmmu_lock_user_iov(cs->env_ptr, buf, len, is_read, &iov);
+    if (!n) {
+        return false;
+    }
+    for (i = 0; i < n; i++) {
+        do {
+            ret = is_read ? read(gf->hostfd, iov[i].iov_base, iov[i].iov_len)
+                          : write(gf->hostfd, iov[i].iov_base, iov[i].iov_len);
+        } while (ret == -1 && errno == EINTR);
+        if (ret == -1) {
+            err = errno;
+            break;
+        }
+        done += ret;
+        if (ret < iov[i].iov_len) {
+            break;
+        }
+    }
+    g_free(iov);
+
+    if (err && !done) {
+        complete(cs, -1, err);
+    } else {
+        complete(cs, done, 0);
+    }
+    return true;
+}
+#endif
+
 static void host_open(CPUState *cs, gdb_syscall_complete_cb complete,
                       target_ulong fname, target_ulong fname_len,
                       int gdb_flags, int mode)
@@ -284,6 +524,7 @@ static void host_open(CPUState *cs, gdb_syscall_complete_cb complete,
     } else {
         int guestfd = alloc_guestfd();
         associate_guestfd(guestfd, ret);
+        host_buf_new(get_guestfd(guestfd));
         complete(cs, guestfd, 0);
     }
     unlock_user(p, fname, 0);
@@ -292,6 +533,14 @@ static void host_open(CPUState *cs, gdb_syscall_complete_cb complete,
 static void host_close(CPUState *cs, gdb_syscall_complete_cb complete,
                        GuestFD *gf)
 {
+    int err = host_buf_free(gf);
+
+    if (err) {
+        close(gf->hostfd);
+        complete(cs, -1, err);
+        return;
+    }
+
     /*
      * Only close the underlying host fd if it's one we opened on behalf
      * of the guest in SYS_OPEN.
@@ -310,16 +559,44 @@ static void host_read(CPUState *cs, gdb_syscall_complete_cb complete,
                       GuestFD *gf, target_ulong buf, target_ulong len)
 {
     CPUArchState *env G_GNUC_UNUSED = cs->env_ptr;
-    void *ptr = lock_user(VERIFY_WRITE, buf, len, 0);
+    HostFileBuffer *hb = gf->hostbuf;
+    void *ptr;
     ssize_t ret;
+    int err;
+
+    if (hb) {
+        err = host_buf_sync_others(hb);
+        if (!err && len >= HOST_BUF_SIZE) {
+            err = host_buf_sync(hb);
+            hb = NULL;
+        }
+        if (err) {
+            complete(cs, -1, err);
+            return;
+        }
+    }
+#ifndef CONFIG_USER_ONLY
+    if (!hb && host_rw_direct(cs, complete, gf, buf, len, true)) {
+        return;
+    }
+#endif
 
+    ptr = lock_user(VERIFY_WRITE, buf, len, 0);
     if (!ptr) {
         complete(cs, -1, EFAULT);
         return;
     }
-    do {
-        ret = read(gf->hostfd, ptr, len);
-    } while (ret == -1 && errno == EINTR);
+    if (hb) {
+        ret = host_buf_read(hb, ptr, len);
+        if (ret < 0) {
+            errno = -ret;
+            ret = -1;
+        }
+    } else {
+        do {
+            ret = read(gf->hostfd, ptr, len);
+        } while (ret == -1 && errno == EINTR);
+    }
     if (ret == -1) {
         complete(cs, -1, errno);
         unlock_user(ptr, buf, 0);
@@ -333,15 +610,40 @@ static void host_write(CPUState *cs, gdb_syscall_complete_cb complete,
                        GuestFD *gf, target_ulong buf, target_ulong len)
 {
     CPUArchState *env G_GNUC_UNUSED = cs->env_ptr;
-    void *ptr = lock_user(VERIFY_READ, buf, len, 1);
+    HostFileBuffer *hb = gf->hostbuf;
+    void *ptr;
     ssize_t ret;
+    int err;
 
+    if (hb) {
+        err = host_buf_sync_others(hb);
+        if (!err && len >= HOST_BUF_SIZE) {
+            err = host_buf_sync(hb);
+            hb = NULL;
+        }
+        if (err) {
+            complete(cs, -1, err);
+            return;
+        }
+    }
+#ifndef CONFIG_USER_ONLY
+    if (!hb && host_rw_direct(cs, complete, gf, buf, len, false)) {
+        return;
+    }
+#endif
+
+    ptr = lock_user(VERIFY_READ, buf, len, 1);
     if (!ptr) {
         complete(cs, -1, EFAULT);
         return;
     }
-    ret = write(gf->hostfd, ptr, len);
-    complete(cs, ret, ret == -1 ? errno : 0);
+    if (hb) {
+        err = host_buf_write(hb, ptr, len);
+        complete(cs, err ? -1 : len, err);
+    } else {
+        ret = write(gf->hostfd, ptr, len);
+        complete(cs, ret, ret == -1 ? errno : 0);
+    }
     unlock_user(ptr, buf, 0);
 }
 
@@ -354,9 +656,11 @@ static void host_lseek(CPUState *cs, gdb_syscall_complete_cb complete,
     QEMU_BUILD_BUG_ON(GDB_SEEK_END != SEEK_END);
 
     off_t ret = off;
-    int err = 0;
+    int err = gf->hostbuf ? host_buf_sync_file(gf->hostbuf) : 0;
 
-    if (ret == off) {
+    if (err) {
+        ret = -1;
+    } else if (ret == off) {
         ret = lseek(gf->hostfd, ret, whence);
         if (ret == -1) {
             err = errno;
@@ -379,8 +683,12 @@ static void host_flen(CPUState *cs, gdb_syscall_complete_cb complete,
                       GuestFD *gf)
 {
     struct stat buf;
+    int err;
 
-    if (fstat(gf->hostfd, &buf) < 0) {
+    err = gf->hostbuf ? host_buf_sync_file(gf->hostbuf) : 0;
+    if (err) {
+        complete(cs, -1, err);
+    } else if (fstat(gf->hostfd, &buf) < 0) {
         complete(cs, -1, errno);
     } else {
         complete(cs, buf.st_size, 0);
@@ -393,6 +701,11 @@ static void host_fstat(CPUState *cs, gdb_syscall_complete_cb complete,
     struct stat buf;
     int ret;
 
+    ret = gf->hostbuf ? host_buf_sync_file(gf->hostbuf) : 0;
+    if (ret) {
+        complete(cs, -1, ret);
+        return;
+    }
     ret = fstat(gf->hostfd, &buf);
     if (ret) {
         complete(cs, -1, errno);
@@ -417,6 +730,7 @@ static void host_stat(CPUState *cs, gdb_syscall_complete_cb complete,
         return;
     }
 
+    host_buf_sync_all();
     ret = stat(name, &buf);
     if (ret) {
         err = errno;
@@ -489,6 +803,7 @@ static void host_system(CPUState *cs, gdb_syscall_complete_cb complete,
         return;
     }
 
+    host_buf_sync_all();
     ret = system(p);
     complete(cs, ret, ret == -1 ? errno : 0);
     unlock_user(p, cmd, 0);
@@ -72,6 +72,60 @@ ssize_t softmmu_strlen_user(CPUArchState *env, target_ulong addr)
     }
 }
 
+/*
+ * Describe the guest buffer at @addr as iovecs pointing straight into
+ * guest RAM, merging pages that are contiguous on the host, so that
+ * large transfers need neither a bounce buffer nor a copy. @write says
+ * the guest memory is going to be written, in which case any translated
+ * code in the buffer is invalidated and the pages are marked dirty.
+ *
+ * Returns the number of iovecs, to be freed with g_free, or 0 if part of
+ * the buffer isn't plain RAM (unmapped, MMIO, ROM, watchpoints), when the
+ * caller has to go through lock_user instead.
+ */
+int softmmu_lock_user_iov(CPUArchState *env, target_ulong addr,
+                          target_ulong len, bool write, struct iovec **piov)
+{
+    MMUAccessType access_type = write ? MMU_DATA_STORE : MMU_DATA_LOAD;
+    int mmu_idx = cpu_mmu_index(env, false);
+    GArray *iov = g_array_new(FALSE, FALSE, sizeof(struct iovec));
+    int n;
+
+    while (len) {
+        size_t left_in_page = TARGET_PAGE_SIZE - (addr & ~TARGET_PAGE_MASK);
+        struct iovec *last;
+        int flags;
+        void *h;
+
+        left_in_page = MIN(left_in_page, len);
+        flags = probe_access_flags(env, addr, access_type,
+                                   mmu_idx, true, &h, 0);
+        if (flags) {
+            g_array_free(iov, TRUE);
+            return 0;
+        }
+        if (write) {
+            /* probe_access_flags only cleaned up after the first byte.  */
+            probe_access(env, addr, left_in_page, access_type, mmu_idx, 0);
+        }
+
+        last = iov->len ? &g_array_index(iov, struct iovec, iov->len - 1)
+                        : NULL;
+        if (last && last->iov_base + last->iov_len == h) {
+            last->iov_len += left_in_page;
+        } else {
+            struct iovec v = { .iov_base = h, .iov_len = left_in_page };
+            g_array_append_val(iov, v);
+        }
+        addr += left_in_page;
+        len -= left_in_page;
+    }
+
+    n = iov->len;
+    *piov = (struct iovec *)g_array_free(iov, FALSE);
+    return n;
+}
+
 char *softmmu_lock_user_string(CPUArchState *env, target_ulong addr)
 {
     ssize_t len = softmmu_strlen_user(env, addr);
@@ -25,6 +25,7 @@
 #include "qemu/osdep.h"
 #include "monitor/monitor.h"
 #include "qemu/coroutine-tls.h"
+#include "qemu/event-loop-stats.h"
 #include "qapi/error.h"
 #include "qapi/qapi-commands-machine.h"
 #include "qapi/qapi-commands-misc.h"
@@ -497,10 +498,15 @@ bool qemu_in_main_thread(void)
 void qemu_mutex_lock_iothread_impl(const char *file, int line)
 {
     QemuMutexLockFunc bql_lock = qatomic_read(&qemu_bql_mutex_lock_func);
+    int64_t start_ns = event_loop_stats_begin();
 
     g_assert(!qemu_mutex_iothread_locked());
     bql_lock(&qemu_global_mutex, file, line);
     set_iothread_locked(true);
+    if (unlikely(start_ns)) {
+        event_loop_stats_account(EVENT_LOOP_HANDLER_KIND_BQL_WAIT, NULL,
+                                 file, line, start_ns);
+    }
 }
 
 void qemu_mutex_unlock_iothread(void)
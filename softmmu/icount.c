@@ -415,6 +415,21 @@ void icount_account_warp_timer(void)
     icount_warp_rt();
 }
 
+void icount_stall(int64_t ns)
+{
+    if (ns <= 0) {
+        return;
+    }
+
+    seqlock_write_lock(&timers_state.vm_clock_seqlock,
+                       &timers_state.vm_clock_lock);
+    qatomic_set_i64(&timers_state.qemu_icount_bias,
+                    timers_state.qemu_icount_bias + ns);
+    seqlock_write_unlock(&timers_state.vm_clock_seqlock,
+                         &timers_state.vm_clock_lock);
+    qemu_clock_notify(QEMU_CLOCK_VIRTUAL);
+}
+
 void icount_configure(QemuOpts *opts, Error **errp)
 {
     const char *option = qemu_opt_get(opts, "shift");
@@ -43,6 +43,10 @@ void icount_account_warp_timer(void)
 {
     abort();
 }
+void icount_stall(int64_t ns)
+{
+    abort();
+}
 
 void icount_notify_exit(void)
 {
@@ -45,6 +45,231 @@ static void clear_tail_16(void *vd, uint32_t desc)
     clear_tail(vd, opr_sz, max_sz);
 }
 
+/*
+ * Host acceleration. The host insns must give exactly the results of the
+ * C implementations below, tests/tcg/aarch64/crypto.c has known answers.
+ * SHA1 rounds are selected by the Arm insn, not by the round number.
+ */
+enum {
+    SHA1_CHO,
+    SHA1_PAR,
+    SHA1_MAJ,
+};
+
+#if defined(CONFIG_X86_CRYPTO_OPT)
+#include "qemu/cpuid.h"
+
+static bool host_aes;
+static bool host_sha;
+
+#pragma GCC push_options
+#pragma GCC target("aes,sse4.1,sha")
+#include <immintrin.h>
+
+static void host_crypto_aese(uint64_t *rd, uint64_t *rn,
+                                 uint64_t *rm, bool decrypt)
+{
+    __m128i st = _mm_xor_si128(_mm_loadu_si128((__m128i *)rn),
+                               _mm_loadu_si128((__m128i *)rm));
+    __m128i zero = _mm_setzero_si128();
+
+    /* The LAST variants skip MixColumns, and a zero round key the xor.  */
+    st = decrypt ? _mm_aesdeclast_si128(st, zero)
+                 : _mm_aesenclast_si128(st, zero);
+    _mm_storeu_si128((__m128i *)rd, st);
+}
+
+static void host_crypto_aesmc(uint64_t *rd, uint64_t *rm, bool decrypt)
+{
+    __m128i st = _mm_loadu_si128((__m128i *)rm);
+    __m128i zero = _mm_setzero_si128();
+
+    if (decrypt) {
+        st = _mm_aesimc_si128(st);
+    } else {
+        /*
+         * There is no bare MixColumns: undo SubBytes and ShiftRows, then
+         * do a full round which reapplies them followed by MixColumns.
+         */
+        st = _mm_aesdeclast_si128(st, zero);
+        st = _mm_aesenc_si128(st, zero);
+    }
+    _mm_storeu_si128((__m128i *)rd, st);
+}
+
+/*
+ * SHA1RNDS4 keeps A in the most significant word and adds the round
+ * constant itself, whereas the Arm insns take K already added to W.
+ * Subtracting it beforehand gives the same sum modulo 2^32.
+ */
+static void host_crypto_sha1(uint64_t *rd, uint64_t *rn, uint64_t *rm,
+                               int func)
+{
+    static const uint32_t k[3] = { 0x5a827999, 0x6ed9eba1, 0x8f1bbcdc };
+    __m128i abcd = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)rd), 0x1b);
+    __m128i wk = _mm_shuffle_epi32(_mm_loadu_si128((__m128i *)rm), 0x1b);
+    __m128i e = _mm_cvtsi32_si128(((uint32_t *)rn)[0]);
+
+    wk = _mm_sub_epi32(wk, _mm_set1_epi32(k[func]));
+    wk = _mm_add_epi32(wk, _mm_slli_si128(e, 12));
+    /* The function selector must be an immediate.  */
+    switch (func) {
+    case SHA1_CHO:
+        abcd = _mm_sha1rnds4_epu32(abcd, wk, 0);
+        break;
+    case SHA1_PAR:
+        abcd = _mm_sha1rnds4_epu32(abcd, wk, 1);
+        break;
+    default:
+        abcd = _mm_sha1rnds4_epu32(abcd, wk, 2);
+        break;
+    }
+    _mm_storeu_si128((__m128i *)rd, _mm_shuffle_epi32(abcd, 0x1b));
+}
+
+/*
+ * Four SHA-256 rounds as two SHA256RNDS2, which work on the state split
+ * as ABEF/CDGH with A in the most significant word.
+ */
+static void host_crypto_sha256(const uint32_t *abcd, const uint32_t *efgh,
+                                 const uint32_t *wk, uint32_t *out_abcd,
+                                 uint32_t *out_efgh)
+{
+    __m128i abef = _mm_set_epi32(abcd[0], abcd[1], efgh[0], efgh[1]);
+    __m128i cdgh = _mm_set_epi32(abcd[2], abcd[3], efgh[2], efgh[3]);
+    __m128i w = _mm_loadu_si128((const __m128i *)wk);
+    __m128i abef1, abef2;
+    uint32_t r1[4], r2[4];
+
+    abef1 = _mm_sha256rnds2_epu32(cdgh, abef, w);
+    abef2 = _mm_sha256rnds2_epu32(abef, abef1, _mm_srli_si128(w, 8));
+    _mm_storeu_si128((__m128i *)r1, abef1);
+    _mm_storeu_si128((__m128i *)r2, abef2);
+
+    /* r[3] = A, r[2] = B, r[1] = E, r[0] = F.  */
+    if (out_abcd) {
+        out_abcd[0] = r2[3];
+        out_abcd[1] = r2[2];
+        out_abcd[2] = r1[3];
+        out_abcd[3] = r1[2];
+    }
+    if (out_efgh) {
+        out_efgh[0] = r2[1];
+        out_efgh[1] = r2[0];
+        out_efgh[2] = r1[1];
+        out_efgh[3] = r1[0];
+    }
+}
+
+#pragma GCC pop_options
+
+static void __attribute__((constructor)) init_host_crypto(void)
+{
+    unsigned max = __get_cpuid_max(0, NULL);
+    unsigned a, b, c, d;
+    bool sse4 = false;
+
+    if (max >= 1) {
+        __cpuid(1, a, b, c, d);
+        sse4 = c & bit_SSE4_1;
+        host_aes = sse4 && (c & bit_AES);
+    }
+    if (max >= 7) {
+        __cpuid_count(7, 0, a, b, c, d);
+        host_sha = sse4 && (b & bit_SHA);
+    }
+}
+
+#elif defined(__aarch64__) && !HOST_BIG_ENDIAN && \
+      defined(__ARM_FEATURE_AES) && defined(__ARM_FEATURE_SHA2)
+#include <arm_neon.h>
+
+/* Only when the compiler may use the insns unconditionally.  */
+#define host_aes true
+#define host_sha true
+
+static void host_crypto_aese(uint64_t *rd, uint64_t *rn,
+                             uint64_t *rm, bool decrypt)
+{
+    uint8x16_t st = vld1q_u8((uint8_t *)rn);
+    uint8x16_t rk = vld1q_u8((uint8_t *)rm);
+
+    vst1q_u8((uint8_t *)rd, decrypt ? vaesdq_u8(st, rk) : vaeseq_u8(st, rk));
+}
+
+static void host_crypto_aesmc(uint64_t *rd, uint64_t *rm, bool decrypt)
+{
+    uint8x16_t st = vld1q_u8((uint8_t *)rm);
+
+    vst1q_u8((uint8_t *)rd, decrypt ? vaesimcq_u8(st) : vaesmcq_u8(st));
+}
+
+static void host_crypto_sha1(uint64_t *rd, uint64_t *rn, uint64_t *rm,
+                             int func)
+{
+    uint32x4_t abcd = vld1q_u32((uint32_t *)rd);
+    uint32x4_t wk = vld1q_u32((uint32_t *)rm);
+    uint32_t e = ((uint32_t *)rn)[0];
+
+    switch (func) {
+    case SHA1_CHO:
+        abcd = vsha1cq_u32(abcd, e, wk);
+        break;
+    case SHA1_PAR:
+        abcd = vsha1pq_u32(abcd, e, wk);
+        break;
+    default:
+        abcd = vsha1mq_u32(abcd, e, wk);
+        break;
+    }
+    vst1q_u32((uint32_t *)rd, abcd);
+}
+
+static void host_crypto_sha256(const uint32_t *abcd, const uint32_t *efgh,
+                               const uint32_t *wk, uint32_t *out_abcd,
+                               uint32_t *out_efgh)
+{
+    uint32x4_t a = vld1q_u32(abcd);
+    uint32x4_t e = vld1q_u32(efgh);
+    uint32x4_t w = vld1q_u32(wk);
+
+    if (out_abcd) {
+        vst1q_u32(out_abcd, vsha256hq_u32(a, e, w));
+    }
+    if (out_efgh) {
+        vst1q_u32(out_efgh, vsha256h2q_u32(e, a, w));
+    }
+}
+
+#else
+#define host_aes false
+#define host_sha false
+
+static void host_crypto_aese(uint64_t *rd, uint64_t *rn,
+                             uint64_t *rm, bool decrypt)
+{
+    g_assert_not_reached();
+}
+
+static void host_crypto_aesmc(uint64_t *rd, uint64_t *rm, bool decrypt)
+{
+    g_assert_not_reached();
+}
+
+static void host_crypto_sha1(uint64_t *rd, uint64_t *rn, uint64_t *rm,
+                             int func)
+{
+    g_assert_not_reached();
+}
+
+static void host_crypto_sha256(const uint32_t *abcd, const uint32_t *efgh,
+                               const uint32_t *wk, uint32_t *out_abcd,
+                               uint32_t *out_efgh)
+{
+    g_assert_not_reached();
+}
+#endif
+
 static void do_crypto_aese(uint64_t *rd, uint64_t *rn,
                            uint64_t *rm, bool decrypt)
 {
@@ -54,6 +279,11 @@ static void do_crypto_aese(uint64_t *rd, uint64_t *rn,
     union CRYPTO_STATE st = { .l = { rn[0], rn[1] } };
     int i;
 
+    if (host_aes) {
+        host_crypto_aese(rd, rn, rm, decrypt);
+        return;
+    }
+
     /* xor state vector with round key */
     rk.l[0] ^= st.l[0];
     rk.l[1] ^= st.l[1];
@@ -217,6 +447,11 @@ static void do_crypto_aesmc(uint64_t *rd, uint64_t *rm, bool decrypt)
     union CRYPTO_STATE st = { .l = { rm[0], rm[1] } };
     int i;
 
+    if (host_aes) {
+        host_crypto_aesmc(rd, rm, decrypt);
+        return;
+    }
+
     for (i = 0; i < 16; i += 4) {
         CR_ST_WORD(st, i >> 2) =
             mc[decrypt][CR_ST_BYTE(st, i)] ^
@@ -274,13 +509,20 @@ void HELPER(crypto_sha1su0)(void *vd, void *vn, void *vm, uint32_t desc)
 
 static inline void crypto_sha1_3reg(uint64_t *rd, uint64_t *rn,
                                     uint64_t *rm, uint32_t desc,
-                                    uint32_t (*fn)(union CRYPTO_STATE *d))
+                                    uint32_t (*fn)(union CRYPTO_STATE *d),
+                                    int func)
 {
     union CRYPTO_STATE d = { .l = { rd[0], rd[1] } };
     union CRYPTO_STATE n = { .l = { rn[0], rn[1] } };
     union CRYPTO_STATE m = { .l = { rm[0], rm[1] } };
     int i;
 
+    if (host_sha) {
+        host_crypto_sha1(rd, rn, rm, func);
+        clear_tail_16(rd, desc);
+        return;
+    }
+
     for (i = 0; i < 4; i++) {
         uint32_t t = fn(&d);
 
@@ -306,7 +548,7 @@ static uint32_t do_sha1c(union CRYPTO_STATE *d)
 
 void HELPER(crypto_sha1c)(void *vd, void *vn, void *vm, uint32_t desc)
 {
-    crypto_sha1_3reg(vd, vn, vm, desc, do_sha1c);
+    crypto_sha1_3reg(vd, vn, vm, desc, do_sha1c, SHA1_CHO);
 }
 
 static uint32_t do_sha1p(union CRYPTO_STATE *d)
@@ -316,7 +558,7 @@ static uint32_t do_sha1p(union CRYPTO_STATE *d)
 
 void HELPER(crypto_sha1p)(void *vd, void *vn, void *vm, uint32_t desc)
 {
-    crypto_sha1_3reg(vd, vn, vm, desc, do_sha1p);
+    crypto_sha1_3reg(vd, vn, vm, desc, do_sha1p, SHA1_PAR);
 }
 
 static uint32_t do_sha1m(union CRYPTO_STATE *d)
@@ -326,7 +568,7 @@ static uint32_t do_sha1m(union CRYPTO_STATE *d)
 
 void HELPER(crypto_sha1m)(void *vd, void *vn, void *vm, uint32_t desc)
 {
-    crypto_sha1_3reg(vd, vn, vm, desc, do_sha1m);
+    crypto_sha1_3reg(vd, vn, vm, desc, do_sha1m, SHA1_MAJ);
 }
 
 void HELPER(crypto_sha1h)(void *vd, void *vm, uint32_t desc)
@@ -397,6 +639,12 @@ void HELPER(crypto_sha256h)(void *vd, void *vn, void *vm, uint32_t desc)
     union CRYPTO_STATE m = { .l = { rm[0], rm[1] } };
     int i;
 
+    if (host_sha) {
+        host_crypto_sha256(vd, vn, vm, vd, NULL);
+        clear_tail_16(vd, desc);
+        return;
+    }
+
     for (i = 0; i < 4; i++) {
         uint32_t t = cho(CR_ST_WORD(n, 0), CR_ST_WORD(n, 1), CR_ST_WORD(n, 2))
                      + CR_ST_WORD(n, 3) + S1(CR_ST_WORD(n, 0))
@@ -432,6 +680,12 @@ void HELPER(crypto_sha256h2)(void *vd, void *vn, void *vm, uint32_t desc)
     union CRYPTO_STATE m = { .l = { rm[0], rm[1] } };
     int i;
 
+    if (host_sha) {
+        host_crypto_sha256(vn, vd, vm, NULL, vd);
+        clear_tail_16(vd, desc);
+        return;
+    }
+
     for (i = 0; i < 4; i++) {
         uint32_t t = cho(CR_ST_WORD(d, 0), CR_ST_WORD(d, 1), CR_ST_WORD(d, 2))
                      + CR_ST_WORD(d, 3) + S1(CR_ST_WORD(d, 0))
@@ -161,12 +161,27 @@ LOGICAL_PPPP(sve_nand_pppp, DO_NAND)
  * extra care wrt byte/word ordering we could use gcc generic vectors
  * and do 16 bytes at a time.
  */
+/*
+ * Runs of 16 bytes with all elements active, as for a PTRUE or WHILE
+ * predicate in the body of a loop, are computed without testing each
+ * element, which lets the compiler vectorize them.
+ */
 #define DO_ZPZZ(NAME, TYPE, H, OP)                                       \
 void HELPER(NAME)(void *vd, void *vn, void *vm, void *vg, uint32_t desc) \
 {                                                                       \
-    intptr_t i, opr_sz = simd_oprsz(desc);                              \
+    const uint16_t full = pred_esz_masks[ctz32(sizeof(TYPE))];          \
+    intptr_t i, j, opr_sz = simd_oprsz(desc);                           \
     for (i = 0; i < opr_sz; ) {                                         \
         uint16_t pg = *(uint16_t *)(vg + H1_2(i >> 3));                 \
+        if ((pg & full) == full) {                                      \
+            for (j = 0; j < 16; j += sizeof(TYPE)) {                    \
+                TYPE nn = *(TYPE *)(vn + H(i + j));                     \
+                TYPE mm = *(TYPE *)(vm + H(i + j));                     \
+                *(TYPE *)(vd + H(i + j)) = OP(nn, mm);                  \
+            }                                                           \
+            i += 16;                                                    \
+            continue;                                                   \
+        }                                                               \
         do {                                                            \
             if (pg & 1) {                                               \
                 TYPE nn = *(TYPE *)(vn + H(i));                         \
@@ -185,11 +200,20 @@ void HELPER(NAME)(void *vd, void *vn, void *vm, void *vg, uint32_t desc) \
     intptr_t i, opr_sz = simd_oprsz(desc) / 8;                  \
     TYPE *d = vd, *n = vn, *m = vm;                             \
     uint8_t *pg = vg;                                           \
-    for (i = 0; i < opr_sz; i += 1) {                           \
+    for (i = 0; i < opr_sz; i += 2) {                           \
+        if (pg[H1(i)] & pg[H1(i + 1)] & 1) {                    \
+            d[i] = OP(n[i], m[i]);                              \
+            d[i + 1] = OP(n[i + 1], m[i + 1]);                  \
+            continue;                                           \
+        }                                                       \
         if (pg[H1(i)] & 1) {                                    \
             TYPE nn = n[i], mm = m[i];                          \
             d[i] = OP(nn, mm);                                  \
         }                                                       \
+        if (pg[H1(i + 1)] & 1) {                                \
+            TYPE nn = n[i + 1], mm = m[i + 1];                  \
+            d[i + 1] = OP(nn, mm);                              \
+        }                                                       \
     }                                                           \
 }
 
@@ -5655,6 +5679,25 @@ void sve_cont_ldst_mte_check(SVEContLdSt *info, CPUARMState *env,
     }
 }
 
+/*
+ * If the elements of the predicate word starting at @reg_off are all
+ * active and no further than @reg_last, return the number of register
+ * bytes they cover, otherwise 0. The contiguous loads and stores copy
+ * such runs without testing each element, which the compiler vectorizes.
+ */
+static inline intptr_t sve_full_pred_word(uint64_t *vg, intptr_t reg_off,
+                                          intptr_t reg_last,
+                                          intptr_t reg_max, int esz)
+{
+    intptr_t len = MIN(reg_max - reg_off, 64);
+    uint64_t mask = pred_esz_masks[esz] & MAKE_64BIT_MASK(0, len);
+
+    if ((reg_off & 63) || reg_off + len - (1 << esz) > reg_last) {
+        return 0;
+    }
+    return (vg[reg_off >> 6] & mask) == mask ? len : 0;
+}
+
 /*
  * Common helper for all contiguous 1,2,3,4-register predicated stores.
  */
@@ -5754,6 +5797,20 @@ void sve_ldN_r(CPUARMState *env, uint64_t *vg, const target_ulong addr,
 
     while (reg_off <= reg_last) {
         uint64_t pg = vg[reg_off >> 6];
+        intptr_t full = sve_full_pred_word(vg, reg_off, reg_last, reg_max, esz);
+
+        if (full) {
+            full += reg_off;
+            do {
+                for (i = 0; i < N; ++i) {
+                    host_fn(&env->vfp.zregs[(rd + i) & 31], reg_off,
+                            host + mem_off + (i << msz));
+                }
+                reg_off += 1 << esz;
+                mem_off += N << msz;
+            } while (reg_off < full);
+            continue;
+        }
         do {
             if ((pg >> (reg_off & 63)) & 1) {
                 for (i = 0; i < N; ++i) {
@@ -5787,6 +5844,21 @@ void sve_ldN_r(CPUARMState *env, uint64_t *vg, const target_ulong addr,
 
         do {
             uint64_t pg = vg[reg_off >> 6];
+            intptr_t full = sve_full_pred_word(vg, reg_off, reg_last,
+                                               reg_max, esz);
+
+            if (full) {
+                full += reg_off;
+                do {
+                    for (i = 0; i < N; ++i) {
+                        host_fn(&env->vfp.zregs[(rd + i) & 31], reg_off,
+                                host + mem_off + (i << msz));
+                    }
+                    reg_off += 1 << esz;
+                    mem_off += N << msz;
+                } while (reg_off < full);
+                continue;
+            }
             do {
                 if ((pg >> (reg_off & 63)) & 1) {
                     for (i = 0; i < N; ++i) {
@@ -6364,6 +6436,20 @@ void sve_stN_r(CPUARMState *env, uint64_t *vg, target_ulong addr,
 
     while (reg_off <= reg_last) {
         uint64_t pg = vg[reg_off >> 6];
+        intptr_t full = sve_full_pred_word(vg, reg_off, reg_last, reg_max, esz);
+
+        if (full) {
+            full += reg_off;
+            do {
+                for (i = 0; i < N; ++i) {
+                    host_fn(&env->vfp.zregs[(rd + i) & 31], reg_off,
+                            host + mem_off + (i << msz));
+                }
+                reg_off += 1 << esz;
+                mem_off += N << msz;
+            } while (reg_off < full);
+            continue;
+        }
         do {
             if ((pg >> (reg_off & 63)) & 1) {
                 for (i = 0; i < N; ++i) {
@@ -6397,6 +6483,21 @@ void sve_stN_r(CPUARMState *env, uint64_t *vg, target_ulong addr,
 
         do {
             uint64_t pg = vg[reg_off >> 6];
+            intptr_t full = sve_full_pred_word(vg, reg_off, reg_last,
+                                               reg_max, esz);
+
+            if (full) {
+                full += reg_off;
+                do {
+                    for (i = 0; i < N; ++i) {
+                        host_fn(&env->vfp.zregs[(rd + i) & 31], reg_off,
+                                host + mem_off + (i << msz));
+                    }
+                    reg_off += 1 << esz;
+                    mem_off += N << msz;
+                } while (reg_off < full);
+                continue;
+            }
             do {
                 if ((pg >> (reg_off & 63)) & 1) {
                     for (i = 0; i < N; ++i) {
@@ -6536,6 +6637,41 @@ static target_ulong off_zd_d(void *reg, intptr_t reg_ofs)
     return *(uint64_t *)(reg + reg_ofs);
 }
 
+/*
+ * Gathers and scatters often have many elements on the same page, so
+ * resolve each page only once: *@info_page is the page that @info
+ * describes, or -1. Returns the host address of @addr, which must not
+ * cross a page boundary, or NULL for MMIO.
+ *
+ * Stores to a page with translated code must each be probed, so that
+ * the code they overwrite is invalidated; such pages are not cached.
+ */
+static void *sve_probe_elem(SVEHostPage *info, target_ulong *info_page,
+                            CPUARMState *env, target_ulong addr,
+                            MMUAccessType access_type, int mmu_idx,
+                            uintptr_t retaddr)
+{
+    target_ulong page = addr & TARGET_PAGE_MASK;
+
+    if (page != *info_page) {
+        /* Probe the element itself, the page base may lie outside it.  */
+        sve_probe_page(info, false, env, addr, 0, access_type,
+                       mmu_idx, retaddr);
+#ifndef CONFIG_USER_ONLY
+        if (access_type == MMU_DATA_STORE &&
+            (tlb_addr_write(tlb_entry(env, mmu_idx, addr)) & TLB_NOTDIRTY)) {
+            *info_page = -1;
+            return info->flags & TLB_MMIO ? NULL : info->host;
+        }
+#endif
+        if (!(info->flags & TLB_MMIO)) {
+            info->host -= addr - page;
+        }
+        *info_page = page;
+    }
+    return info->flags & TLB_MMIO ? NULL : info->host + (addr - page);
+}
+
 static inline QEMU_ALWAYS_INLINE
 void sve_ld1_z(CPUARMState *env, void *vd, uint64_t *vg, void *vm,
                target_ulong base, uint32_t desc, uintptr_t retaddr,
@@ -6550,6 +6686,7 @@ void sve_ld1_z(CPUARMState *env, void *vd, uint64_t *vg, void *vm,
     ARMVectorReg scratch;
     intptr_t reg_off;
     SVEHostPage info, info2;
+    target_ulong info_page = -1;
 
     memset(&scratch, 0, reg_max);
     reg_off = 0;
@@ -6560,10 +6697,11 @@ void sve_ld1_z(CPUARMState *env, void *vd, uint64_t *vg, void *vm,
                 target_ulong addr = base + (off_fn(vm, reg_off) << scale);
                 target_ulong in_page = -(addr | TARGET_PAGE_MASK);
 
-                sve_probe_page(&info, false, env, addr, 0, MMU_DATA_LOAD,
-                               mmu_idx, retaddr);
-
                 if (likely(in_page >= msize)) {
+                    void *host = sve_probe_elem(&info, &info_page, env, addr,
+                                                MMU_DATA_LOAD, mmu_idx,
+                                                retaddr);
+
                     if (unlikely(info.flags & TLB_WATCHPOINT)) {
                         cpu_check_watchpoint(env_cpu(env), addr, msize,
                                              info.attrs, BP_MEM_READ, retaddr);
@@ -6571,13 +6709,17 @@ void sve_ld1_z(CPUARMState *env, void *vd, uint64_t *vg, void *vm,
                     if (mtedesc && arm_tlb_mte_tagged(&info.attrs)) {
                         mte_check(env, mtedesc, addr, retaddr);
                     }
-                    if (unlikely(info.flags & TLB_MMIO)) {
+                    if (unlikely(!host)) {
                         tlb_fn(env, &scratch, reg_off, addr, retaddr);
+                        /* the device access may have changed the mapping */
+                        info_page = -1;
                     } else {
-                        host_fn(&scratch, reg_off, info.host);
+                        host_fn(&scratch, reg_off, host);
                     }
                 } else {
                     /* Element crosses the page boundary. */
+                    sve_probe_page(&info, false, env, addr, 0, MMU_DATA_LOAD,
+                                   mmu_idx, retaddr);
                     sve_probe_page(&info2, false, env, addr + in_page, 0,
                                    MMU_DATA_LOAD, mmu_idx, retaddr);
                     if (unlikely((info.flags | info2.flags) & TLB_WATCHPOINT)) {
@@ -6589,6 +6731,7 @@ void sve_ld1_z(CPUARMState *env, void *vd, uint64_t *vg, void *vm,
                         mte_check(env, mtedesc, addr, retaddr);
                     }
                     tlb_fn(env, &scratch, reg_off, addr, retaddr);
+                    info_page = -1;
                 }
             }
             reg_off += esize;
@@ -6937,6 +7080,7 @@ void sve_st1_z(CPUARMState *env, void *vd, uint64_t *vg, void *vm,
     void *host[ARM_MAX_VQ * 4];
     intptr_t reg_off, i;
     SVEHostPage info, info2;
+    target_ulong info_page = -1;
 
     /*
      * Probe all of the elements for host addresses and flags.
@@ -6951,11 +7095,9 @@ void sve_st1_z(CPUARMState *env, void *vd, uint64_t *vg, void *vm,
             host[i] = NULL;
             if (likely((pg >> (reg_off & 63)) & 1)) {
                 if (likely(in_page >= msize)) {
-                    sve_probe_page(&info, false, env, addr, 0, MMU_DATA_STORE,
-                                   mmu_idx, retaddr);
-                    if (!(info.flags & TLB_MMIO)) {
-                        host[i] = info.host;
-                    }
+                    host[i] = sve_probe_elem(&info, &info_page, env, addr,
+                                             MMU_DATA_STORE, mmu_idx,
+                                             retaddr);
                 } else {
                     /*
                      * Element crosses the page boundary.
@@ -6967,6 +7109,7 @@ void sve_st1_z(CPUARMState *env, void *vd, uint64_t *vg, void *vm,
                     sve_probe_page(&info2, false, env, addr + in_page, 0,
                                    MMU_DATA_STORE, mmu_idx, retaddr);
                     info.flags |= info2.flags;
+                    info_page = -1;
                 }
 
                 if (unlikely(info.flags & TLB_WATCHPOINT)) {
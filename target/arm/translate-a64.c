@@ -636,6 +636,19 @@ static void gen_gvec_op3_fpst(DisasContext *s, bool is_q, int rd, int rn,
     tcg_temp_free_ptr(fpst);
 }
 
+/* Expand a 2-operand + qc + operation using an out-of-line helper.  */
+static void gen_gvec_op2_qc(DisasContext *s, bool is_q, int rd, int rn,
+                            gen_helper_gvec_2_ptr *fn)
+{
+    TCGv_ptr qc_ptr = tcg_temp_new_ptr();
+
+    tcg_gen_addi_ptr(qc_ptr, cpu_env, offsetof(CPUARMState, vfp.qc));
+    tcg_gen_gvec_2_ptr(vec_full_reg_offset(s, rd),
+                       vec_full_reg_offset(s, rn), qc_ptr,
+                       is_q ? 16 : 8, vec_full_reg_size(s), 0, fn);
+    tcg_temp_free_ptr(qc_ptr);
+}
+
 /* Expand a 3-operand + qc + operation using an out-of-line helper.  */
 static void gen_gvec_op3_qc(DisasContext *s, bool is_q, int rd, int rn,
                             int rm, gen_helper_gvec_3_ptr *fn)
@@ -12586,6 +12599,23 @@ static void disas_simd_two_reg_misc(DisasContext *s, uint32_t insn)
             return;
         }
 
+        /* The saturating narrows; is_q selects the half of rd written.  */
+        if (opcode == 0x14 || u) {
+            static gen_helper_gvec_2_ptr * const fns[3][3] = {
+                { gen_helper_gvec_sqxtn_b,
+                  gen_helper_gvec_sqxtn_h,
+                  gen_helper_gvec_sqxtn_s },
+                { gen_helper_gvec_uqxtn_b,
+                  gen_helper_gvec_uqxtn_h,
+                  gen_helper_gvec_uqxtn_s },
+                { gen_helper_gvec_sqxtun_b,
+                  gen_helper_gvec_sqxtun_h,
+                  gen_helper_gvec_sqxtun_s },
+            };
+            gen_gvec_op2_qc(s, is_q, rd, rn,
+                            fns[opcode == 0x12 ? 2 : u][size]);
+            return;
+        }
         handle_2misc_narrow(s, false, opcode, u, is_q, size, rn, rd);
         return;
     case 0x4: /* CLS, CLZ */
@@ -12869,6 +12899,13 @@ static void disas_simd_two_reg_misc(DisasContext *s, uint32_t insn)
             gen_gvec_fn2(s, is_q, rd, rn, tcg_gen_gvec_abs, size);
         }
         return;
+    case 0x7: /* SQABS, SQNEG */
+        if (u) {
+            gen_gvec_fn2(s, is_q, rd, rn, gen_gvec_sqneg_qc, size);
+        } else {
+            gen_gvec_fn2(s, is_q, rd, rn, gen_gvec_sqabs_qc, size);
+        }
+        return;
     }
 
     if (size == 3) {
@@ -12912,13 +12949,6 @@ static void disas_simd_two_reg_misc(DisasContext *s, uint32_t insn)
                         tcg_gen_clrsb_i32(tcg_res, tcg_op);
                     }
                     break;
-                case 0x7: /* SQABS, SQNEG */
-                    if (u) {
-                        gen_helper_neon_qneg_s32(tcg_res, cpu_env, tcg_op);
-                    } else {
-                        gen_helper_neon_qabs_s32(tcg_res, cpu_env, tcg_op);
-                    }
-                    break;
                 case 0x2f: /* FABS */
                     gen_helper_vfp_abss(tcg_res, tcg_op);
                     break;
@@ -12982,17 +13012,6 @@ static void disas_simd_two_reg_misc(DisasContext *s, uint32_t insn)
                         gen_helper_neon_cnt_u8(tcg_res, tcg_op);
                     }
                     break;
-                case 0x7: /* SQABS, SQNEG */
-                {
-                    NeonGenOneOpEnvFn *genfn;
-                    static NeonGenOneOpEnvFn * const fns[2][2] = {
-                        { gen_helper_neon_qabs_s8, gen_helper_neon_qneg_s8 },
-                        { gen_helper_neon_qabs_s16, gen_helper_neon_qneg_s16 },
-                    };
-                    genfn = fns[size][u];
-                    genfn(tcg_res, cpu_env, tcg_op);
-                    break;
-                }
                 case 0x4: /* CLS, CLZ */
                     if (u) {
                         if (size == 0) {
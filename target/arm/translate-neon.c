@@ -3286,9 +3286,58 @@ static bool do_vmovn(DisasContext *s, arg_2misc *a,
     }
 
 DO_VMOVN(VMOVN, gen_neon_narrow_u)
-DO_VMOVN(VQMOVUN, gen_helper_neon_unarrow_sat)
-DO_VMOVN(VQMOVN_S, gen_helper_neon_narrow_sat_s)
-DO_VMOVN(VQMOVN_U, gen_helper_neon_narrow_sat_u)
+
+/* The saturating narrows, with one out-of-line call for the vector.  */
+static bool do_vqmovn(DisasContext *s, arg_2misc *a,
+                      gen_helper_gvec_2_ptr *fn)
+{
+    TCGv_ptr qc_ptr;
+
+    if (!arm_dc_feature(s, ARM_FEATURE_NEON)) {
+        return false;
+    }
+
+    /* UNDEF accesses to D16-D31 if they don't exist. */
+    if (!dc_isar_feature(aa32_simd_r32, s) &&
+        ((a->vd | a->vm) & 0x10)) {
+        return false;
+    }
+
+    if (a->vm & 1) {
+        return false;
+    }
+
+    if (!fn) {
+        return false;
+    }
+
+    if (!vfp_access_check(s)) {
+        return true;
+    }
+
+    qc_ptr = tcg_temp_new_ptr();
+    tcg_gen_addi_ptr(qc_ptr, cpu_env, offsetof(CPUARMState, vfp.qc));
+    tcg_gen_gvec_2_ptr(neon_full_reg_offset(a->vd),
+                       neon_full_reg_offset(a->vm), qc_ptr, 8, 8, 0, fn);
+    tcg_temp_free_ptr(qc_ptr);
+    return true;
+}
+
+#define DO_VQMOVN(INSN, FUNC)                                   \
+    static bool trans_##INSN(DisasContext *s, arg_2misc *a)     \
+    {                                                           \
+        static gen_helper_gvec_2_ptr * const fns[] = {          \
+            FUNC##_b,                                           \
+            FUNC##_h,                                           \
+            FUNC##_s,                                           \
+            NULL,                                               \
+        };                                                      \
+        return do_vqmovn(s, a, fns[a->size]);                   \
+    }
+
+DO_VQMOVN(VQMOVUN, gen_helper_gvec_sqxtun)
+DO_VQMOVN(VQMOVN_S, gen_helper_gvec_sqxtn)
+DO_VQMOVN(VQMOVN_U, gen_helper_gvec_uqxtn)
 
 static bool trans_VSHLL(DisasContext *s, arg_2misc *a)
 {
@@ -3739,39 +3788,14 @@ static bool trans_VRSQRTE(DisasContext *s, arg_2misc *a)
     return do_2misc(s, a, gen_helper_rsqrte_u32);
 }
 
-#define WRAP_1OP_ENV_FN(WRAPNAME, FUNC) \
-    static void WRAPNAME(TCGv_i32 d, TCGv_i32 m)        \
-    {                                                   \
-        FUNC(d, cpu_env, m);                            \
-    }
-
-WRAP_1OP_ENV_FN(gen_VQABS_s8, gen_helper_neon_qabs_s8)
-WRAP_1OP_ENV_FN(gen_VQABS_s16, gen_helper_neon_qabs_s16)
-WRAP_1OP_ENV_FN(gen_VQABS_s32, gen_helper_neon_qabs_s32)
-WRAP_1OP_ENV_FN(gen_VQNEG_s8, gen_helper_neon_qneg_s8)
-WRAP_1OP_ENV_FN(gen_VQNEG_s16, gen_helper_neon_qneg_s16)
-WRAP_1OP_ENV_FN(gen_VQNEG_s32, gen_helper_neon_qneg_s32)
-
 static bool trans_VQABS(DisasContext *s, arg_2misc *a)
 {
-    static NeonGenOneOpFn * const fn[] = {
-        gen_VQABS_s8,
-        gen_VQABS_s16,
-        gen_VQABS_s32,
-        NULL,
-    };
-    return do_2misc(s, a, fn[a->size]);
+    return do_2misc_vec(s, a, gen_gvec_sqabs_qc);
 }
 
 static bool trans_VQNEG(DisasContext *s, arg_2misc *a)
 {
-    static NeonGenOneOpFn * const fn[] = {
-        gen_VQNEG_s8,
-        gen_VQNEG_s16,
-        gen_VQNEG_s32,
-        NULL,
-    };
-    return do_2misc(s, a, fn[a->size]);
+    return do_2misc_vec(s, a, gen_gvec_sqneg_qc);
 }
 
 #define DO_2MISC_FP_VEC(INSN, HFUNC, SFUNC)                             \
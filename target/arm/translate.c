@@ -4447,6 +4447,97 @@ void gen_gvec_sqsub_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
                    rn_ofs, rm_ofs, opr_sz, max_sz, &ops[vece]);
 }
 
+/*
+ * SQABS and SQNEG only saturate for the most negative element, which is
+ * also the only input that sets QC.
+ */
+static void gen_sqneg_vec(unsigned vece, TCGv_vec t, TCGv_vec sat,
+                          TCGv_vec a, TCGv_vec b)
+{
+    TCGv_vec x = tcg_temp_new_vec_matching(t);
+    tcg_gen_cmp_vec(TCG_COND_EQ, vece, x, a,
+                    tcg_constant_vec_matching(t, vece,
+                                              1ull << ((8 << vece) - 1)));
+    tcg_gen_sssub_vec(vece, t, tcg_constant_vec_matching(t, vece, 0), a);
+    tcg_gen_or_vec(vece, sat, sat, x);
+    tcg_temp_free_vec(x);
+}
+
+static void gen_sqabs_vec(unsigned vece, TCGv_vec t, TCGv_vec sat,
+                          TCGv_vec a, TCGv_vec b)
+{
+    gen_sqneg_vec(vece, t, sat, a, b);
+    tcg_gen_smax_vec(vece, t, t, a);
+}
+
+/*
+ * The source is passed as both rn and rm so that the 4-operand expansion,
+ * which can also write QC, is usable for a single input.
+ */
+void gen_gvec_sqabs_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                       uint32_t opr_sz, uint32_t max_sz)
+{
+    static const TCGOpcode vecop_list[] = {
+        INDEX_op_sssub_vec, INDEX_op_smax_vec, INDEX_op_cmp_vec, 0
+    };
+    static const GVecGen4 ops[4] = {
+        { .fniv = gen_sqabs_vec,
+          .fno = gen_helper_gvec_sqabs_b,
+          .opt_opc = vecop_list,
+          .write_aofs = true,
+          .vece = MO_8 },
+        { .fniv = gen_sqabs_vec,
+          .fno = gen_helper_gvec_sqabs_h,
+          .opt_opc = vecop_list,
+          .write_aofs = true,
+          .vece = MO_16 },
+        { .fniv = gen_sqabs_vec,
+          .fno = gen_helper_gvec_sqabs_s,
+          .opt_opc = vecop_list,
+          .write_aofs = true,
+          .vece = MO_32 },
+        { .fniv = gen_sqabs_vec,
+          .fno = gen_helper_gvec_sqabs_d,
+          .opt_opc = vecop_list,
+          .write_aofs = true,
+          .vece = MO_64 },
+    };
+    tcg_gen_gvec_4(rd_ofs, offsetof(CPUARMState, vfp.qc),
+                   rn_ofs, rn_ofs, opr_sz, max_sz, &ops[vece]);
+}
+
+void gen_gvec_sqneg_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                       uint32_t opr_sz, uint32_t max_sz)
+{
+    static const TCGOpcode vecop_list[] = {
+        INDEX_op_sssub_vec, INDEX_op_cmp_vec, 0
+    };
+    static const GVecGen4 ops[4] = {
+        { .fniv = gen_sqneg_vec,
+          .fno = gen_helper_gvec_sqneg_b,
+          .opt_opc = vecop_list,
+          .write_aofs = true,
+          .vece = MO_8 },
+        { .fniv = gen_sqneg_vec,
+          .fno = gen_helper_gvec_sqneg_h,
+          .opt_opc = vecop_list,
+          .write_aofs = true,
+          .vece = MO_16 },
+        { .fniv = gen_sqneg_vec,
+          .fno = gen_helper_gvec_sqneg_s,
+          .opt_opc = vecop_list,
+          .write_aofs = true,
+          .vece = MO_32 },
+        { .fniv = gen_sqneg_vec,
+          .fno = gen_helper_gvec_sqneg_d,
+          .opt_opc = vecop_list,
+          .write_aofs = true,
+          .vece = MO_64 },
+    };
+    tcg_gen_gvec_4(rd_ofs, offsetof(CPUARMState, vfp.qc),
+                   rn_ofs, rn_ofs, opr_sz, max_sz, &ops[vece]);
+}
+
 static void gen_sabd_i32(TCGv_i32 d, TCGv_i32 a, TCGv_i32 b)
 {
     TCGv_i32 t = tcg_temp_new_i32();
@@ -380,6 +380,10 @@ void gen_gvec_uqsub_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
                        uint32_t rm_ofs, uint32_t opr_sz, uint32_t max_sz);
 void gen_gvec_sqsub_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
                        uint32_t rm_ofs, uint32_t opr_sz, uint32_t max_sz);
+void gen_gvec_sqabs_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                       uint32_t opr_sz, uint32_t max_sz);
+void gen_gvec_sqneg_qc(unsigned vece, uint32_t rd_ofs, uint32_t rn_ofs,
+                       uint32_t opr_sz, uint32_t max_sz);
 
 void gen_gvec_ssra(unsigned vece, uint32_t rd_ofs, uint32_t rm_ofs,
                    int64_t shift, uint32_t opr_sz, uint32_t max_sz);
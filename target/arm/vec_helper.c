@@ -1579,6 +1579,127 @@ void HELPER(gvec_sqsub_d)(void *vd, void *vq, void *vn,
     clear_tail(d, oprsz, simd_maxsz(desc));
 }
 
+/* SQABS and SQNEG; @vm is the same as @vn and is ignored.  */
+#define DO_SAT1(NAME, TYPE, MIN, MAX, OP)                                  \
+void HELPER(NAME)(void *vd, void *vq, void *vn, void *vm, uint32_t desc)   \
+{                                                                          \
+    intptr_t i, oprsz = simd_oprsz(desc);                                  \
+    TYPE *d = vd, *n = vn;                                                 \
+    bool q = false;                                                        \
+    for (i = 0; i < oprsz / sizeof(TYPE); i++) {                           \
+        TYPE nn = n[i];                                                    \
+        if (nn == MIN) {                                                   \
+            d[i] = MAX;                                                    \
+            q = true;                                                      \
+        } else {                                                           \
+            d[i] = OP(nn);                                                 \
+        }                                                                  \
+    }                                                                      \
+    if (q) {                                                               \
+        uint32_t *qc = vq;                                                 \
+        qc[0] = 1;                                                         \
+    }                                                                      \
+    clear_tail(d, oprsz, simd_maxsz(desc));                                \
+}
+
+#define DO_ABS(X)  ((X) < 0 ? -(X) : (X))
+#define DO_NEG(X)  (-(X))
+
+DO_SAT1(gvec_sqabs_b, int8_t, INT8_MIN, INT8_MAX, DO_ABS)
+DO_SAT1(gvec_sqabs_h, int16_t, INT16_MIN, INT16_MAX, DO_ABS)
+DO_SAT1(gvec_sqabs_s, int32_t, INT32_MIN, INT32_MAX, DO_ABS)
+DO_SAT1(gvec_sqabs_d, int64_t, INT64_MIN, INT64_MAX, DO_ABS)
+
+DO_SAT1(gvec_sqneg_b, int8_t, INT8_MIN, INT8_MAX, DO_NEG)
+DO_SAT1(gvec_sqneg_h, int16_t, INT16_MIN, INT16_MAX, DO_NEG)
+DO_SAT1(gvec_sqneg_s, int32_t, INT32_MIN, INT32_MAX, DO_NEG)
+DO_SAT1(gvec_sqneg_d, int64_t, INT64_MIN, INT64_MAX, DO_NEG)
+
+#undef DO_ABS
+#undef DO_NEG
+#undef DO_SAT1
+
+static inline int64_t do_sat_narrow_s(int64_t x, int64_t min, int64_t max,
+                                      bool *q)
+{
+    if (x < min) {
+        *q = true;
+        return min;
+    } else if (x > max) {
+        *q = true;
+        return max;
+    }
+    return x;
+}
+
+static inline uint64_t do_sat_narrow_u(uint64_t x, uint64_t max, bool *q)
+{
+    if (x > max) {
+        *q = true;
+        return max;
+    }
+    return x;
+}
+
+/*
+ * SQXTN, UQXTN and SQXTUN: saturate the elements of @vn into the low 64
+ * bits of @vd.  The "2" forms have an oprsz of 16 and write the high 64
+ * bits instead, keeping the low ones.
+ */
+#define DO_SAT_NARROW(NAME, TYPED, HD, TYPEN, HN, SAT)                     \
+void HELPER(NAME)(void *vd, void *vn, void *vq, uint32_t desc)            \
+{                                                                          \
+    intptr_t i, oprsz = simd_oprsz(desc);                                  \
+    TYPEN *n = vn;                                                         \
+    union {                                                                \
+        TYPED e[8 / sizeof(TYPED)];                                        \
+        uint64_t d;                                                        \
+    } r;                                                                   \
+    bool q = false;                                                        \
+    for (i = 0; i < 8 / sizeof(TYPED); i++) {                              \
+        r.e[HD(i)] = SAT(n[HN(i)], &q);                                    \
+    }                                                                      \
+    ((uint64_t *)vd)[oprsz == 16] = r.d;                                   \
+    if (q) {                                                               \
+        uint32_t *qc = vq;                                                 \
+        qc[0] = 1;                                                         \
+    }                                                                      \
+    clear_tail(vd, oprsz, simd_maxsz(desc));                               \
+}
+
+#define DO_SQXTN_B(X, Q)   do_sat_narrow_s(X, INT8_MIN, INT8_MAX, Q)
+#define DO_SQXTN_H(X, Q)   do_sat_narrow_s(X, INT16_MIN, INT16_MAX, Q)
+#define DO_SQXTN_S(X, Q)   do_sat_narrow_s(X, INT32_MIN, INT32_MAX, Q)
+#define DO_UQXTN_B(X, Q)   do_sat_narrow_u(X, UINT8_MAX, Q)
+#define DO_UQXTN_H(X, Q)   do_sat_narrow_u(X, UINT16_MAX, Q)
+#define DO_UQXTN_S(X, Q)   do_sat_narrow_u(X, UINT32_MAX, Q)
+#define DO_SQXTUN_B(X, Q)  do_sat_narrow_s(X, 0, UINT8_MAX, Q)
+#define DO_SQXTUN_H(X, Q)  do_sat_narrow_s(X, 0, UINT16_MAX, Q)
+#define DO_SQXTUN_S(X, Q)  do_sat_narrow_s(X, 0, UINT32_MAX, Q)
+
+DO_SAT_NARROW(gvec_sqxtn_b, int8_t, H1, int16_t, H2, DO_SQXTN_B)
+DO_SAT_NARROW(gvec_sqxtn_h, int16_t, H2, int32_t, H4, DO_SQXTN_H)
+DO_SAT_NARROW(gvec_sqxtn_s, int32_t, H4, int64_t, H8, DO_SQXTN_S)
+
+DO_SAT_NARROW(gvec_uqxtn_b, uint8_t, H1, uint16_t, H2, DO_UQXTN_B)
+DO_SAT_NARROW(gvec_uqxtn_h, uint16_t, H2, uint32_t, H4, DO_UQXTN_H)
+DO_SAT_NARROW(gvec_uqxtn_s, uint32_t, H4, uint64_t, H8, DO_UQXTN_S)
+
+DO_SAT_NARROW(gvec_sqxtun_b, uint8_t, H1, int16_t, H2, DO_SQXTUN_B)
+DO_SAT_NARROW(gvec_sqxtun_h, uint16_t, H2, int32_t, H4, DO_SQXTUN_H)
+DO_SAT_NARROW(gvec_sqxtun_s, uint32_t, H4, int64_t, H8, DO_SQXTUN_S)
+
+#undef DO_SQXTN_B
+#undef DO_SQXTN_H
+#undef DO_SQXTN_S
+#undef DO_UQXTN_B
+#undef DO_UQXTN_H
+#undef DO_UQXTN_S
+#undef DO_SQXTUN_B
+#undef DO_SQXTUN_H
+#undef DO_SQXTUN_S
+#undef DO_SAT_NARROW
+
 
 #define DO_SRA(NAME, TYPE)                              \
 void HELPER(NAME)(void *vd, void *vn, uint32_t desc)    \
@@ -2005,6 +2126,59 @@ void HELPER(gvec_pmul_b)(void *vd, void *vn, void *vm, uint32_t desc)
     clear_tail(d, opr_sz, simd_maxsz(desc));
 }
 
+/*
+ * Host carry-less multiply for gvec_pmull_q, giving the product in
+ * little-endian order.
+ */
+#if defined(CONFIG_X86_CRYPTO_OPT)
+#include "qemu/cpuid.h"
+
+static bool host_pmull;
+
+#pragma GCC push_options
+#pragma GCC target("pclmul")
+#include <wmmintrin.h>
+
+static void host_pmull_q(uint64_t *d, uint64_t n, uint64_t m)
+{
+    __m128i r = _mm_clmulepi64_si128(_mm_set_epi64x(0, n),
+                                     _mm_set_epi64x(0, m), 0);
+
+    _mm_storeu_si128((__m128i *)d, r);
+}
+#pragma GCC pop_options
+
+static void __attribute__((constructor)) init_host_pmull(void)
+{
+    unsigned a, b, c, d;
+
+    if (__get_cpuid_max(0, NULL) >= 1) {
+        __cpuid(1, a, b, c, d);
+        host_pmull = c & bit_PCLMUL;
+    }
+}
+
+#elif defined(__aarch64__) && !HOST_BIG_ENDIAN && defined(__ARM_FEATURE_AES)
+#include <arm_neon.h>
+
+#define host_pmull true
+
+static void host_pmull_q(uint64_t *d, uint64_t n, uint64_t m)
+{
+    poly128_t r = vmull_p64(n, m);
+
+    memcpy(d, &r, sizeof(r));
+}
+
+#else
+#define host_pmull false
+
+static void host_pmull_q(uint64_t *d, uint64_t n, uint64_t m)
+{
+    g_assert_not_reached();
+}
+#endif
+
 /*
  * 64x64->128 polynomial multiply.
  * Because of the lanes are not accessed in strict columns,
@@ -2022,6 +2196,11 @@ void HELPER(gvec_pmull_q)(void *vd, void *vn, void *vm, uint32_t desc)
         uint64_t rhi = 0;
         uint64_t rlo = 0;
 
+        if (host_pmull) {
+            host_pmull_q(&d[i], nn, mm);
+            continue;
+        }
+
         /* Bit 0 can only influence the low 64-bit result.  */
         if (nn & 1) {
             rlo = mm;
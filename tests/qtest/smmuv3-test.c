@@ -0,0 +1,348 @@
+/*
+ * QTest testcase for the SMMUv3 IOTLB
+ *
+ * Programs the SMMUv3 of the virt machine with a stage 1 context for an
+ * edu device and has it DMA through the SMMU, checking that translations
+ * are cached, that TLBI commands drop them, and that the cache statistics
+ * exported as QOM properties follow. With -m perf the DMA loop also runs
+ * against invalidation storms and reports the throughput.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "qemu/osdep.h"
+#include "libqtest.h"
+#include "libqos/generic-pcihost.h"
+#include "qapi/qmp/qdict.h"
+#include "qapi/qmp/qlist.h"
+
+#define SMMU_BASE           0x09050000
+#define SMMU_CR0            0x20
+#define SMMU_CR0ACK         0x24
+#define SMMU_STRTAB_BASE    0x80
+#define SMMU_STRTAB_CFG     0x88
+#define SMMU_CMDQ_BASE      0x90
+#define SMMU_CMDQ_PROD      0x98
+#define SMMU_CR0_ENABLE     (1 << 0)
+#define SMMU_CR0_CMDQEN     (1 << 3)
+
+#define CMD_CFGI_STE        0x03
+#define CMD_TLBI_NH_ASID    0x11
+#define CMD_TLBI_NH_VA      0x12
+#define CMD_SYNC            0x46
+
+#define EDU_DMA_SRC         0x80
+#define EDU_DMA_DST         0x88
+#define EDU_DMA_CNT         0x90
+#define EDU_DMA_CMD         0x98
+#define EDU_DMA_RUN         0x1
+#define EDU_DMA_TO_PCI      0x2
+#define EDU_BUF             0x40000
+
+/* Guest RAM layout */
+#define STRTAB_ADDR         0x44000000
+#define STRTAB_LOG2SIZE     5
+#define CMDQ_ADDR           0x44001000
+#define CMDQ_LOG2SIZE       8
+#define CD_ADDR             0x44002000
+#define PT_ADDR             0x44010000 /* L0, L1, L2, L3 tables */
+#define DATA_ADDR           0x45000000
+#define ALT_ADDR            0x46000000
+
+#define EDU_DEVFN           QPCI_DEVFN(1, 0)
+#define ASID                1
+#define IOVA_BASE           0x100000
+#define NR_PAGES            64
+#define PAGE_SIZE           0x1000
+
+typedef struct SMMUTest {
+    QTestState *qts;
+    QGenericPCIBus bus;
+    QPCIDevice *edu;
+    QPCIBar bar;
+    char *smmu_path;
+    uint32_t cmdq_prod;
+} SMMUTest;
+
+static void cmdq_push(SMMUTest *t, uint32_t w0, uint32_t w1, uint32_t w2,
+                      uint32_t w3)
+{
+    uint32_t mask = (1 << CMDQ_LOG2SIZE) - 1;
+    uint64_t ent = CMDQ_ADDR + (t->cmdq_prod & mask) * 16;
+
+    qtest_writel(t->qts, ent, w0);
+    qtest_writel(t->qts, ent + 4, w1);
+    qtest_writel(t->qts, ent + 8, w2);
+    qtest_writel(t->qts, ent + 12, w3);
+    t->cmdq_prod = (t->cmdq_prod + 1) & ((1 << (CMDQ_LOG2SIZE + 1)) - 1);
+}
+
+/* Commands are consumed synchronously when the producer index is written */
+static void cmdq_sync(SMMUTest *t)
+{
+    cmdq_push(t, CMD_SYNC, 0, 0, 0);
+    qtest_writel(t->qts, SMMU_BASE + SMMU_CMDQ_PROD, t->cmdq_prod);
+}
+
+static void tlbi_va(SMMUTest *t, uint64_t iova)
+{
+    cmdq_push(t, CMD_TLBI_NH_VA, ASID << 16,
+              iova & 0xfffff000, iova >> 32);
+}
+
+static void map_page(SMMUTest *t, uint64_t iova, uint64_t pa)
+{
+    /* Valid page, AF set, AP = 0 (read/write) */
+    qtest_writeq(t->qts, PT_ADDR + 3 * PAGE_SIZE + ((iova >> 12) & 511) * 8,
+                 pa | (1 << 10) | 3);
+}
+
+static void edu_dma(SMMUTest *t, uint64_t src, uint64_t dst, uint32_t cmd)
+{
+    qpci_io_writeq(t->edu, t->bar, EDU_DMA_SRC, src);
+    qpci_io_writeq(t->edu, t->bar, EDU_DMA_DST, dst);
+    qpci_io_writeq(t->edu, t->bar, EDU_DMA_CNT, PAGE_SIZE);
+    qpci_io_writeq(t->edu, t->bar, EDU_DMA_CMD, cmd | EDU_DMA_RUN);
+    /* The transfer runs from a 100ms timer */
+    qtest_clock_step(t->qts, 100 * 1000 * 1000);
+    g_assert_cmphex(qpci_io_readq(t->edu, t->bar, EDU_DMA_CMD) & EDU_DMA_RUN,
+                    ==, 0);
+}
+
+/* Copy one page from @src_iova to @dst_iova through the edu buffer */
+static void edu_copy(SMMUTest *t, uint64_t src_iova, uint64_t dst_iova)
+{
+    edu_dma(t, src_iova, EDU_BUF, 0);
+    edu_dma(t, EDU_BUF, dst_iova, EDU_DMA_TO_PCI);
+}
+
+static uint64_t smmu_stat(SMMUTest *t, const char *name)
+{
+    QDict *rsp = qtest_qmp(t->qts, "{ 'execute': 'qom-get', 'arguments': "
+                           "{ 'path': %s, 'property': %s } }",
+                           t->smmu_path, name);
+    uint64_t val;
+
+    g_assert(qdict_haskey(rsp, "return"));
+    val = qdict_get_int(rsp, "return");
+    qobject_unref(rsp);
+    return val;
+}
+
+static char *find_smmu(QTestState *qts)
+{
+    QDict *rsp = qtest_qmp(qts, "{ 'execute': 'qom-list', 'arguments': "
+                           "{ 'path': '/machine/unattached' } }");
+    QListEntry *e;
+    char *path = NULL;
+
+    g_assert(qdict_haskey(rsp, "return"));
+    QLIST_FOREACH_ENTRY(qdict_get_qlist(rsp, "return"), e) {
+        QDict *prop = qobject_to(QDict, qlist_entry_obj(e));
+
+        if (!strcmp(qdict_get_str(prop, "type"), "child<arm-smmuv3>")) {
+            path = g_strdup_printf("/machine/unattached/%s",
+                                   qdict_get_str(prop, "name"));
+            break;
+        }
+    }
+    qobject_unref(rsp);
+    g_assert(path);
+    return path;
+}
+
+static void smmu_setup(SMMUTest *t, const char *extra)
+{
+    uint64_t sid = EDU_DEVFN;
+    int i;
+
+    t->qts = qtest_initf("-M virt,iommu=smmuv3 -cpu max "
+                         "-device edu,addr=01.0 %s", extra);
+    t->smmu_path = find_smmu(t->qts);
+
+    qpci_init_generic(&t->bus, t->qts, NULL, false);
+    t->edu = qpci_device_find(&t->bus.bus, EDU_DEVFN);
+    g_assert(t->edu);
+    qpci_device_enable(t->edu);
+    t->bar = qpci_iomap(t->edu, 0, NULL);
+
+    /* Stage 1 STE pointing at a single context descriptor */
+    qtest_memset(t->qts, STRTAB_ADDR, 0, 64 << STRTAB_LOG2SIZE);
+    qtest_writeq(t->qts, STRTAB_ADDR + sid * 64, CD_ADDR | (5 << 1) | 1);
+
+    /* T0SZ = 16, 4K granule, TTB1 disabled; AArch64, ASID */
+    qtest_memset(t->qts, CD_ADDR, 0, 64);
+    qtest_writel(t->qts, CD_ADDR, 16 | (1 << 30) | (1u << 31));
+    qtest_writel(t->qts, CD_ADDR + 4, 5 | (1 << 9) | (1 << 13) | (1 << 14) |
+                 (ASID << 16));
+    qtest_writeq(t->qts, CD_ADDR + 8, PT_ADDR);
+
+    /* Four levels of tables, the last one mapping NR_PAGES pages */
+    qtest_memset(t->qts, PT_ADDR, 0, 4 * PAGE_SIZE);
+    for (i = 0; i < 3; i++) {
+        qtest_writeq(t->qts, PT_ADDR + i * PAGE_SIZE,
+                     (PT_ADDR + (i + 1) * PAGE_SIZE) | 3);
+    }
+    for (i = 0; i < NR_PAGES; i++) {
+        map_page(t, IOVA_BASE + i * PAGE_SIZE, DATA_ADDR + i * PAGE_SIZE);
+    }
+
+    qtest_writeq(t->qts, SMMU_BASE + SMMU_STRTAB_BASE, STRTAB_ADDR);
+    qtest_writel(t->qts, SMMU_BASE + SMMU_STRTAB_CFG, STRTAB_LOG2SIZE);
+    qtest_writeq(t->qts, SMMU_BASE + SMMU_CMDQ_BASE,
+                 CMDQ_ADDR | CMDQ_LOG2SIZE);
+    qtest_writel(t->qts, SMMU_BASE + SMMU_CR0,
+                 SMMU_CR0_ENABLE | SMMU_CR0_CMDQEN);
+    g_assert_cmphex(qtest_readl(t->qts, SMMU_BASE + SMMU_CR0ACK), ==,
+                    SMMU_CR0_ENABLE | SMMU_CR0_CMDQEN);
+
+    cmdq_push(t, CMD_CFGI_STE, sid, 0, 0);
+    cmdq_sync(t);
+}
+
+static void smmu_teardown(SMMUTest *t)
+{
+    g_free(t->edu);
+    g_free(t->smmu_path);
+    qtest_quit(t->qts);
+}
+
+static void fill_page(SMMUTest *t, uint64_t pa, uint8_t seed)
+{
+    uint8_t buf[PAGE_SIZE];
+    int i;
+
+    for (i = 0; i < PAGE_SIZE; i++) {
+        buf[i] = seed + i * 7;
+    }
+    qtest_memwrite(t->qts, pa, buf, PAGE_SIZE);
+}
+
+static void check_page(SMMUTest *t, uint64_t pa, uint8_t seed)
+{
+    uint8_t buf[PAGE_SIZE];
+    int i;
+
+    qtest_memread(t->qts, pa, buf, PAGE_SIZE);
+    for (i = 0; i < PAGE_SIZE; i++) {
+        g_assert_cmphex(buf[i], ==, (uint8_t)(seed + i * 7));
+    }
+}
+
+static void test_smmu_iotlb(void)
+{
+    SMMUTest t = { 0 };
+    uint64_t hits, misses, inv;
+
+    smmu_setup(&t, "");
+
+    fill_page(&t, DATA_ADDR, 0x11);
+    edu_copy(&t, IOVA_BASE, IOVA_BASE + PAGE_SIZE);
+    check_page(&t, DATA_ADDR + PAGE_SIZE, 0x11);
+    g_assert_cmpuint(smmu_stat(&t, "iotlb-misses"), ==, 2);
+    g_assert_cmpuint(smmu_stat(&t, "config-cache-misses"), ==, 1);
+
+    /* Same pages again: served from the IOTLB */
+    hits = smmu_stat(&t, "iotlb-hits");
+    fill_page(&t, DATA_ADDR, 0x22);
+    edu_copy(&t, IOVA_BASE, IOVA_BASE + PAGE_SIZE);
+    check_page(&t, DATA_ADDR + PAGE_SIZE, 0x22);
+    g_assert_cmpuint(smmu_stat(&t, "iotlb-hits"), ==, hits + 2);
+    g_assert_cmpuint(smmu_stat(&t, "iotlb-misses"), ==, 2);
+
+    /*
+     * Remap the destination. Without an invalidation the stale entry is
+     * still used, after TLBI by VA the new mapping is.
+     */
+    map_page(&t, IOVA_BASE + PAGE_SIZE, ALT_ADDR);
+    fill_page(&t, DATA_ADDR, 0x33);
+    edu_copy(&t, IOVA_BASE, IOVA_BASE + PAGE_SIZE);
+    check_page(&t, DATA_ADDR + PAGE_SIZE, 0x33);
+
+    inv = smmu_stat(&t, "iotlb-invalidated-entries");
+    tlbi_va(&t, IOVA_BASE + PAGE_SIZE);
+    cmdq_sync(&t);
+    g_assert_cmpuint(smmu_stat(&t, "iotlb-invalidated-entries"), ==, inv + 1);
+
+    misses = smmu_stat(&t, "iotlb-misses");
+    fill_page(&t, DATA_ADDR, 0x44);
+    edu_copy(&t, IOVA_BASE, IOVA_BASE + PAGE_SIZE);
+    check_page(&t, ALT_ADDR, 0x44);
+    g_assert_cmpuint(smmu_stat(&t, "iotlb-misses"), ==, misses + 1);
+
+    /* TLBI by ASID drops the source page too */
+    inv = smmu_stat(&t, "iotlb-invalidated-entries");
+    cmdq_push(&t, CMD_TLBI_NH_ASID, ASID << 16, 0, 0);
+    cmdq_sync(&t);
+    g_assert_cmpuint(smmu_stat(&t, "iotlb-invalidated-entries"), ==, inv + 2);
+
+    smmu_teardown(&t);
+}
+
+/* A tiny IOTLB is flushed whenever it fills up, but stays correct */
+static void test_smmu_iotlb_size(void)
+{
+    SMMUTest t = { 0 };
+    int i;
+
+    smmu_setup(&t, "-global arm-smmuv3.iotlb-size=4");
+
+    for (i = 0; i < 8; i++) {
+        fill_page(&t, DATA_ADDR + i * PAGE_SIZE, i);
+        edu_copy(&t, IOVA_BASE + i * PAGE_SIZE,
+                 IOVA_BASE + (NR_PAGES - 1 - i) * PAGE_SIZE);
+        check_page(&t, DATA_ADDR + (NR_PAGES - 1 - i) * PAGE_SIZE, i);
+    }
+    g_assert_cmpuint(smmu_stat(&t, "iotlb-flushes"), >, 0);
+
+    smmu_teardown(&t);
+}
+
+/*
+ * DMA over all mapped pages while invalidating a page of the range
+ * before each transfer, as a hypervisor guest unmapping buffers does.
+ */
+static void test_smmu_perf(void)
+{
+    SMMUTest t = { 0 };
+    int iters = 256, i;
+    gint64 start;
+    double secs;
+
+    smmu_setup(&t, "-global arm-smmuv3.iotlb-size=4096");
+
+    start = g_get_monotonic_time();
+    for (i = 0; i < iters; i++) {
+        int page = i % NR_PAGES;
+
+        tlbi_va(&t, IOVA_BASE + ((i * 7) % NR_PAGES) * PAGE_SIZE);
+        cmdq_sync(&t);
+        edu_copy(&t, IOVA_BASE + page * PAGE_SIZE,
+                 IOVA_BASE + (NR_PAGES - 1 - page) * PAGE_SIZE);
+    }
+    secs = (g_get_monotonic_time() - start) / 1e6;
+
+    g_test_message("%d copies in %.3f s, %.0f copies/s; "
+                   "iotlb hits %" PRIu64 " misses %" PRIu64
+                   " invalidations %" PRIu64,
+                   iters, secs, iters / secs,
+                   smmu_stat(&t, "iotlb-hits"),
+                   smmu_stat(&t, "iotlb-misses"),
+                   smmu_stat(&t, "iotlb-invalidations"));
+    g_assert_cmpuint(smmu_stat(&t, "iotlb-invalidations"), >=, iters);
+
+    smmu_teardown(&t);
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+
+    qtest_add_func("/smmuv3/iotlb", test_smmu_iotlb);
+    qtest_add_func("/smmuv3/iotlb-size", test_smmu_iotlb_size);
+    if (g_test_perf()) {
+        qtest_add_func("/smmuv3/perf", test_smmu_perf);
+    }
+
+    return g_test_run();
+}
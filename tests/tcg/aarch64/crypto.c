@@ -0,0 +1,264 @@
+/*
+ * Crypto Extension known answer tests
+ *
+ * Runs FIPS-197 AES-128 and FIPS 180 SHA-1/SHA-256 "abc" vectors through
+ * the AES, SHA1 and SHA256 instructions, and checks PMULL against a plain
+ * C carry-less multiply. The emulation may use the host's crypto
+ * instructions, which must give the same results as the C helpers.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <arm_neon.h>
+
+static int errors;
+
+static void check(const char *name, const void *got, const void *exp,
+                  size_t len)
+{
+    if (memcmp(got, exp, len)) {
+        const uint8_t *g = got, *e = exp;
+        size_t i;
+
+        printf("FAIL %s\n  got: ", name);
+        for (i = 0; i < len; i++) {
+            printf("%02x", g[i]);
+        }
+        printf("\n  exp: ");
+        for (i = 0; i < len; i++) {
+            printf("%02x", e[i]);
+        }
+        printf("\n");
+        errors++;
+    }
+}
+
+static uint8_t sbox(uint8_t x)
+{
+    /* Only used for the key schedule, find it via the AESE insn.  */
+    uint8x16_t v = vaeseq_u8(vdupq_n_u8(x), vdupq_n_u8(0));
+
+    return vgetq_lane_u8(v, 0);
+}
+
+static void aes128_expand_key(const uint8_t *key, uint8x16_t rk[11])
+{
+    uint8_t w[176];
+    uint8_t rcon = 1;
+    int i;
+
+    memcpy(w, key, 16);
+    for (i = 16; i < 176; i += 4) {
+        uint8_t t[4];
+
+        memcpy(t, &w[i - 4], 4);
+        if (i % 16 == 0) {
+            uint8_t t0 = t[0];
+
+            t[0] = sbox(t[1]) ^ rcon;
+            t[1] = sbox(t[2]);
+            t[2] = sbox(t[3]);
+            t[3] = sbox(t0);
+            rcon = (rcon << 1) ^ (rcon & 0x80 ? 0x1b : 0);
+        }
+        w[i + 0] = w[i - 16] ^ t[0];
+        w[i + 1] = w[i - 15] ^ t[1];
+        w[i + 2] = w[i - 14] ^ t[2];
+        w[i + 3] = w[i - 13] ^ t[3];
+    }
+    for (i = 0; i < 11; i++) {
+        rk[i] = vld1q_u8(&w[i * 16]);
+    }
+}
+
+static void test_aes(void)
+{
+    static const uint8_t key[16] = {
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f,
+    };
+    static const uint8_t pt[16] = {
+        0x00, 0x11, 0x22, 0x33, 0x44, 0x55, 0x66, 0x77,
+        0x88, 0x99, 0xaa, 0xbb, 0xcc, 0xdd, 0xee, 0xff,
+    };
+    static const uint8_t ct[16] = {
+        0x69, 0xc4, 0xe0, 0xd8, 0x6a, 0x7b, 0x04, 0x30,
+        0xd8, 0xcd, 0xb7, 0x80, 0x70, 0xb4, 0xc5, 0x5a,
+    };
+    uint8x16_t rk[11], st;
+    uint8_t out[16];
+    int r;
+
+    aes128_expand_key(key, rk);
+
+    st = vld1q_u8(pt);
+    for (r = 0; r < 9; r++) {
+        st = vaesmcq_u8(vaeseq_u8(st, rk[r]));
+    }
+    st = veorq_u8(vaeseq_u8(st, rk[9]), rk[10]);
+    vst1q_u8(out, st);
+    check("aes128 encrypt", out, ct, 16);
+
+    st = vaesimcq_u8(vaesdq_u8(vld1q_u8(ct), rk[10]));
+    for (r = 9; r > 1; r--) {
+        st = vaesimcq_u8(vaesdq_u8(st, vaesimcq_u8(rk[r])));
+    }
+    st = veorq_u8(vaesdq_u8(st, vaesimcq_u8(rk[1])), rk[0]);
+    vst1q_u8(out, st);
+    check("aes128 decrypt", out, pt, 16);
+}
+
+/* The one block of padded "abc", as big-endian words.  */
+static void load_abc(uint32x4_t msg[4])
+{
+    uint8_t block[64] = { 'a', 'b', 'c', 0x80 };
+    int i;
+
+    block[63] = 24;
+    for (i = 0; i < 4; i++) {
+        msg[i] = vreinterpretq_u32_u8(vrev32q_u8(vld1q_u8(&block[i * 16])));
+    }
+}
+
+static void test_sha1(void)
+{
+    static const uint32_t k[4] = {
+        0x5a827999, 0x6ed9eba1, 0x8f1bbcdc, 0xca62c1d6,
+    };
+    static const uint32_t init[5] = {
+        0x67452301, 0xefcdab89, 0x98badcfe, 0x10325476, 0xc3d2e1f0,
+    };
+    static const uint32_t exp[5] = {
+        0xa9993e36, 0x4706816a, 0xba3e2571, 0x7850c26c, 0x9cd0d89d,
+    };
+    uint32x4_t abcd = vld1q_u32(init), msg[4];
+    uint32_t e0 = init[4], e1, out[5];
+    int i;
+
+    load_abc(msg);
+    for (i = 0; i < 20; i++) {
+        uint32x4_t wk = vaddq_u32(msg[i & 3], vdupq_n_u32(k[i / 5]));
+
+        e1 = vsha1h_u32(vgetq_lane_u32(abcd, 0));
+        if (i < 5) {
+            abcd = vsha1cq_u32(abcd, e0, wk);
+        } else if (i < 10 || i >= 15) {
+            abcd = vsha1pq_u32(abcd, e0, wk);
+        } else {
+            abcd = vsha1mq_u32(abcd, e0, wk);
+        }
+        e0 = e1;
+        if (i < 16) {
+            msg[i & 3] = vsha1su1q_u32(vsha1su0q_u32(msg[i & 3],
+                                                     msg[(i + 1) & 3],
+                                                     msg[(i + 2) & 3]),
+                                       msg[(i + 3) & 3]);
+        }
+    }
+    vst1q_u32(out, vaddq_u32(abcd, vld1q_u32(init)));
+    out[4] = e0 + init[4];
+    check("sha1", out, exp, sizeof(exp));
+}
+
+static void test_sha256(void)
+{
+    static const uint32_t k[64] = {
+        0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5,
+        0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+        0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3,
+        0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+        0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc,
+        0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+        0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7,
+        0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+        0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13,
+        0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+        0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3,
+        0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+        0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5,
+        0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+        0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208,
+        0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2,
+    };
+    static const uint32_t init[8] = {
+        0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a,
+        0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19,
+    };
+    static const uint32_t exp[8] = {
+        0xba7816bf, 0x8f01cfea, 0x414140de, 0x5dae2223,
+        0xb00361a3, 0x96177a9c, 0xb410ff61, 0xf20015ad,
+    };
+    uint32x4_t abcd = vld1q_u32(&init[0]);
+    uint32x4_t efgh = vld1q_u32(&init[4]);
+    uint32x4_t msg[4];
+    uint32_t out[8];
+    int i;
+
+    load_abc(msg);
+    for (i = 0; i < 16; i++) {
+        uint32x4_t wk = vaddq_u32(msg[i & 3], vld1q_u32(&k[i * 4]));
+        uint32x4_t tmp = abcd;
+
+        if (i < 12) {
+            msg[i & 3] = vsha256su1q_u32(vsha256su0q_u32(msg[i & 3],
+                                                         msg[(i + 1) & 3]),
+                                         msg[(i + 2) & 3], msg[(i + 3) & 3]);
+        }
+        abcd = vsha256hq_u32(abcd, efgh, wk);
+        efgh = vsha256h2q_u32(efgh, tmp, wk);
+    }
+    vst1q_u32(&out[0], vaddq_u32(abcd, vld1q_u32(&init[0])));
+    vst1q_u32(&out[4], vaddq_u32(efgh, vld1q_u32(&init[4])));
+    check("sha256", out, exp, sizeof(exp));
+}
+
+static void clmul64(uint64_t a, uint64_t b, uint64_t r[2])
+{
+    int i;
+
+    r[0] = r[1] = 0;
+    for (i = 0; i < 64; i++) {
+        if (a & (1ull << i)) {
+            r[0] ^= b << i;
+            r[1] ^= i ? b >> (64 - i) : 0;
+        }
+    }
+}
+
+static void test_pmull(void)
+{
+    static const uint64_t v[] = {
+        0, 1, 0x8000000000000000ull, 0xffffffffffffffffull,
+        0x87, 0xc200000000000000ull, 0x0123456789abcdefull,
+        0xfedcba9876543210ull, 0x5555555555555555ull,
+    };
+    int i, j;
+
+    for (i = 0; i < sizeof(v) / sizeof(v[0]); i++) {
+        for (j = 0; j < sizeof(v) / sizeof(v[0]); j++) {
+            uint64_t exp[2], got[2];
+            poly128_t r = vmull_p64(v[i], v[j]);
+
+            memcpy(got, &r, sizeof(got));
+            clmul64(v[i], v[j], exp);
+            check("pmull", got, exp, sizeof(exp));
+        }
+    }
+}
+
+int main(void)
+{
+    test_aes();
+    test_sha1();
+    test_sha256();
+    test_pmull();
+
+    if (errors) {
+        printf("%d errors\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,153 @@
+/*
+ * SQXTN/UQXTN/SQXTUN vector tests
+ *
+ * Runs the saturating narrows and their "2" forms for every element
+ * size over inputs on both sides of the limits of the narrow type, and
+ * checks the results, the half of the destination that must be kept or
+ * cleared, and the cumulative saturation flag (FPSR.QC) against plain C.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FPSR_QC (1u << 27)
+
+static int errors;
+
+static uint64_t get_fpsr(void)
+{
+    uint64_t r;
+
+    asm volatile("mrs %0, fpsr" : "=r"(r));
+    return r;
+}
+
+static void clear_fpsr(void)
+{
+    asm volatile("msr fpsr, %0" : : "r"(0ul));
+}
+
+static void check(const char *name, int i, const void *got, const void *exp,
+                  int qc, int exp_qc)
+{
+    if (memcmp(got, exp, 16) || qc != exp_qc) {
+        printf("FAIL %s input %d: qc %d, expected %d%s\n", name, i, qc,
+               exp_qc, memcmp(got, exp, 16) ? ", wrong result" : "");
+        errors++;
+    }
+}
+
+/*
+ * Run @insn from v0 into v1 with v1 preloaded from @init, and store v1.
+ * The "2" forms write the high half of v1 and keep the low one.
+ */
+#define NARROW_FN(NAME, INSN, DARR, NARR)                               \
+static void NAME(void *d, const void *n, const void *init)              \
+{                                                                       \
+    asm volatile("ld1 {v0.16b}, [%1]\n\t"                               \
+                 "ld1 {v1.16b}, [%2]\n\t"                               \
+                 INSN " v1." DARR ", v0." NARR "\n\t"                   \
+                 "st1 {v1.16b}, [%0]"                                   \
+                 : : "r"(d), "r"(n), "r"(init)                          \
+                 : "v0", "v1", "memory");                               \
+}
+
+NARROW_FN(sqxtn_b, "sqxtn", "8b", "8h")
+NARROW_FN(sqxtn_b2, "sqxtn2", "16b", "8h")
+NARROW_FN(sqxtn_h, "sqxtn", "4h", "4s")
+NARROW_FN(sqxtn_h2, "sqxtn2", "8h", "4s")
+NARROW_FN(sqxtn_s, "sqxtn", "2s", "2d")
+NARROW_FN(sqxtn_s2, "sqxtn2", "4s", "2d")
+NARROW_FN(uqxtn_b, "uqxtn", "8b", "8h")
+NARROW_FN(uqxtn_b2, "uqxtn2", "16b", "8h")
+NARROW_FN(uqxtn_h, "uqxtn", "4h", "4s")
+NARROW_FN(uqxtn_h2, "uqxtn2", "8h", "4s")
+NARROW_FN(uqxtn_s, "uqxtn", "2s", "2d")
+NARROW_FN(uqxtn_s2, "uqxtn2", "4s", "2d")
+NARROW_FN(sqxtun_b, "sqxtun", "8b", "8h")
+NARROW_FN(sqxtun_b2, "sqxtun2", "16b", "8h")
+NARROW_FN(sqxtun_h, "sqxtun", "4h", "4s")
+NARROW_FN(sqxtun_h2, "sqxtun2", "8h", "4s")
+NARROW_FN(sqxtun_s, "sqxtun", "2s", "2d")
+NARROW_FN(sqxtun_s2, "sqxtun2", "4s", "2d")
+
+/*
+ * TD and TN are the narrow and the wide element types, LO and HI the
+ * limits of the result, NMIN and NMAX those of the input.
+ */
+#define TEST(NAME, TD, TN, LO, HI, NMIN, NMAX)                          \
+static void test_##NAME(void)                                           \
+{                                                                       \
+    static const TN in[] = {                                            \
+        0, 1, (TN)-1, HI, (TN)((TN)HI + 1), LO, (TN)((TN)LO - 1), NMAX, \
+        NMIN, 42, (TN)-42, (TN)-100, 100, 7, (TN)HI - 1, (TN)LO + 1,    \
+    };                                                                  \
+    enum { N = 16 / sizeof(TN) };                                       \
+    uint8_t init[16];                                                   \
+    int i, j;                                                           \
+                                                                        \
+    memset(init, 0x5a, sizeof(init));                                   \
+    for (i = 0; i + N <= sizeof(in) / sizeof(in[0]); i += N) {          \
+        TD sat[N];                                                      \
+        uint8_t got[16], exp[16];                                       \
+        int exp_qc = 0;                                                 \
+                                                                        \
+        for (j = 0; j < N; j++) {                                       \
+            TN x = in[i + j];                                           \
+            if (x < LO) {                                               \
+                sat[j] = LO;                                            \
+                exp_qc = 1;                                             \
+            } else if (x > HI) {                                        \
+                sat[j] = HI;                                            \
+                exp_qc = 1;                                             \
+            } else {                                                    \
+                sat[j] = x;                                             \
+            }                                                           \
+        }                                                               \
+                                                                        \
+        memset(exp, 0, sizeof(exp));                                    \
+        memcpy(exp, sat, 8);                                            \
+        clear_fpsr();                                                   \
+        NAME(got, in + i, init);                                        \
+        check(#NAME, i, got, exp, !!(get_fpsr() & FPSR_QC), exp_qc);    \
+                                                                        \
+        memcpy(exp, init, 8);                                           \
+        memcpy(exp + 8, sat, 8);                                        \
+        clear_fpsr();                                                   \
+        NAME##2(got, in + i, init);                                     \
+        check(#NAME "2", i, got, exp, !!(get_fpsr() & FPSR_QC),         \
+              exp_qc);                                                  \
+    }                                                                   \
+}
+
+TEST(sqxtn_b, int8_t, int16_t, INT8_MIN, INT8_MAX, INT16_MIN, INT16_MAX)
+TEST(sqxtn_h, int16_t, int32_t, INT16_MIN, INT16_MAX, INT32_MIN, INT32_MAX)
+TEST(sqxtn_s, int32_t, int64_t, INT32_MIN, INT32_MAX, INT64_MIN, INT64_MAX)
+TEST(uqxtn_b, uint8_t, uint16_t, 0, UINT8_MAX, 0, UINT16_MAX)
+TEST(uqxtn_h, uint16_t, uint32_t, 0, UINT16_MAX, 0, UINT32_MAX)
+TEST(uqxtn_s, uint32_t, uint64_t, 0, UINT32_MAX, 0, UINT64_MAX)
+TEST(sqxtun_b, uint8_t, int16_t, 0, UINT8_MAX, INT16_MIN, INT16_MAX)
+TEST(sqxtun_h, uint16_t, int32_t, 0, UINT16_MAX, INT32_MIN, INT32_MAX)
+TEST(sqxtun_s, uint32_t, int64_t, 0, UINT32_MAX, INT64_MIN, INT64_MAX)
+
+int main(void)
+{
+    test_sqxtn_b();
+    test_sqxtn_h();
+    test_sqxtn_s();
+    test_uqxtn_b();
+    test_uqxtn_h();
+    test_uqxtn_s();
+    test_sqxtun_b();
+    test_sqxtun_h();
+    test_sqxtun_s();
+
+    if (errors) {
+        printf("%d errors\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,178 @@
+/*
+ * SQABS/SQNEG vector tests
+ *
+ * Runs the vector forms of SQABS and SQNEG for every element size over
+ * inputs including the most negative value, and checks the results and
+ * the cumulative saturation flag (FPSR.QC) against plain C.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <arm_neon.h>
+
+#define FPSR_QC (1u << 27)
+
+static int errors;
+
+static uint64_t get_fpsr(void)
+{
+    uint64_t r;
+
+    asm volatile("mrs %0, fpsr" : "=r"(r));
+    return r;
+}
+
+static void clear_fpsr(void)
+{
+    asm volatile("msr fpsr, %0" : : "r"(0ul));
+}
+
+static void check(const char *name, int i, const void *got, const void *exp,
+                  size_t len, int qc, int exp_qc)
+{
+    if (memcmp(got, exp, len) || qc != exp_qc) {
+        printf("FAIL %s input %d: qc %d, expected %d%s\n", name, i, qc,
+               exp_qc, memcmp(got, exp, len) ? ", wrong result" : "");
+        errors++;
+    }
+}
+
+/*
+ * For each element size: a table of inputs, run a vector at a time
+ * through the 128-bit form and through the 64-bit form when there is one.
+ */
+#define TEST(T, N, QF, DF, MIN, MAX, OP, NAME)                          \
+static void test_##NAME(void)                                           \
+{                                                                       \
+    static const T in[] = {                                             \
+        0, 1, -1, 2, MAX, MIN, MIN + 1, -MAX, 42, -42, MIN, 7,          \
+        -100, 100, MIN, 0,                                              \
+    };                                                                  \
+    void (*dfn)(T *, const T *) = DF;                                   \
+    int i, j;                                                           \
+                                                                        \
+    for (i = 0; i + N <= sizeof(in) / sizeof(in[0]); i += N) {          \
+        T got[N], exp[N];                                               \
+        int exp_qc = 0;                                                 \
+                                                                        \
+        for (j = 0; j < N; j++) {                                       \
+            T x = in[i + j];                                            \
+            if (x == MIN) {                                             \
+                exp[j] = MAX;                                           \
+                exp_qc = 1;                                             \
+            } else {                                                    \
+                exp[j] = OP(x);                                         \
+            }                                                           \
+        }                                                               \
+        clear_fpsr();                                                   \
+        QF(got, in + i);                                                \
+        check(#NAME, i, got, exp, sizeof(got),                          \
+              !!(get_fpsr() & FPSR_QC), exp_qc);                        \
+        if (dfn) {                                                      \
+            int half_qc = 0;                                            \
+                                                                        \
+            for (j = 0; j < N / 2; j++) {                               \
+                half_qc |= in[i + j] == MIN;                            \
+            }                                                           \
+            clear_fpsr();                                               \
+            memset(got, 0, sizeof(got));                                \
+            dfn(got, in + i);                                           \
+            check(#NAME " (64-bit)", i, got, exp, sizeof(got) / 2,      \
+                  !!(get_fpsr() & FPSR_QC), half_qc);                   \
+        }                                                               \
+    }                                                                   \
+}
+
+#define ABS(X) ((X) < 0 ? -(X) : (X))
+#define NEG(X) (-(X))
+
+static void qabs8(int8_t *d, const int8_t *n)
+{
+    vst1q_s8(d, vqabsq_s8(vld1q_s8(n)));
+}
+static void dabs8(int8_t *d, const int8_t *n)
+{
+    vst1_s8(d, vqabs_s8(vld1_s8(n)));
+}
+static void qneg8(int8_t *d, const int8_t *n)
+{
+    vst1q_s8(d, vqnegq_s8(vld1q_s8(n)));
+}
+static void dneg8(int8_t *d, const int8_t *n)
+{
+    vst1_s8(d, vqneg_s8(vld1_s8(n)));
+}
+static void qabs16(int16_t *d, const int16_t *n)
+{
+    vst1q_s16(d, vqabsq_s16(vld1q_s16(n)));
+}
+static void dabs16(int16_t *d, const int16_t *n)
+{
+    vst1_s16(d, vqabs_s16(vld1_s16(n)));
+}
+static void qneg16(int16_t *d, const int16_t *n)
+{
+    vst1q_s16(d, vqnegq_s16(vld1q_s16(n)));
+}
+static void dneg16(int16_t *d, const int16_t *n)
+{
+    vst1_s16(d, vqneg_s16(vld1_s16(n)));
+}
+static void qabs32(int32_t *d, const int32_t *n)
+{
+    vst1q_s32(d, vqabsq_s32(vld1q_s32(n)));
+}
+static void dabs32(int32_t *d, const int32_t *n)
+{
+    vst1_s32(d, vqabs_s32(vld1_s32(n)));
+}
+static void qneg32(int32_t *d, const int32_t *n)
+{
+    vst1q_s32(d, vqnegq_s32(vld1q_s32(n)));
+}
+static void dneg32(int32_t *d, const int32_t *n)
+{
+    vst1_s32(d, vqneg_s32(vld1_s32(n)));
+}
+static void qabs64(int64_t *d, const int64_t *n)
+{
+    vst1q_s64(d, vqabsq_s64(vld1q_s64(n)));
+}
+static void qneg64(int64_t *d, const int64_t *n)
+{
+    vst1q_s64(d, vqnegq_s64(vld1q_s64(n)));
+}
+
+/* There is no 64-bit form with 64-bit elements.  */
+#define dabs64 NULL
+#define dneg64 NULL
+
+TEST(int8_t, 16, qabs8, dabs8, INT8_MIN, INT8_MAX, ABS, sqabs_b)
+TEST(int8_t, 16, qneg8, dneg8, INT8_MIN, INT8_MAX, NEG, sqneg_b)
+TEST(int16_t, 8, qabs16, dabs16, INT16_MIN, INT16_MAX, ABS, sqabs_h)
+TEST(int16_t, 8, qneg16, dneg16, INT16_MIN, INT16_MAX, NEG, sqneg_h)
+TEST(int32_t, 4, qabs32, dabs32, INT32_MIN, INT32_MAX, ABS, sqabs_s)
+TEST(int32_t, 4, qneg32, dneg32, INT32_MIN, INT32_MAX, NEG, sqneg_s)
+TEST(int64_t, 2, qabs64, dabs64, INT64_MIN, INT64_MAX, ABS, sqabs_d)
+TEST(int64_t, 2, qneg64, dneg64, INT64_MIN, INT64_MAX, NEG, sqneg_d)
+
+int main(void)
+{
+    test_sqabs_b();
+    test_sqneg_b();
+    test_sqabs_h();
+    test_sqneg_h();
+    test_sqabs_s();
+    test_sqneg_s();
+    test_sqabs_d();
+    test_sqneg_d();
+
+    if (errors) {
+        printf("%d errors\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,130 @@
+/*
+ * TBL/TBX vector tests
+ *
+ * Looks up one to four table registers with indices inside and outside
+ * the table, through the 64-bit and 128-bit forms, and checks the
+ * results against plain C: TBL zeroes the bytes whose index is out of
+ * range, TBX keeps them.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+static int errors;
+
+/*
+ * The table is in v4-v7, the indices in v1 and the destination, loaded
+ * with @d first so that TBX has something to keep, in v0.
+ */
+#define TB_FN(NAME, INSN, ARR, LIST)                                    \
+static void NAME(uint8_t *d, const uint8_t *tab, const uint8_t *idx)    \
+{                                                                       \
+    asm volatile("ld1 {v4.16b-v7.16b}, [%1]\n\t"                        \
+                 "ld1 {v1.16b}, [%2]\n\t"                               \
+                 "ld1 {v0.16b}, [%0]\n\t"                               \
+                 INSN " v0." ARR ", " LIST ", v1." ARR "\n\t"           \
+                 "st1 {v0.16b}, [%0]"                                   \
+                 : : "r"(d), "r"(tab), "r"(idx)                         \
+                 : "v0", "v1", "v4", "v5", "v6", "v7", "memory");       \
+}
+
+#define LIST1 "{v4.16b}"
+#define LIST2 "{v4.16b, v5.16b}"
+#define LIST3 "{v4.16b, v5.16b, v6.16b}"
+#define LIST4 "{v4.16b, v5.16b, v6.16b, v7.16b}"
+
+TB_FN(tbl1_d, "tbl", "8b", LIST1)
+TB_FN(tbl2_d, "tbl", "8b", LIST2)
+TB_FN(tbl3_d, "tbl", "8b", LIST3)
+TB_FN(tbl4_d, "tbl", "8b", LIST4)
+TB_FN(tbl1_q, "tbl", "16b", LIST1)
+TB_FN(tbl2_q, "tbl", "16b", LIST2)
+TB_FN(tbl3_q, "tbl", "16b", LIST3)
+TB_FN(tbl4_q, "tbl", "16b", LIST4)
+TB_FN(tbx1_d, "tbx", "8b", LIST1)
+TB_FN(tbx2_d, "tbx", "8b", LIST2)
+TB_FN(tbx3_d, "tbx", "8b", LIST3)
+TB_FN(tbx4_d, "tbx", "8b", LIST4)
+TB_FN(tbx1_q, "tbx", "16b", LIST1)
+TB_FN(tbx2_q, "tbx", "16b", LIST2)
+TB_FN(tbx3_q, "tbx", "16b", LIST3)
+TB_FN(tbx4_q, "tbx", "16b", LIST4)
+
+static const struct {
+    const char *name;
+    void (*fn)(uint8_t *, const uint8_t *, const uint8_t *);
+    int len;
+    bool tbx;
+    bool q;
+} tests[] = {
+    { "tbl 1 8b", tbl1_d, 1, false, false },
+    { "tbl 2 8b", tbl2_d, 2, false, false },
+    { "tbl 3 8b", tbl3_d, 3, false, false },
+    { "tbl 4 8b", tbl4_d, 4, false, false },
+    { "tbl 1 16b", tbl1_q, 1, false, true },
+    { "tbl 2 16b", tbl2_q, 2, false, true },
+    { "tbl 3 16b", tbl3_q, 3, false, true },
+    { "tbl 4 16b", tbl4_q, 4, false, true },
+    { "tbx 1 8b", tbx1_d, 1, true, false },
+    { "tbx 2 8b", tbx2_d, 2, true, false },
+    { "tbx 3 8b", tbx3_d, 3, true, false },
+    { "tbx 4 8b", tbx4_d, 4, true, false },
+    { "tbx 1 16b", tbx1_q, 1, true, true },
+    { "tbx 2 16b", tbx2_q, 2, true, true },
+    { "tbx 3 16b", tbx3_q, 3, true, true },
+    { "tbx 4 16b", tbx4_q, 4, true, true },
+};
+
+/* Index vectors: in range for every table, straddling the sizes, huge.  */
+static const uint8_t indices[][16] = {
+    { 0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15 },
+    { 15, 16, 17, 31, 32, 33, 47, 48, 49, 63, 64, 65, 0, 31, 47, 63 },
+    { 255, 128, 64, 200, 1, 16, 32, 48, 127, 80, 5, 63, 62, 61, 0, 100 },
+    { 60, 50, 40, 30, 20, 10, 0, 255, 63, 17, 34, 51, 68, 85, 102, 119 },
+};
+
+int main(void)
+{
+    uint8_t tab[64], init[16];
+    int i, t, j;
+
+    for (i = 0; i < sizeof(tab); i++) {
+        tab[i] = 0x80 + i * 3;
+    }
+    memset(init, 0xee, sizeof(init));
+
+    for (t = 0; t < sizeof(tests) / sizeof(tests[0]); t++) {
+        for (i = 0; i < sizeof(indices) / sizeof(indices[0]); i++) {
+            uint8_t got[16], exp[16];
+            int n = tests[t].q ? 16 : 8;
+
+            memset(exp, 0, sizeof(exp));
+            for (j = 0; j < n; j++) {
+                uint8_t x = indices[i][j];
+
+                if (x < tests[t].len * 16) {
+                    exp[j] = tab[x];
+                } else if (tests[t].tbx) {
+                    exp[j] = init[j];
+                }
+            }
+
+            memcpy(got, init, sizeof(got));
+            tests[t].fn(got, tab, indices[i]);
+            if (memcmp(got, exp, sizeof(got))) {
+                printf("FAIL %s indices %d\n", tests[t].name, i);
+                errors++;
+            }
+        }
+    }
+
+    if (errors) {
+        printf("%d errors\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,352 @@
+/*
+ * SVE load/store tests
+ *
+ * Runs contiguous loads and stores, and a predicated add, with all-active
+ * and partial predicates, and gathers and scatters whose elements are on
+ * both sides of a page boundary, one of them straddling it. Inactive
+ * elements sit on a PROT_NONE page where the predicate allows it, so
+ * probing them would fault. Results are checked against plain C.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+/* The architectural maximum vector length, in bytes.  */
+#define MAX_VL 256
+
+static int errors;
+static unsigned int vl;
+static long ps;
+
+static unsigned int get_vl(void)
+{
+    uint64_t r;
+
+    asm("rdvl %0, #1" : "=r"(r));
+    return r;
+}
+
+/* Load @in under the predicate at @pred, store the whole vector to @out.  */
+#define LD1_FN(NAME, INSN, T)                                           \
+static void NAME(void *out, const void *in, const uint8_t *pred)        \
+{                                                                       \
+    asm volatile("ldr p0, [%2]\n\t"                                     \
+                 "ptrue p1.b\n\t"                                       \
+                 INSN " {z0." T "}, p0/z, [%1]\n\t"                     \
+                 "st1b {z0.b}, p1, [%0]"                                \
+                 : : "r"(out), "r"(in), "r"(pred)                       \
+                 : "v0", "p0", "p1", "memory");                         \
+}
+
+/* Load the whole vector from @in, store it to @out under the predicate.  */
+#define ST1_FN(NAME, INSN, T)                                           \
+static void NAME(void *out, const void *in, const uint8_t *pred)        \
+{                                                                       \
+    asm volatile("ldr p0, [%2]\n\t"                                     \
+                 "ptrue p1.b\n\t"                                       \
+                 "ld1b {z0.b}, p1/z, [%1]\n\t"                          \
+                 INSN " {z0." T "}, p0, [%0]"                           \
+                 : : "r"(out), "r"(in), "r"(pred)                       \
+                 : "v0", "p0", "p1", "memory");                         \
+}
+
+#define ADD_FN(NAME, T)                                                 \
+static void NAME(void *out, const void *a, const void *b,               \
+                 const uint8_t *pred)                                   \
+{                                                                       \
+    asm volatile("ldr p0, [%3]\n\t"                                     \
+                 "ptrue p1.b\n\t"                                       \
+                 "ld1b {z0.b}, p1/z, [%1]\n\t"                          \
+                 "ld1b {z1.b}, p1/z, [%2]\n\t"                          \
+                 "add z0." T ", p0/m, z0." T ", z1." T "\n\t"           \
+                 "st1b {z0.b}, p1, [%0]"                                \
+                 : : "r"(out), "r"(a), "r"(b), "r"(pred)                \
+                 : "v0", "v1", "p0", "p1", "memory");                   \
+}
+
+LD1_FN(ld1b, "ld1b", "b")
+LD1_FN(ld1h, "ld1h", "h")
+LD1_FN(ld1w, "ld1w", "s")
+LD1_FN(ld1d, "ld1d", "d")
+ST1_FN(st1b, "st1b", "b")
+ST1_FN(st1h, "st1h", "h")
+ST1_FN(st1w, "st1w", "s")
+ST1_FN(st1d, "st1d", "d")
+ADD_FN(add_b, "b")
+ADD_FN(add_h, "h")
+ADD_FN(add_s, "s")
+ADD_FN(add_d, "d")
+
+/* 64-bit elements at @base + @off[i].  */
+static void gather_d(void *out, const void *base, const uint64_t *off,
+                     const uint8_t *pred)
+{
+    asm volatile("ldr p0, [%3]\n\t"
+                 "ptrue p1.d\n\t"
+                 "ld1d {z1.d}, p1/z, [%2]\n\t"
+                 "ld1d {z0.d}, p0/z, [%1, z1.d]\n\t"
+                 "st1d {z0.d}, p1, [%0]"
+                 : : "r"(out), "r"(base), "r"(off), "r"(pred)
+                 : "v0", "v1", "p0", "p1", "memory");
+}
+
+static void scatter_d(void *base, const void *in, const uint64_t *off,
+                      const uint8_t *pred)
+{
+    asm volatile("ldr p0, [%3]\n\t"
+                 "ptrue p1.d\n\t"
+                 "ld1d {z1.d}, p1/z, [%2]\n\t"
+                 "ld1d {z0.d}, p1/z, [%1]\n\t"
+                 "st1d {z0.d}, p0, [%0, z1.d]"
+                 : : "r"(base), "r"(in), "r"(off), "r"(pred)
+                 : "v0", "v1", "p0", "p1", "memory");
+}
+
+enum {
+    PAT_ALL,
+    PAT_NONE,
+    PAT_FIRST_HALF,
+    PAT_EVEN,
+    PAT_LAST,
+    PAT_SPARSE,
+    PAT_MAX,
+};
+
+static const char *pat_names[PAT_MAX] = {
+    "all", "none", "first half", "even", "last", "sparse",
+};
+
+static bool active(int pat, int i, int n)
+{
+    switch (pat) {
+    case PAT_ALL:
+        return true;
+    case PAT_FIRST_HALF:
+        return i < n / 2;
+    case PAT_EVEN:
+        return !(i & 1);
+    case PAT_LAST:
+        return i == n - 1;
+    case PAT_SPARSE:
+        return i % 3 == 1;
+    default:
+        return false;
+    }
+}
+
+/* Predicates have one bit per byte, the lowest for each element counts.  */
+static void set_pred(uint8_t *pred, int pat, int n, int esz)
+{
+    int i;
+
+    memset(pred, 0, MAX_VL / 8);
+    for (i = 0; i < n; i++) {
+        if (active(pat, i, n)) {
+            pred[i * esz / 8] |= 1 << (i * esz % 8);
+        }
+    }
+}
+
+static void check(const char *what, const char *name, int pat,
+                  const char *where, const void *got, const void *exp,
+                  size_t len)
+{
+    if (memcmp(got, exp, len)) {
+        printf("FAIL %s %s, %s predicate, %s\n", what, name,
+               pat_names[pat], where);
+        errors++;
+    }
+}
+
+static const struct {
+    const char *name;
+    void (*ld)(void *, const void *, const uint8_t *);
+    void (*st)(void *, const void *, const uint8_t *);
+    void (*add)(void *, const void *, const void *, const uint8_t *);
+    int esz;
+} ops[] = {
+    { "b", ld1b, st1b, add_b, 1 },
+    { "h", ld1h, st1h, add_h, 2 },
+    { "s", ld1w, st1w, add_s, 4 },
+    { "d", ld1d, st1d, add_d, 8 },
+};
+
+/*
+ * Loads and stores at @mem, which may straddle a page boundary. If
+ * @guarded, only the first half of the vector is mapped, so only the
+ * patterns leaving the second half inactive are run.
+ */
+static void test_contiguous(uint8_t *mem, const char *where, bool guarded)
+{
+    uint8_t pred[MAX_VL / 8], in[MAX_VL], got[MAX_VL], exp[MAX_VL];
+    size_t len = guarded ? vl / 2 : vl;
+    int o, pat, i;
+
+    for (i = 0; i < vl; i++) {
+        in[i] = i * 7 + 3;
+    }
+
+    for (o = 0; o < sizeof(ops) / sizeof(ops[0]); o++) {
+        int esz = ops[o].esz, n = vl / esz;
+
+        for (pat = 0; pat < PAT_MAX; pat++) {
+            if (guarded && pat != PAT_NONE && pat != PAT_FIRST_HALF) {
+                continue;
+            }
+            set_pred(pred, pat, n, esz);
+
+            memcpy(mem, in, len);
+            memset(exp, 0, vl);
+            for (i = 0; i < n; i++) {
+                if (active(pat, i, n)) {
+                    memcpy(exp + i * esz, in + i * esz, esz);
+                }
+            }
+            ops[o].ld(got, mem, pred);
+            check("ld1", ops[o].name, pat, where, got, exp, vl);
+
+            memset(mem, 0xee, len);
+            memset(exp, 0xee, vl);
+            for (i = 0; i < n; i++) {
+                if (active(pat, i, n)) {
+                    memcpy(exp + i * esz, in + i * esz, esz);
+                }
+            }
+            ops[o].st(mem, in, pred);
+            check("st1", ops[o].name, pat, where, mem, exp, len);
+        }
+    }
+}
+
+static void test_add(void)
+{
+    uint8_t pred[MAX_VL / 8], a[MAX_VL], b[MAX_VL], got[MAX_VL], exp[MAX_VL];
+    int o, pat, i, j;
+
+    for (i = 0; i < vl; i++) {
+        a[i] = i * 13 + 1;
+        b[i] = 0xf0 + i;
+    }
+
+    for (o = 0; o < sizeof(ops) / sizeof(ops[0]); o++) {
+        int esz = ops[o].esz, n = vl / esz;
+
+        for (pat = 0; pat < PAT_MAX; pat++) {
+            set_pred(pred, pat, n, esz);
+            memcpy(exp, a, vl);
+            for (i = 0; i < n; i++) {
+                unsigned int carry = 0;
+
+                if (!active(pat, i, n)) {
+                    continue;
+                }
+                /* Little-endian element add, one byte at a time.  */
+                for (j = 0; j < esz; j++) {
+                    unsigned int k = i * esz + j;
+                    unsigned int sum = a[k] + b[k] + carry;
+
+                    exp[k] = sum;
+                    carry = sum >> 8;
+                }
+            }
+            ops[o].add(got, a, b, pred);
+            check("add", ops[o].name, pat, "registers", got, exp, vl);
+        }
+    }
+}
+
+/*
+ * Elements alternate between the end of the page at @mem and the start
+ * of the next one, 16 bytes apart, and the last one straddles the two.
+ * With the "even" pattern the inactive elements point at @guard instead.
+ */
+static void gather_offsets(uint64_t *off, int n, int pat, uint8_t *mem,
+                           uint8_t *guard)
+{
+    int i;
+
+    for (i = 0; i < n; i++) {
+        off[i] = i & 1 ? ps + 16 * i : ps - 16 - 16 * i;
+    }
+    off[n - 1] = ps - 4;
+    if (pat == PAT_EVEN) {
+        for (i = 1; i < n; i += 2) {
+            off[i] = guard - mem + 8 * i;
+        }
+    }
+}
+
+static void test_gather_scatter(uint8_t *mem, uint8_t *guard)
+{
+    uint8_t pred[MAX_VL / 8];
+    uint64_t off[MAX_VL / 8], in[MAX_VL / 8], got[MAX_VL / 8];
+    uint64_t exp[MAX_VL / 8];
+    uint8_t *ref = malloc(2 * ps);
+    int n = vl / 8, pat, i;
+
+    for (i = 0; i < 2 * ps; i++) {
+        mem[i] = i * 5 + (i >> 8);
+    }
+    for (i = 0; i < n; i++) {
+        in[i] = 0x0102030405060708ull * (i + 1);
+    }
+
+    for (pat = 0; pat < PAT_MAX; pat++) {
+        set_pred(pred, pat, n, 8);
+        gather_offsets(off, n, pat, mem, guard);
+
+        for (i = 0; i < n; i++) {
+            exp[i] = 0;
+            if (active(pat, i, n)) {
+                memcpy(&exp[i], mem + off[i], 8);
+            }
+        }
+        gather_d(got, mem, off, pred);
+        check("gather", "d", pat, "across pages", got, exp, vl);
+
+        memcpy(ref, mem, 2 * ps);
+        for (i = 0; i < n; i++) {
+            if (active(pat, i, n)) {
+                memcpy(ref + off[i], &in[i], 8);
+            }
+        }
+        scatter_d(mem, in, off, pred);
+        check("scatter", "d", pat, "across pages", mem, ref, 2 * ps);
+    }
+    free(ref);
+}
+
+int main(void)
+{
+    uint8_t *mem;
+
+    vl = get_vl();
+    ps = getpagesize();
+
+    /* Two pages of RAM followed by a PROT_NONE one.  */
+    mem = mmap(NULL, 3 * ps, PROT_READ | PROT_WRITE,
+               MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED || mprotect(mem + 2 * ps, ps, PROT_NONE)) {
+        perror("mmap");
+        return 1;
+    }
+
+    test_contiguous(mem, "in a page", false);
+    test_contiguous(mem + ps - vl / 2, "across pages", false);
+    test_contiguous(mem + 2 * ps - vl / 2, "before a PROT_NONE page", true);
+    test_add();
+    test_gather_scatter(mem, mem + 2 * ps);
+
+    if (errors) {
+        printf("%d errors\n", errors);
+        return 1;
+    }
+    return 0;
+}
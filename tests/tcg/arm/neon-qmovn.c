@@ -0,0 +1,125 @@
+/*
+ * VQMOVN/VQMOVUN tests
+ *
+ * Runs the saturating narrows for every element size over inputs on
+ * both sides of the limits of the narrow type, and checks the results
+ * and the cumulative saturation flag (FPSCR.QC) against plain C.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define FPSCR_QC (1u << 27)
+
+static int errors;
+
+static uint32_t get_fpscr(void)
+{
+    uint32_t r;
+
+    asm volatile("vmrs %0, fpscr" : "=r"(r));
+    return r;
+}
+
+static void clear_fpscr(void)
+{
+    asm volatile("vmsr fpscr, %0" : : "r"(0));
+}
+
+/* Narrow the Q register at @n into the D register at @d.  */
+#define QMOVN_FN(NAME, INSN)                                            \
+static void NAME(void *d, const void *n)                                \
+{                                                                       \
+    asm volatile("vld1.8 {d2, d3}, [%1]\n\t"                            \
+                 INSN " d0, q1\n\t"                                     \
+                 "vst1.8 {d0}, [%0]"                                    \
+                 : : "r"(d), "r"(n)                                     \
+                 : "d0", "d2", "d3", "memory");                         \
+}
+
+QMOVN_FN(vqmovn_s16, "vqmovn.s16")
+QMOVN_FN(vqmovn_s32, "vqmovn.s32")
+QMOVN_FN(vqmovn_s64, "vqmovn.s64")
+QMOVN_FN(vqmovn_u16, "vqmovn.u16")
+QMOVN_FN(vqmovn_u32, "vqmovn.u32")
+QMOVN_FN(vqmovn_u64, "vqmovn.u64")
+QMOVN_FN(vqmovun_s16, "vqmovun.s16")
+QMOVN_FN(vqmovun_s32, "vqmovun.s32")
+QMOVN_FN(vqmovun_s64, "vqmovun.s64")
+
+/*
+ * TD and TN are the narrow and the wide element types, LO and HI the
+ * limits of the result, NMIN and NMAX those of the input.
+ */
+#define TEST(NAME, TD, TN, LO, HI, NMIN, NMAX)                          \
+static void test_##NAME(void)                                           \
+{                                                                       \
+    static const TN in[] = {                                            \
+        0, 1, (TN)-1, HI, (TN)((TN)HI + 1), LO, (TN)((TN)LO - 1), NMAX, \
+        NMIN, 42, (TN)-42, (TN)-100, 100, 7, (TN)HI - 1, (TN)LO + 1,    \
+    };                                                                  \
+    enum { N = 16 / sizeof(TN) };                                       \
+    int i, j;                                                           \
+                                                                        \
+    for (i = 0; i + N <= sizeof(in) / sizeof(in[0]); i += N) {          \
+        TD got[N], exp[N];                                              \
+        int exp_qc = 0, qc;                                             \
+                                                                        \
+        for (j = 0; j < N; j++) {                                       \
+            TN x = in[i + j];                                           \
+            if (x < LO) {                                               \
+                exp[j] = LO;                                            \
+                exp_qc = 1;                                             \
+            } else if (x > HI) {                                        \
+                exp[j] = HI;                                            \
+                exp_qc = 1;                                             \
+            } else {                                                    \
+                exp[j] = x;                                             \
+            }                                                           \
+        }                                                               \
+                                                                        \
+        clear_fpscr();                                                  \
+        NAME(got, in + i);                                              \
+        qc = !!(get_fpscr() & FPSCR_QC);                                \
+        if (memcmp(got, exp, sizeof(got)) || qc != exp_qc) {            \
+            printf("FAIL %s input %d: qc %d, expected %d%s\n", #NAME,   \
+                   i, qc, exp_qc,                                       \
+                   memcmp(got, exp, sizeof(got)) ? ", wrong result" : "");\
+            errors++;                                                   \
+        }                                                               \
+    }                                                                   \
+}
+
+TEST(vqmovn_s16, int8_t, int16_t, INT8_MIN, INT8_MAX, INT16_MIN, INT16_MAX)
+TEST(vqmovn_s32, int16_t, int32_t, INT16_MIN, INT16_MAX,
+     INT32_MIN, INT32_MAX)
+TEST(vqmovn_s64, int32_t, int64_t, INT32_MIN, INT32_MAX,
+     INT64_MIN, INT64_MAX)
+TEST(vqmovn_u16, uint8_t, uint16_t, 0, UINT8_MAX, 0, UINT16_MAX)
+TEST(vqmovn_u32, uint16_t, uint32_t, 0, UINT16_MAX, 0, UINT32_MAX)
+TEST(vqmovn_u64, uint32_t, uint64_t, 0, UINT32_MAX, 0, UINT64_MAX)
+TEST(vqmovun_s16, uint8_t, int16_t, 0, UINT8_MAX, INT16_MIN, INT16_MAX)
+TEST(vqmovun_s32, uint16_t, int32_t, 0, UINT16_MAX, INT32_MIN, INT32_MAX)
+TEST(vqmovun_s64, uint32_t, int64_t, 0, UINT32_MAX, INT64_MIN, INT64_MAX)
+
+int main(void)
+{
+    test_vqmovn_s16();
+    test_vqmovn_s32();
+    test_vqmovn_s64();
+    test_vqmovn_u16();
+    test_vqmovn_u32();
+    test_vqmovn_u64();
+    test_vqmovun_s16();
+    test_vqmovun_s32();
+    test_vqmovun_s64();
+
+    if (errors) {
+        printf("%d errors\n", errors);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,29 @@
+/*
+ * TCG benchmark kernels - AArch64 virt machine
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef BENCH_ARCH_H
+#define BENCH_ARCH_H
+
+static inline uint64_t bench_ticks(void)
+{
+    uint64_t t;
+
+    asm volatile("isb; mrs %0, cntvct_el0" : "=r"(t));
+    return t;
+}
+
+static inline uint64_t bench_freq(void)
+{
+    uint64_t f;
+
+    asm volatile("mrs %0, cntfrq_el0" : "=r"(f));
+    return f;
+}
+
+/* PL011 flag register.  */
+#define BENCH_MMIO_REG ((volatile uint32_t *)0x09000018)
+
+#endif
@@ -0,0 +1,29 @@
+/*
+ * TCG benchmark kernels - ARM virt machine
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef BENCH_ARCH_H
+#define BENCH_ARCH_H
+
+static inline uint64_t bench_ticks(void)
+{
+    uint64_t t;
+
+    asm volatile("isb; mrrc p15, 1, %Q0, %R0, c14" : "=r"(t));
+    return t;
+}
+
+static inline uint64_t bench_freq(void)
+{
+    uint32_t f;
+
+    asm volatile("mrc p15, 0, %0, c14, c0, 0" : "=r"(f));
+    return f;
+}
+
+/* PL011 flag register.  */
+#define BENCH_MMIO_REG ((volatile uint32_t *)0x09000018)
+
+#endif
@@ -0,0 +1,290 @@
+#!/usr/bin/env python3
+#
+# Run the TCG benchmark kernels and report their timings
+#
+# Each kernel binary runs several times under qemu-system.  The guest
+# times its kernels with its own counter, which under TCG without
+# icount follows the host clock, so the figures leave out the startup
+# of QEMU.  The guest prints lines such as:
+#
+#   bench: int-loop iters=40000000 ticks=31250000 freq=62500000
+#   bench: exit 0
+#
+# The median of the runs is reported, with the spread between the
+# fastest and the slowest run as a measure of how stable it is.  With
+# --insn-plugin two more runs count the guest instructions of the
+# binary and of its "-baseline" build, which skips the timed calls: the
+# difference gives MIPS figures for the timed calls alone.  Guests that
+# cannot exit keep running after their exit line and get no MIPS.
+# --json writes everything out for tracking over time.
+#
+# SPDX-License-Identifier: GPL-2.0-or-later
+
+import argparse
+import fcntl
+import json
+import os
+import platform
+import re
+import shlex
+import statistics
+import subprocess
+import sys
+import time
+from tempfile import TemporaryDirectory
+
+RESULT_RE = re.compile(r"^bench: (\S+) iters=(\d+) ticks=(\d+) freq=(\d+)$")
+EXIT_RE = re.compile(r"^bench: exit (\d+)$")
+FAIL_RE = re.compile(r"^bench: FAIL (.*)$")
+INSNS_RE = re.compile(r"^insns: (\d+)$", re.M)
+
+# Runs further apart than this are flagged as unstable
+SPREAD_WARN = 0.05
+
+
+def get_args():
+    parser = argparse.ArgumentParser(description="TCG benchmark runner")
+    parser.add_argument("--qemu", help="QEMU system emulator",
+                        required=True)
+    parser.add_argument("--qemu-args", default="",
+                        help="QEMU arguments, the binary is appended")
+    parser.add_argument("--target", default="",
+                        help="Target name to record in the results")
+    parser.add_argument("--repeat", type=int, default=5,
+                        help="Runs of each binary (default: %(default)s)")
+    parser.add_argument("--timeout", type=float, default=120,
+                        help="Seconds allowed per run (default: %(default)s)")
+    parser.add_argument("--insn-plugin",
+                        help="Path to libinsn.so, to count instructions")
+    parser.add_argument("--json", help="Write the results to this file")
+    parser.add_argument("--lock",
+                        help="Lock file, so parallel runs do not overlap")
+    parser.add_argument("binaries", nargs="+", help="Benchmark binaries")
+
+    return parser.parse_args()
+
+
+class BenchError(Exception):
+    pass
+
+
+def read_file(path):
+    try:
+        with open(path, errors="replace") as f:
+            return f.read()
+    except FileNotFoundError:
+        return ""
+
+
+def run_guest(args, binary, tmpdir, extra=()):
+    """
+    Run @binary once and return its console output, the wall clock time
+    it took and whether it had to be stopped.  Guests without
+    semihosting cannot exit QEMU, they spin after their exit line and
+    are stopped here.
+    """
+    out = os.path.join(tmpdir, "console.out")
+    if os.path.exists(out):
+        os.unlink(out)
+    cmd = [args.qemu, "-monitor", "none", "-display", "none",
+           "-chardev", "file,path=%s,id=output" % out]
+    cmd += list(extra) + shlex.split(args.qemu_args) + [binary]
+
+    start = time.monotonic()
+    end = None
+    stopped = False
+    proc = subprocess.Popen(cmd, stdin=subprocess.DEVNULL)
+    try:
+        while True:
+            try:
+                proc.wait(timeout=0.05)
+                break
+            except subprocess.TimeoutExpired:
+                pass
+            now = time.monotonic()
+            if now - start > args.timeout:
+                raise BenchError("%s: timed out after %ds" %
+                                 (os.path.basename(binary), args.timeout))
+            if end is None:
+                if EXIT_RE.search(read_file(out).rstrip("\n")
+                                  .rpartition("\n")[2]):
+                    end = now
+            elif now - end > 0.5:
+                proc.terminate()
+                proc.wait()
+                stopped = True
+                break
+    finally:
+        if proc.poll() is None:
+            proc.kill()
+            proc.wait()
+
+    wall = (end or time.monotonic()) - start
+    output = read_file(out)
+    if end is None and proc.returncode != 0:
+        raise BenchError("%s: QEMU exited with status %d" %
+                         (os.path.basename(binary), proc.returncode))
+    return output, wall, stopped
+
+
+def parse_output(binary, output):
+    """Return the kernels reported in @output as {name: (iters, secs)}."""
+    kernels = {}
+    status = None
+
+    for line in output.splitlines():
+        m = RESULT_RE.match(line)
+        if m:
+            iters, ticks, freq = (int(x) for x in m.groups()[1:])
+            kernels[m.group(1)] = (iters, ticks / freq)
+            continue
+        m = FAIL_RE.match(line)
+        if m:
+            raise BenchError("%s: %s" % (binary, m.group(1)))
+        m = EXIT_RE.match(line)
+        if m:
+            status = int(m.group(1))
+
+    if status is None:
+        raise BenchError("%s: no exit line in output" % binary)
+    if status != 0 or not kernels:
+        raise BenchError("%s: failed with status %d" % (binary, status))
+    return kernels
+
+
+def count_insns(args, path, tmpdir):
+    """
+    Count the instructions @path runs, or return None if it cannot be
+    told: the binary is missing or kept running after its exit line.
+    """
+    if not os.path.exists(path):
+        return None
+    log = os.path.join(tmpdir, "plugin.log")
+    if os.path.exists(log):
+        os.unlink(log)
+    _, _, stopped = run_guest(args, path, tmpdir,
+                              ["-plugin", args.insn_plugin + ",inline=on",
+                               "-d", "plugin", "-D", log])
+    m = INSNS_RE.search(read_file(log))
+    if stopped or not m:
+        return None
+    return int(m.group(1))
+
+
+def bench_binary(args, path, tmpdir):
+    binary = os.path.basename(path)
+    runs = []
+    walls = []
+
+    for _ in range(args.repeat):
+        output, wall, _ = run_guest(args, path, tmpdir)
+        runs.append(parse_output(binary, output))
+        walls.append(wall)
+
+    result = {
+        "binary": binary,
+        "wall_seconds": statistics.median(walls),
+        "kernels": [],
+    }
+    for name, (iters, _) in runs[0].items():
+        secs = [r[name][1] for r in runs if name in r]
+        median = statistics.median(secs)
+        result["kernels"].append({
+            "name": name,
+            "iters": iters,
+            "seconds": median,
+            "min_seconds": min(secs),
+            "max_seconds": max(secs),
+            "spread": (max(secs) - min(secs)) / median if median else 0,
+            "ns_per_iter": median * 1e9 / iters,
+        })
+
+    # Only the timed calls: setup and warm-up run in the baseline too
+    if args.insn_plugin:
+        base = count_insns(args, path + "-baseline", tmpdir)
+        insns = count_insns(args, path, tmpdir) if base is not None else None
+        if insns is not None:
+            insns = max(insns - base, 0)
+            secs = sum(k["seconds"] for k in result["kernels"])
+            result["guest_insns"] = insns
+            result["mips"] = insns / secs / 1e6 if secs else 0
+
+    return result
+
+
+def derive(results):
+    """Figures that combine several kernels."""
+    kernels = {k["name"]: k for r in results for k in r["kernels"]}
+    derived = {}
+
+    if "tb-xlate" in kernels and "tb-exec" in kernels:
+        derived["tb_translate_ns"] = (kernels["tb-xlate"]["ns_per_iter"] -
+                                      kernels["tb-exec"]["ns_per_iter"])
+    return derived
+
+
+def report(args, results, derived):
+    print("%s, median of %d runs" % (args.target or args.qemu, args.repeat))
+    print("  %-12s %12s %10s %10s %7s %8s" %
+          ("kernel", "iters", "ms", "ns/iter", "spread", "MIPS"))
+    for r in results:
+        mips = "%8.1f" % r["mips"] if "mips" in r else "%8s" % "-"
+        for k in r["kernels"]:
+            print("  %-12s %12d %10.2f %10.2f %6.1f%%%s %s" %
+                  (k["name"], k["iters"], k["seconds"] * 1e3,
+                   k["ns_per_iter"], k["spread"] * 100,
+                   "!" if k["spread"] > SPREAD_WARN else " ", mips))
+    for name, value in derived.items():
+        print("  %s: %.1f" % (name, value))
+
+
+def qemu_version(qemu):
+    try:
+        out = subprocess.run([qemu, "--version"], stdout=subprocess.PIPE,
+                             universal_newlines=True, check=True).stdout
+        return out.splitlines()[0]
+    except (OSError, subprocess.CalledProcessError, IndexError):
+        return None
+
+
+def main():
+    args = get_args()
+
+    if args.lock:
+        lock = open(args.lock, "w")
+        fcntl.flock(lock, fcntl.LOCK_EX)
+
+    results = []
+    failed = False
+    with TemporaryDirectory() as tmpdir:
+        for path in args.binaries:
+            try:
+                results.append(bench_binary(args, path, tmpdir))
+            except BenchError as e:
+                print("FAIL %s" % e, file=sys.stderr)
+                failed = True
+
+    derived = derive(results)
+    report(args, results, derived)
+
+    if args.json:
+        data = {
+            "target": args.target,
+            "qemu": args.qemu,
+            "qemu_version": qemu_version(args.qemu),
+            "qemu_args": args.qemu_args,
+            "host": platform.machine(),
+            "date": time.strftime("%Y-%m-%dT%H:%M:%SZ", time.gmtime()),
+            "repeat": args.repeat,
+            "results": results,
+            "derived": derived,
+        }
+        with open(args.json, "w") as f:
+            json.dump(data, f, indent=2)
+            f.write("\n")
+
+    return 1 if failed else 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,52 @@
+/*
+ * TCG benchmark kernels - common guest code
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "bench.h"
+
+static int failed;
+
+/*
+ * The -baseline build of each benchmark skips the timed calls and does
+ * everything else, so that bench-tcg.py can take its instruction count
+ * off that of the full build.
+ */
+#ifdef BENCH_BASELINE
+#define bench_timed(fn, iters) 0
+#else
+#define bench_timed(fn, iters) fn(iters)
+#endif
+
+uint64_t bench_run(const char *name, uint64_t (*fn)(uint64_t),
+                   uint64_t iters, uint64_t warmup)
+{
+    uint64_t start, end, ret;
+
+    if (warmup) {
+        bench_keep(fn(warmup));
+    }
+
+    start = bench_ticks();
+    ret = bench_timed(fn, iters);
+    end = bench_ticks();
+
+    ml_printf("bench: %s iters=%llu ticks=%llu freq=%llu\n", name,
+              (unsigned long long)iters,
+              (unsigned long long)((end - start) & BENCH_TICKS_MASK),
+              (unsigned long long)bench_freq());
+    return ret;
+}
+
+void bench_fail(const char *name, const char *why)
+{
+    ml_printf("bench: FAIL %s: %s\n", name, why);
+    failed = 1;
+}
+
+int bench_exit(void)
+{
+    ml_printf("bench: exit %d\n", failed);
+    return failed;
+}
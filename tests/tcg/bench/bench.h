@@ -0,0 +1,51 @@
+/*
+ * TCG benchmark kernels - common guest interface
+ *
+ * Each benchmark is a bare metal program that times one or more
+ * kernels with a guest counter and reports them on the console, in the
+ * format parsed by bench-tcg.py:
+ *
+ *   bench: <name> iters=<n> ticks=<t> freq=<hz>
+ *   bench: exit <status>
+ *
+ * The per-architecture bench-arch.h provides the counter, its
+ * frequency and a device register for the MMIO polling kernel.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <minilib.h>
+#include "bench-arch.h"
+
+#ifndef BENCH_TICKS_MASK
+#define BENCH_TICKS_MASK UINT64_MAX
+#endif
+
+/*
+ * Keep the compiler from dropping a value it thinks is unused, or from
+ * folding a value it could otherwise compute at build time.
+ */
+#define bench_keep(x) asm volatile("" : : "r"(x) : "memory")
+#define bench_hide(x) asm volatile("" : "+r"(x))
+
+/*
+ * Call @fn(@iters) and report the guest ticks it took.  If @warmup is
+ * not zero, @fn(@warmup) is called first so that the translation of
+ * the kernel is not part of the measurement.  Returns what the timed
+ * call returned.
+ */
+uint64_t bench_run(const char *name, uint64_t (*fn)(uint64_t),
+                   uint64_t iters, uint64_t warmup);
+
+/* Record a failed result check for kernel @name.  */
+void bench_fail(const char *name, const char *why);
+
+/* Report the exit status, and return it for main() to pass on.  */
+int bench_exit(void);
+
+#endif /* BENCH_H */
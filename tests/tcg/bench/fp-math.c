@@ -0,0 +1,34 @@
+/*
+ * Floating point benchmark
+ *
+ * Single precision multiply, add, divide and conversions.  These are
+ * implemented by softfloat helpers, so this mostly measures the cost
+ * of a helper call from translated code.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "bench.h"
+
+static uint64_t fp_math(uint64_t n)
+{
+    float a = 1.0f, b = 0.5f, c = 3.0f;
+    uint64_t i;
+    unsigned acc = 0;
+
+    for (i = 0; i < n; i++) {
+        /* All of these converge to normal numbers below 2000.  */
+        a = a * 0.5f + b;
+        b = b / 1.0003f + 0.25f;
+        c = c * 0.5f + a / b;
+        acc += (unsigned)(c * 16.0f);
+    }
+    bench_keep(acc);
+    return (uint64_t)a;
+}
+
+int main(void)
+{
+    bench_run("fp-math", fp_math, 10000000, 1000);
+    return bench_exit();
+}
@@ -0,0 +1,36 @@
+/*
+ * Integer loop benchmark
+ *
+ * Arithmetic, shifts, a multiply and a data dependent branch per
+ * iteration: code that stays in translated blocks chained to each
+ * other, with no memory accesses or helper calls.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "bench.h"
+
+static uint64_t int_loop(uint64_t n)
+{
+    unsigned long x = 1, y = 0;
+    uint64_t i;
+
+    for (i = 0; i < n; i++) {
+        x ^= x << 7;
+        x ^= x >> 9;
+        x = x * 69069 + 1;
+        if (x & 0x10) {
+            y += x >> 3;
+        } else {
+            y -= x;
+        }
+        bench_hide(x);
+    }
+    return x + y;
+}
+
+int main(void)
+{
+    bench_run("int-loop", int_loop, 40000000, 1000);
+    return bench_exit();
+}
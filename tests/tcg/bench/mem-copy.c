@@ -0,0 +1,54 @@
+/*
+ * Memory copy benchmark
+ *
+ * Copies a buffer small enough for its pages to stay in the softmmu
+ * TLB, one word at a time, so that each iteration is a load and a
+ * store through the fast path of the softmmu.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "bench.h"
+
+#define BUF_WORDS (256 * 1024 / sizeof(unsigned long))
+
+static unsigned long src[BUF_WORDS], dst[BUF_WORDS];
+
+/* Copy @n words, @n being a multiple of the buffer size.  */
+static uint64_t mem_copy(uint64_t n)
+{
+    uint64_t done;
+    size_t i;
+
+    for (done = 0; done < n; done += BUF_WORDS) {
+        unsigned long *d = dst, *s = src;
+
+        bench_hide(d);
+        for (i = 0; i < BUF_WORDS; i += 4) {
+            d[i] = s[i];
+            d[i + 1] = s[i + 1];
+            d[i + 2] = s[i + 2];
+            d[i + 3] = s[i + 3];
+        }
+    }
+    return dst[BUF_WORDS - 1];
+}
+
+int main(void)
+{
+    size_t i;
+
+    for (i = 0; i < BUF_WORDS; i++) {
+        src[i] = i * 2654435761u;
+    }
+
+    bench_run("mem-copy", mem_copy, BUF_WORDS * 256, BUF_WORDS);
+
+    for (i = 0; i < BUF_WORDS; i++) {
+        if (dst[i] != src[i]) {
+            bench_fail("mem-copy", "copy mismatch");
+            break;
+        }
+    }
+    return bench_exit();
+}
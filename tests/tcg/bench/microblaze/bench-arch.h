@@ -0,0 +1,26 @@
+/*
+ * TCG benchmark kernels - MicroBlaze petalogix-s3adsp1800 machine
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef BENCH_ARCH_H
+#define BENCH_ARCH_H
+
+/* XPS timer counter 0, started by boot.S, wraps after about a minute.  */
+#define BENCH_TICKS_MASK UINT32_MAX
+
+static inline uint64_t bench_ticks(void)
+{
+    return *(volatile uint32_t *)0x83c00008;
+}
+
+static inline uint64_t bench_freq(void)
+{
+    return 62000000;
+}
+
+/* UART Lite status register.  */
+#define BENCH_MMIO_REG ((volatile uint32_t *)0x84000008)
+
+#endif
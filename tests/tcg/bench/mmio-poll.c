@@ -0,0 +1,28 @@
+/*
+ * MMIO polling benchmark
+ *
+ * Reads a device status register in a loop, as a driver polling for
+ * completion would.  Each read leaves translated code for the device
+ * model, so this measures the softmmu I/O path.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "bench.h"
+
+static uint64_t mmio_poll(uint64_t n)
+{
+    unsigned long acc = 0;
+    uint64_t i;
+
+    for (i = 0; i < n; i++) {
+        acc += *BENCH_MMIO_REG;
+    }
+    return acc;
+}
+
+int main(void)
+{
+    bench_run("mmio-poll", mmio_poll, 2000000, 1000);
+    return bench_exit();
+}
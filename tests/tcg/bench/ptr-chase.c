@@ -0,0 +1,50 @@
+/*
+ * Pointer chasing benchmark
+ *
+ * Follows a chain of nodes spread over more pages than the softmmu TLB
+ * holds, each step landing on a different page.  Every load depends on
+ * the previous one, so this measures the cost of a TLB miss: the page
+ * table walk and refill of the softmmu slow path.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "bench.h"
+
+#define NODE_SIZE   64
+#define NR_NODES    (32 * 1024 * 1024 / NODE_SIZE)
+/* Odd, so that the chain visits every node, and more than a page.  */
+#define STRIDE      (NR_NODES / 2 + 4096 / NODE_SIZE + 1)
+
+typedef union Node {
+    union Node *next;
+    char pad[NODE_SIZE];
+} Node;
+
+static Node nodes[NR_NODES];
+
+static uint64_t ptr_chase(uint64_t n)
+{
+    Node *p = &nodes[0];
+    uint64_t i;
+
+    for (i = 0; i < n; i++) {
+        p = p->next;
+    }
+    return p - nodes;
+}
+
+int main(void)
+{
+    size_t i;
+
+    for (i = 0; i < NR_NODES; i++) {
+        nodes[i].next = &nodes[(i + STRIDE) % NR_NODES];
+    }
+
+    /* A full lap ends where it started.  */
+    if (bench_run("ptr-chase", ptr_chase, NR_NODES * 16ull, 1000) != 0) {
+        bench_fail("ptr-chase", "chain is broken");
+    }
+    return bench_exit();
+}
@@ -0,0 +1,27 @@
+/*
+ * TCG benchmark kernels - RISC-V virt machine
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#ifndef BENCH_ARCH_H
+#define BENCH_ARCH_H
+
+static inline uint64_t bench_ticks(void)
+{
+    uint64_t t;
+
+    asm volatile("rdtime %0" : "=r"(t));
+    return t;
+}
+
+/* The ACLINT timebase of the virt machine.  */
+static inline uint64_t bench_freq(void)
+{
+    return 10000000;
+}
+
+/* 16550 line status register.  */
+#define BENCH_MMIO_REG ((volatile uint8_t *)0x10000005)
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * Translation benchmark
+ *
+ * Calls 8192 distinct small functions once each, so that nearly all of
+ * the time goes into translating them, then calls them all again now
+ * that they are in the code cache.  The difference between the two is
+ * the cost of translating a block of a handful of instructions.
+ *
+ * SPDX-License-Identifier: GPL-2.0-or-later
+ */
+
+#include "bench.h"
+
+#define FN(h)                                                           \
+    static unsigned long __attribute__((noinline)) f_##h(unsigned long x) \
+    {                                                                   \
+        x ^= x >> 7;                                                    \
+        x *= 0x9e3779b9ul + 0x##h;                                      \
+        return x + 0x##h;                                               \
+    }
+#define PTR(h) f_##h,
+
+#define X16(M, p)                                                       \
+    M(p##0) M(p##1) M(p##2) M(p##3) M(p##4) M(p##5) M(p##6) M(p##7)     \
+    M(p##8) M(p##9) M(p##a) M(p##b) M(p##c) M(p##d) M(p##e) M(p##f)
+#define X256(M, p)                                                      \
+    X16(M, p##0) X16(M, p##1) X16(M, p##2) X16(M, p##3)                 \
+    X16(M, p##4) X16(M, p##5) X16(M, p##6) X16(M, p##7)                 \
+    X16(M, p##8) X16(M, p##9) X16(M, p##a) X16(M, p##b)                 \
+    X16(M, p##c) X16(M, p##d) X16(M, p##e) X16(M, p##f)
+#define X4096(M, p)                                                     \
+    X256(M, p##0) X256(M, p##1) X256(M, p##2) X256(M, p##3)             \
+    X256(M, p##4) X256(M, p##5) X256(M, p##6) X256(M, p##7)             \
+    X256(M, p##8) X256(M, p##9) X256(M, p##a) X256(M, p##b)             \
+    X256(M, p##c) X256(M, p##d) X256(M, p##e) X256(M, p##f)
+
+X4096(FN, 0)
+X4096(FN, 1)
+
+static unsigned long (* const funcs[])(unsigned long) = {
+    X4096(PTR, 0)
+    X4096(PTR, 1)
+};
+
+#define NR_FUNCS (sizeof(funcs) / sizeof(funcs[0]))
+
+static uint64_t call_all(uint64_t n)
+{
+    unsigned long x = 1;
+    uint64_t i;
+
+    for (i = 0; i < n; i++) {
+        x = funcs[i](x);
+    }
+    return x;
+}
+
+int main(void)
+{
+    /* No warm up, the first run is the one that translates.  */
+    bench_run("tb-xlate", call_all, NR_FUNCS, 0);
+    bench_run("tb-exec", call_all, NR_FUNCS, 0);
+    return bench_exit();
+}
@@ -0,0 +1,225 @@
+/*
+ * AES-GCM library tests
+ *
+ * Runs the NIST vectors of the PolarSSL self test through both the one
+ * shot and the streaming interfaces, and checks long messages against a
+ * byte at a time reference, for each host acceleration level.
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or
+ * (at your option) any later version.  See the COPYING file in the
+ * top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "qemu/bswap.h"
+#include "qemu/gcm.h"
+
+typedef struct GCMVector {
+    const char *key;
+    const char *iv;
+    const char *aad;
+    const char *pt;
+    const char *ct;
+    const char *tag;
+} GCMVector;
+
+/* Test cases 3, 4 and 16 of the GCM specification.  */
+static const GCMVector vectors[] = {
+    {
+        .key = "feffe9928665731c6d6a8f9467308308",
+        .iv = "cafebabefacedbaddecaf888",
+        .aad = "",
+        .pt = "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d"
+              "8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657"
+              "ba637b391aafd255",
+        .ct = "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e23"
+              "29aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac97"
+              "3d58e091473f5985",
+        .tag = "4d5c2af327cd64a62cf35abd2ba6fab4",
+    }, {
+        .key = "feffe9928665731c6d6a8f9467308308",
+        .iv = "cafebabefacedbaddecaf888",
+        .aad = "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+        .pt = "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d"
+              "8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657"
+              "ba637b39",
+        .ct = "42831ec2217774244b7221b784d0d49ce3aa212f2c02a4e035c17e23"
+              "29aca12e21d514b25466931c7d8f6a5aac84aa051ba30b396a0aac97"
+              "3d58e091",
+        .tag = "5bc94fbc3221a5db94fae95ae7121a47",
+    }, {
+        .key = "feffe9928665731c6d6a8f9467308308"
+               "feffe9928665731c6d6a8f9467308308",
+        .iv = "cafebabefacedbaddecaf888",
+        .aad = "feedfacedeadbeeffeedfacedeadbeefabaddad2",
+        .pt = "d9313225f88406e5a55909c5aff5269a86a7a9531534f7da2e4c303d"
+              "8a318a721c3c0c95956809532fcf0e2449a6b525b16aedf5aa0de657"
+              "ba637b39",
+        .ct = "522dc1f099567d07f47f37a32a84427d643a8cdcbfe5c0c97598a2bd"
+              "2555d1aa8cb08e48590dbb3da7b08b1056828838c5f61e6393ba7a0a"
+              "bcc9f662",
+        .tag = "76fc6ece0f4e1768cddf8853bb2d551b",
+    },
+};
+
+static uint8_t *unhex(const char *hex, size_t *len)
+{
+    size_t i, n = strlen(hex) / 2;
+    uint8_t *buf = g_malloc0(n + 1);
+
+    for (i = 0; i < n; i++) {
+        buf[i] = g_ascii_xdigit_value(hex[2 * i]) << 4 |
+                 g_ascii_xdigit_value(hex[2 * i + 1]);
+    }
+    *len = n;
+    return buf;
+}
+
+/* Stream @len bytes through gcm_push_data in chunks of @chunk bytes.  */
+static void gcm_stream(gcm_context *ctx, int mode, uint8_t *out,
+                       const uint8_t *in, size_t len, size_t chunk)
+{
+    size_t pos, n;
+
+    for (pos = 0; pos < len; pos += n) {
+        n = MIN(chunk, len - pos);
+        gcm_push_data(ctx, mode, out + pos, in + pos, n);
+    }
+}
+
+static void test_vectors(void)
+{
+    static const size_t chunks[] = { 1, 3, 16, 17, 48, 4096 };
+    int i, j;
+
+    for (i = 0; i < ARRAY_SIZE(vectors); i++) {
+        const GCMVector *v = &vectors[i];
+        size_t key_len, iv_len, aad_len, pt_len, ct_len, tag_len;
+        g_autofree uint8_t *key = unhex(v->key, &key_len);
+        g_autofree uint8_t *iv = unhex(v->iv, &iv_len);
+        g_autofree uint8_t *aad = unhex(v->aad, &aad_len);
+        g_autofree uint8_t *pt = unhex(v->pt, &pt_len);
+        g_autofree uint8_t *ct = unhex(v->ct, &ct_len);
+        g_autofree uint8_t *tag = unhex(v->tag, &tag_len);
+        g_autofree uint8_t *buf = g_malloc(pt_len + 1);
+        uint8_t out_tag[16];
+        gcm_context ctx;
+
+        gcm_init(&ctx, key, key_len * 8);
+        g_assert_cmpint(gcm_crypt_and_tag(&ctx, GCM_ENCRYPT, pt_len,
+                                          iv, iv_len, aad, aad_len,
+                                          pt, buf, tag_len, out_tag), ==, 0);
+        g_assert_cmpmem(buf, pt_len, ct, ct_len);
+        g_assert_cmpmem(out_tag, tag_len, tag, tag_len);
+
+        gcm_init(&ctx, key, key_len * 8);
+        g_assert_cmpint(gcm_auth_decrypt(&ctx, ct_len, iv, iv_len,
+                                         aad, aad_len, tag, tag_len,
+                                         ct, buf), ==, 0);
+        g_assert_cmpmem(buf, ct_len, pt, pt_len);
+
+        for (j = 0; j < ARRAY_SIZE(chunks); j++) {
+            gcm_init(&ctx, key, key_len * 8);
+            gcm_push_iv(&ctx, iv, iv_len, tag_len);
+            gcm_push_aad(&ctx, aad, aad_len);
+            gcm_stream(&ctx, GCM_ENCRYPT, buf, pt, pt_len, chunks[j]);
+            gcm_emit_tag(&ctx, out_tag, tag_len);
+            g_assert_cmpmem(buf, pt_len, ct, ct_len);
+            g_assert_cmpmem(out_tag, tag_len, tag, tag_len);
+
+            gcm_init(&ctx, key, key_len * 8);
+            gcm_push_iv(&ctx, iv, iv_len, tag_len);
+            gcm_push_aad(&ctx, aad, aad_len);
+            gcm_stream(&ctx, GCM_DECRYPT, buf, ct, ct_len, chunks[j]);
+            gcm_emit_tag(&ctx, out_tag, tag_len);
+            g_assert_cmpmem(buf, ct_len, pt, pt_len);
+            g_assert_cmpmem(out_tag, tag_len, tag, tag_len);
+        }
+    }
+}
+
+/*
+ * Set up @ctx like gcm_push_iv and gcm_push_aad would, but with the
+ * 32-bit block counter three blocks away from wrapping around.
+ */
+static void gcm_start_near_wrap(gcm_context *ctx, const uint8_t *key,
+                                unsigned int key_bits, const uint8_t *iv,
+                                const uint8_t *aad, size_t aad_len)
+{
+    gcm_init(ctx, key, key_bits);
+    gcm_push_iv(ctx, iv, 12, 16);
+    stl_be_p(ctx->iv + 12, 0xfffffffd);
+    gcm_push_aad(ctx, aad, aad_len);
+}
+
+/*
+ * Messages long enough for the bulk paths, compared with single byte
+ * pushes and an AAD shorter than a block, which only use the C code.
+ * All but the shortest message make the block counter wrap around.
+ */
+static void test_long(void)
+{
+    static const unsigned int key_bits[] = { 128, 192, 256 };
+    static const size_t lens[] = { 16, 127, 128, 129, 1000, 4096 + 5 };
+    static const size_t chunks[] = { 7, 16, 64, 512, 8192 };
+    uint8_t key[32], iv[12], aad[13];
+    uint8_t pt[8192], ref[8192], buf[8192];
+    uint8_t ref_tag[16], out_tag[16];
+    int i, j, k;
+
+    for (i = 0; i < sizeof(key); i++) {
+        key[i] = i * 7 + 1;
+    }
+    for (i = 0; i < sizeof(iv); i++) {
+        iv[i] = 0x5a + i;
+    }
+    for (i = 0; i < sizeof(aad); i++) {
+        aad[i] = i;
+    }
+    for (i = 0; i < sizeof(pt); i++) {
+        pt[i] = i * 13 + (i >> 8);
+    }
+
+    for (i = 0; i < ARRAY_SIZE(key_bits); i++) {
+        for (j = 0; j < ARRAY_SIZE(lens); j++) {
+            size_t len = lens[j];
+            gcm_context ctx;
+
+            gcm_start_near_wrap(&ctx, key, key_bits[i], iv, aad, sizeof(aad));
+            gcm_stream(&ctx, GCM_ENCRYPT, ref, pt, len, 1);
+            gcm_emit_tag(&ctx, ref_tag, 16);
+
+            for (k = 0; k < ARRAY_SIZE(chunks); k++) {
+                gcm_start_near_wrap(&ctx, key, key_bits[i], iv,
+                                    aad, sizeof(aad));
+                gcm_stream(&ctx, GCM_ENCRYPT, buf, pt, len, chunks[k]);
+                gcm_emit_tag(&ctx, out_tag, 16);
+                g_assert_cmpmem(buf, len, ref, len);
+                g_assert_cmpmem(out_tag, 16, ref_tag, 16);
+
+                gcm_start_near_wrap(&ctx, key, key_bits[i], iv,
+                                    aad, sizeof(aad));
+                gcm_stream(&ctx, GCM_DECRYPT, buf, ref, len, chunks[k]);
+                gcm_emit_tag(&ctx, out_tag, 16);
+                g_assert_cmpmem(buf, len, pt, len);
+                g_assert_cmpmem(out_tag, 16, ref_tag, 16);
+            }
+        }
+    }
+}
+
+static void test_gcm(void)
+{
+    do {
+        test_vectors();
+        test_long();
+    } while (gcm_test_next_accel());
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/gcm/accel", test_gcm);
+
+    return g_test_run();
+}
@@ -0,0 +1,156 @@
+/*
+ * Remote-port byte-enable and streaming run splitting
+ *
+ * This work is licensed under the terms of the GNU GPL, version 2 or later.
+ * See the COPYING file in the top-level directory.
+ */
+
+#include "qemu/osdep.h"
+#include "hw/remote-port-proto.h"
+
+#define MEM_SIZE 256
+
+/* The original one-byte-at-a-time write path.  */
+static void write_bytewise(uint8_t *mem, const uint8_t *data, uint32_t len,
+                           uint32_t sw, const uint8_t *be, uint32_t be_len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        if (be && !be[i % be_len]) {
+            continue;
+        }
+        mem[i % sw] = data[i];
+    }
+}
+
+static void read_bytewise(const uint8_t *mem, uint8_t *data, uint32_t len,
+                          uint32_t sw, const uint8_t *be, uint32_t be_len)
+{
+    uint32_t i;
+
+    for (i = 0; i < len; i++) {
+        if (be && !be[i % be_len]) {
+            continue;
+        }
+        data[i] = mem[i % sw];
+    }
+}
+
+static unsigned write_runs(uint8_t *mem, const uint8_t *data, uint32_t len,
+                           uint32_t sw, const uint8_t *be, uint32_t be_len)
+{
+    uint32_t pos = 0;
+    uint32_t run;
+    unsigned n = 0;
+
+    while ((run = rp_busaccess_next_run(&pos, len, sw, be, be_len))) {
+        g_assert_cmpuint(pos % sw + run, <=, sw);
+        memcpy(mem + pos % sw, data + pos, run);
+        pos += run;
+        n++;
+    }
+    return n;
+}
+
+static void read_runs(const uint8_t *mem, uint8_t *data, uint32_t len,
+                      uint32_t sw, const uint8_t *be, uint32_t be_len)
+{
+    uint32_t pos = 0;
+    uint32_t run;
+
+    while ((run = rp_busaccess_next_run(&pos, len, sw, be, be_len))) {
+        memcpy(data + pos, mem + pos % sw, run);
+        pos += run;
+    }
+}
+
+static void check_one(uint32_t len, uint32_t sw, const uint8_t *be,
+                      uint32_t be_len)
+{
+    uint8_t data[MEM_SIZE], mem_ref[MEM_SIZE], mem_new[MEM_SIZE];
+    uint8_t rd_ref[MEM_SIZE], rd_new[MEM_SIZE];
+    uint32_t i;
+
+    for (i = 0; i < MEM_SIZE; i++) {
+        data[i] = g_test_rand_int();
+        mem_ref[i] = mem_new[i] = rd_ref[i] = rd_new[i] = ~i;
+    }
+
+    write_bytewise(mem_ref, data, len, sw, be, be_len);
+    write_runs(mem_new, data, len, sw, be, be_len);
+    g_assert(memcmp(mem_ref, mem_new, MEM_SIZE) == 0);
+
+    read_bytewise(mem_ref, rd_ref, len, sw, be, be_len);
+    read_runs(mem_ref, rd_new, len, sw, be, be_len);
+    g_assert(memcmp(rd_ref, rd_new, MEM_SIZE) == 0);
+}
+
+static void test_no_byte_en(void)
+{
+    uint8_t data[64], mem[64] = { 0 };
+    uint32_t len, sw;
+
+    memset(data, 0x5a, sizeof data);
+    for (len = 1; len <= 64; len++) {
+        for (sw = 1; sw <= len; sw++) {
+            /* Whole beats, one copy per stream_width.  */
+            g_assert_cmpuint(write_runs(mem, data, len, sw, NULL, 0), ==,
+                             DIV_ROUND_UP(len, sw));
+            check_one(len, sw, NULL, 0);
+        }
+    }
+}
+
+static void test_strobes(void)
+{
+    /* Typical AXI partial strobes on a 16-byte bus.  */
+    static const uint8_t patterns[][16] = {
+        { 1, 1, 1, 1, 0, 0, 0, 0, 1, 1, 1, 1, 0, 0, 0, 0 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 1, 1, 1, 1 },
+        { 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0, 1, 0 },
+        { 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0 },
+        { 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1, 1 },
+    };
+    uint8_t data[64], mem[64] = { 0 };
+    unsigned i;
+
+    memset(data, 0xa5, sizeof data);
+    for (i = 0; i < ARRAY_SIZE(patterns); i++) {
+        check_one(64, 64, patterns[i], 16);
+        check_one(64, 16, patterns[i], 16);
+        check_one(61, 8, patterns[i], 16);
+    }
+
+    /* 4 enabled bytes per 8-byte beat give 8 runs over 64 bytes.  */
+    g_assert_cmpuint(write_runs(mem, data, 64, 64, patterns[0], 16), ==, 8);
+    g_assert_cmpuint(write_runs(mem, data, 64, 64, patterns[3], 16), ==, 0);
+    g_assert_cmpuint(write_runs(mem, data, 64, 64, patterns[4], 16), ==, 1);
+}
+
+static void test_random(void)
+{
+    uint8_t be[32];
+    int iter;
+
+    for (iter = 0; iter < 10000; iter++) {
+        uint32_t len = g_test_rand_int_range(1, MEM_SIZE + 1);
+        uint32_t sw = g_test_rand_int_range(1, len + 1);
+        uint32_t be_len = g_test_rand_int_range(1, sizeof be + 1);
+        uint32_t i;
+
+        for (i = 0; i < be_len; i++) {
+            be[i] = g_test_rand_bit() ? 0xff : 0;
+        }
+        check_one(len, sw, g_test_rand_bit() ? be : NULL, be_len);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    g_test_init(&argc, &argv, NULL);
+    g_test_add_func("/remote-port/byte-en/no-byte-en", test_no_byte_en);
+    g_test_add_func("/remote-port/byte-en/strobes", test_strobes);
+    g_test_add_func("/remote-port/byte-en/random", test_random);
+    return g_test_run();
+}
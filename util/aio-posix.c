@@ -21,6 +21,7 @@
 #include "qemu/rcu_queue.h"
 #include "qemu/sockets.h"
 #include "qemu/cutils.h"
+#include "qemu/event-loop-stats.h"
 #include "trace.h"
 #include "aio-posix.h"
 
@@ -366,7 +367,12 @@ static bool aio_dispatch_handler(AioContext *ctx, AioHandler *node)
         (revents & (G_IO_IN | G_IO_HUP | G_IO_ERR)) &&
         aio_node_check(ctx, node->is_external) &&
         node->io_read) {
-        node->io_read(node->opaque);
+        IOHandler *fn = node->io_read;
+        int64_t start_ns = event_loop_stats_begin();
+
+        fn(node->opaque);
+        event_loop_stats_end(EVENT_LOOP_HANDLER_KIND_FD_READ, (void *)fn, NULL,
+                             start_ns);
 
         /* aio_notify() does not count as progress */
         if (node->opaque != &ctx->notifier) {
@@ -377,7 +383,12 @@ static bool aio_dispatch_handler(AioContext *ctx, AioHandler *node)
         (revents & (G_IO_OUT | G_IO_ERR)) &&
         aio_node_check(ctx, node->is_external) &&
         node->io_write) {
-        node->io_write(node->opaque);
+        IOHandler *fn = node->io_write;
+        int64_t start_ns = event_loop_stats_begin();
+
+        fn(node->opaque);
+        event_loop_stats_end(EVENT_LOOP_HANDLER_KIND_FD_WRITE, (void *)fn, NULL,
+                             start_ns);
         progress = true;
     }
 
@@ -22,6 +22,7 @@
 #include "qemu/sockets.h"
 #include "qapi/error.h"
 #include "qemu/rcu_queue.h"
+#include "qemu/event-loop-stats.h"
 
 struct AioHandler {
     EventNotifier *e;
@@ -284,11 +285,21 @@ static bool aio_dispatch_handlers(AioContext *ctx, HANDLE event)
             (node->io_read || node->io_write)) {
             node->pfd.revents = 0;
             if ((revents & G_IO_IN) && node->io_read) {
-                node->io_read(node->opaque);
+                IOHandler *fn = node->io_read;
+                int64_t start_ns = event_loop_stats_begin();
+
+                fn(node->opaque);
+                event_loop_stats_end(EVENT_LOOP_HANDLER_KIND_FD_READ,
+                                     (void *)fn, NULL, start_ns);
                 progress = true;
             }
             if ((revents & G_IO_OUT) && node->io_write) {
-                node->io_write(node->opaque);
+                IOHandler *fn = node->io_write;
+                int64_t start_ns = event_loop_stats_begin();
+
+                fn(node->opaque);
+                event_loop_stats_end(EVENT_LOOP_HANDLER_KIND_FD_WRITE,
+                                     (void *)fn, NULL, start_ns);
                 progress = true;
             }
 
@@ -33,6 +33,7 @@
 #include "block/raw-aio.h"
 #include "qemu/coroutine_int.h"
 #include "qemu/coroutine-tls.h"
+#include "qemu/event-loop-stats.h"
 #include "sysemu/cpu-timers.h"
 #include "trace.h"
 
@@ -147,7 +148,13 @@ QEMUBH *aio_bh_new_full(AioContext *ctx, QEMUBHFunc *cb, void *opaque,
 
 void aio_bh_call(QEMUBH *bh)
 {
-    bh->cb(bh->opaque);
+    int64_t start_ns = event_loop_stats_begin();
+    QEMUBHFunc *cb = bh->cb;
+    const char *name = bh->name;
+
+    cb(bh->opaque);
+    event_loop_stats_end(EVENT_LOOP_HANDLER_KIND_BH, (void *)cb, name,
+                         start_ns);
 }
 
 /* Multiple occurrences of aio_bh_poll cannot be called concurrently. */
@@ -0,0 +1,146 @@
+/*
+ * Event loop handler accounting
+ *
+ * License: GNU GPL, version 2 or later.
+ *   See the COPYING file in the top-level directory.
+ *
+ * Handlers are keyed by kind plus either their callback pointer or, when
+ * the caller has one, a static name string (BH names, BQL call sites).
+ * Everything goes through one mutex-protected hash table: it is only
+ * touched while accounting is enabled, and handler runs are far less
+ * frequent than the lock operations QSP has to deal with.
+ */
+#include "qemu/osdep.h"
+#include "qemu/thread.h"
+#include "qemu/host-utils.h"
+#include "qemu/event-loop-stats.h"
+
+typedef struct EventLoopStatsKey {
+    EventLoopHandlerKind kind;
+    const void *fn;
+    const char *name;
+    int line;
+} EventLoopStatsKey;
+
+typedef struct EventLoopStatsEntry {
+    EventLoopStatsKey key;
+    uint64_t count;
+    uint64_t total_ns;
+    uint64_t max_ns;
+    uint64_t hist[EVENT_LOOP_STATS_BUCKETS];
+} EventLoopStatsEntry;
+
+bool event_loop_stats_enabled;
+
+static QemuMutex event_loop_stats_lock;
+static GHashTable *event_loop_stats_table;
+
+static guint event_loop_stats_hash(gconstpointer p)
+{
+    const EventLoopStatsKey *k = p;
+
+    return g_direct_hash(k->fn) ^ g_direct_hash(k->name) ^
+           (k->line << 8) ^ k->kind;
+}
+
+static gboolean event_loop_stats_equal(gconstpointer a, gconstpointer b)
+{
+    const EventLoopStatsKey *ka = a;
+    const EventLoopStatsKey *kb = b;
+
+    return ka->kind == kb->kind && ka->fn == kb->fn &&
+           ka->name == kb->name && ka->line == kb->line;
+}
+
+static void __attribute__((__constructor__)) event_loop_stats_init(void)
+{
+    qemu_mutex_init(&event_loop_stats_lock);
+    event_loop_stats_table = g_hash_table_new_full(event_loop_stats_hash,
+                                                   event_loop_stats_equal,
+                                                   NULL, g_free);
+}
+
+/*
+ * Bucket 0 holds runs shorter than 1024 ns, bucket i holds runs in
+ * [2^(9+i), 2^(10+i)) ns and the last bucket also takes anything longer.
+ */
+static unsigned event_loop_stats_bucket(uint64_t ns)
+{
+    if (ns < 1024) {
+        return 0;
+    }
+    return MIN(63 - clz64(ns) - 9, EVENT_LOOP_STATS_BUCKETS - 1);
+}
+
+void event_loop_stats_account(EventLoopHandlerKind kind, const void *fn,
+                              const char *name, int line, int64_t start_ns)
+{
+    uint64_t ns = get_clock() - start_ns;
+    EventLoopStatsKey key = {
+        .kind = kind,
+        .fn = name ? NULL : fn,
+        .name = name,
+        .line = line,
+    };
+    EventLoopStatsEntry *e;
+
+    QEMU_LOCK_GUARD(&event_loop_stats_lock);
+    e = g_hash_table_lookup(event_loop_stats_table, &key);
+    if (!e) {
+        e = g_new0(EventLoopStatsEntry, 1);
+        e->key = key;
+        g_hash_table_insert(event_loop_stats_table, &e->key, e);
+    }
+    e->count++;
+    e->total_ns += ns;
+    e->max_ns = MAX(e->max_ns, ns);
+    e->hist[event_loop_stats_bucket(ns)]++;
+}
+
+void event_loop_stats_enable(bool enable)
+{
+    qatomic_set(&event_loop_stats_enabled, enable);
+}
+
+void event_loop_stats_reset(void)
+{
+    QEMU_LOCK_GUARD(&event_loop_stats_lock);
+    g_hash_table_remove_all(event_loop_stats_table);
+}
+
+static char *event_loop_stats_name(const EventLoopStatsKey *k)
+{
+    if (!k->name) {
+        return g_strdup_printf("%p", k->fn);
+    }
+    if (k->line) {
+        return g_strdup_printf("%s:%d", k->name, k->line);
+    }
+    return g_strdup(k->name);
+}
+
+EventLoopHandlerStatsList *event_loop_stats_query(void)
+{
+    EventLoopHandlerStatsList *head = NULL, **tail = &head;
+    GHashTableIter iter;
+    EventLoopStatsEntry *e;
+
+    QEMU_LOCK_GUARD(&event_loop_stats_lock);
+    g_hash_table_iter_init(&iter, event_loop_stats_table);
+    while (g_hash_table_iter_next(&iter, NULL, (gpointer *)&e)) {
+        EventLoopHandlerStats *s = g_new0(EventLoopHandlerStats, 1);
+        uint64List **hist_tail = &s->histogram;
+        int i;
+
+        s->kind = e->key.kind;
+        s->name = event_loop_stats_name(&e->key);
+        s->count = e->count;
+        s->total_ns = e->total_ns;
+        s->max_ns = e->max_ns;
+        for (i = 0; i < EVENT_LOOP_STATS_BUCKETS; i++) {
+            QAPI_LIST_APPEND(hist_tail, e->hist[i]);
+        }
+        QAPI_LIST_APPEND(tail, s);
+    }
+    return head;
+}
@@ -39,6 +39,7 @@
 #include "qemu/help-texts.h"
 #include "qemu/gcm.h"
 #include "qemu/log.h"
+#include "qemu/bswap.h"
 
 /*
  * 32-bit integer manipulation macros (big endian)
@@ -63,6 +64,241 @@
 }
 #endif
 
+/*
+ * Host acceleration. GHASH can use carry-less multiply instructions,
+ * aggregating GCM_AGG_BLOCKS blocks per reduction, and the CTR keystream
+ * can use the AES instructions. Both fall back to the table driven code
+ * above and aes_crypt_ecb.
+ */
+#define GCM_ACCEL_CLMUL  1
+#define GCM_ACCEL_AES    2
+
+#define GCM_AGG_BLOCKS   8
+/* Blocks of keystream generated at a time on the bulk path.  */
+#define GCM_BULK_BLOCKS  32
+
+static unsigned int gcm_accel;
+
+#if defined(CONFIG_X86_CRYPTO_OPT)
+#include "qemu/cpuid.h"
+
+#pragma GCC push_options
+#pragma GCC target("aes,pclmul,sse4.1")
+#include <immintrin.h>
+
+static inline __m128i gcm_bswap128(__m128i x)
+{
+    return _mm_shuffle_epi8(x, _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7,
+                                            8, 9, 10, 11, 12, 13, 14, 15));
+}
+
+/* Accumulate the 256-bit carry-less product of @a and @b into @lo/@hi.  */
+static inline void gcm_clmul_acc(__m128i a, __m128i b,
+                                 __m128i *lo, __m128i *hi)
+{
+    __m128i mid = _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x10),
+                                _mm_clmulepi64_si128(a, b, 0x01));
+
+    *lo = _mm_xor_si128(*lo, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x00),
+                                           _mm_slli_si128(mid, 8)));
+    *hi = _mm_xor_si128(*hi, _mm_xor_si128(_mm_clmulepi64_si128(a, b, 0x11),
+                                           _mm_srli_si128(mid, 8)));
+}
+
+/*
+ * Reduce a product modulo the GHASH polynomial. The operands are bit
+ * reflected, so the product is first shifted left by one (see Intel's
+ * "Carry-Less Multiplication and Its Usage for Computing the GCM Mode").
+ */
+static inline __m128i gcm_clmul_reduce(__m128i lo, __m128i hi)
+{
+    __m128i t, u;
+
+    /* Shift the 256-bit value lo:hi left by one bit.  */
+    t = _mm_srli_epi32(lo, 31);
+    u = _mm_srli_epi32(hi, 31);
+    lo = _mm_slli_epi32(lo, 1);
+    hi = _mm_slli_epi32(hi, 1);
+    hi = _mm_or_si128(hi, _mm_or_si128(_mm_slli_si128(u, 4),
+                                       _mm_srli_si128(t, 12)));
+    lo = _mm_or_si128(lo, _mm_slli_si128(t, 4));
+
+    /* First phase.  */
+    t = _mm_xor_si128(_mm_xor_si128(_mm_slli_epi32(lo, 31),
+                                    _mm_slli_epi32(lo, 30)),
+                      _mm_slli_epi32(lo, 25));
+    u = _mm_srli_si128(t, 4);
+    lo = _mm_xor_si128(lo, _mm_slli_si128(t, 12));
+
+    /* Second phase.  */
+    t = _mm_xor_si128(_mm_xor_si128(_mm_srli_epi32(lo, 1),
+                                    _mm_srli_epi32(lo, 2)),
+                      _mm_srli_epi32(lo, 7));
+    t = _mm_xor_si128(t, u);
+    return _mm_xor_si128(hi, _mm_xor_si128(lo, t));
+}
+
+static void gcm_clmul_init(gcm_context *ctx, const unsigned char h[16])
+{
+    __m128i h1 = gcm_bswap128(_mm_loadu_si128((const __m128i *)h));
+    __m128i hn = h1;
+    int i;
+
+    _mm_storeu_si128((__m128i *)ctx->Hpow[0], h1);
+    for (i = 1; i < GCM_AGG_BLOCKS; i++) {
+        __m128i lo = _mm_setzero_si128(), hi = lo;
+
+        gcm_clmul_acc(hn, h1, &lo, &hi);
+        hn = gcm_clmul_reduce(lo, hi);
+        _mm_storeu_si128((__m128i *)ctx->Hpow[i], hn);
+    }
+}
+
+static void gcm_clmul_ghash(gcm_context *ctx, unsigned char x[16],
+                            const unsigned char *in, size_t nblocks)
+{
+    __m128i y = gcm_bswap128(_mm_loadu_si128((__m128i *)x));
+    __m128i h[GCM_AGG_BLOCKS];
+    int i;
+
+    for (i = 0; i < GCM_AGG_BLOCKS; i++) {
+        h[i] = _mm_loadu_si128((const __m128i *)ctx->Hpow[i]);
+    }
+
+    /*
+     * Y' = (Y ^ B0).H^n ^ B1.H^(n-1) ^ ... ^ Bn-1.H, with a single
+     * reduction for the n products.
+     */
+    for (; nblocks >= GCM_AGG_BLOCKS; nblocks -= GCM_AGG_BLOCKS) {
+        __m128i lo = _mm_setzero_si128(), hi = lo;
+
+        for (i = 0; i < GCM_AGG_BLOCKS; i++) {
+            __m128i b = gcm_bswap128(_mm_loadu_si128((const __m128i *)in));
+
+            if (i == 0) {
+                b = _mm_xor_si128(b, y);
+            }
+            gcm_clmul_acc(b, h[GCM_AGG_BLOCKS - 1 - i], &lo, &hi);
+            in += 16;
+        }
+        y = gcm_clmul_reduce(lo, hi);
+    }
+    for (; nblocks; nblocks--) {
+        __m128i lo = _mm_setzero_si128(), hi = lo;
+        __m128i b = gcm_bswap128(_mm_loadu_si128((const __m128i *)in));
+
+        gcm_clmul_acc(_mm_xor_si128(y, b), h[0], &lo, &hi);
+        y = gcm_clmul_reduce(lo, hi);
+        in += 16;
+    }
+    _mm_storeu_si128((__m128i *)x, gcm_bswap128(y));
+}
+
+static inline __m128i gcm_aes_block(const __m128i *rk, int rounds,
+                                    __m128i x)
+{
+    int r;
+
+    x = _mm_xor_si128(x, rk[0]);
+    for (r = 1; r < rounds; r++) {
+        x = _mm_aesenc_si128(x, rk[r]);
+    }
+    return _mm_aesenclast_si128(x, rk[rounds]);
+}
+
+#define GCM_AES_LANES 8
+
+/*
+ * Increment the 32-bit counter in @ctr before each block, as the C
+ * code does, and write the encrypted counters to @ks.
+ */
+static void gcm_aes_ctr(gcm_context *ctx, unsigned char ctr[16],
+                        unsigned char *ks, size_t nblocks)
+{
+    int rounds = ctx->aes_ctx.rounds;
+    __m128i rk[AES_MAXNR + 1];
+    __m128i base = _mm_loadu_si128((__m128i *)ctr);
+    __m128i c[GCM_AES_LANES];
+    uint32_t n = ldl_be_p(ctr + 12);
+    int i, r;
+
+    for (r = 0; r <= rounds; r++) {
+        rk[r] = _mm_loadu_si128((const __m128i *)ctx->aes_rk[r]);
+    }
+
+    /* Interleave blocks to hide the latency of the AES instructions.  */
+    for (; nblocks >= GCM_AES_LANES; nblocks -= GCM_AES_LANES) {
+        for (i = 0; i < GCM_AES_LANES; i++) {
+            c[i] = _mm_insert_epi32(base, bswap32(++n), 3);
+            c[i] = _mm_xor_si128(c[i], rk[0]);
+        }
+        for (r = 1; r < rounds; r++) {
+            for (i = 0; i < GCM_AES_LANES; i++) {
+                c[i] = _mm_aesenc_si128(c[i], rk[r]);
+            }
+        }
+        for (i = 0; i < GCM_AES_LANES; i++) {
+            c[i] = _mm_aesenclast_si128(c[i], rk[rounds]);
+            _mm_storeu_si128((__m128i *)ks, c[i]);
+            ks += 16;
+        }
+    }
+    for (; nblocks; nblocks--) {
+        c[0] = gcm_aes_block(rk, rounds,
+                             _mm_insert_epi32(base, bswap32(++n), 3));
+        _mm_storeu_si128((__m128i *)ks, c[0]);
+        ks += 16;
+    }
+    stl_be_p(ctr + 12, n);
+}
+
+#pragma GCC pop_options
+
+static void __attribute__((constructor)) init_gcm_accel(void)
+{
+    unsigned a, b, c, d;
+
+    if (__get_cpuid(1, &a, &b, &c, &d) &&
+        (c & bit_PCLMUL) && (c & bit_SSE4_1)) {
+        gcm_accel |= GCM_ACCEL_CLMUL;
+        if (c & bit_AES) {
+            gcm_accel |= GCM_ACCEL_AES;
+        }
+    }
+}
+#else
+static void gcm_clmul_init(gcm_context *ctx, const unsigned char h[16])
+{
+    g_assert_not_reached();
+}
+
+static void gcm_clmul_ghash(gcm_context *ctx, unsigned char x[16],
+                            const unsigned char *in, size_t nblocks)
+{
+    g_assert_not_reached();
+}
+
+static void gcm_aes_ctr(gcm_context *ctx, unsigned char ctr[16],
+                        unsigned char *ks, size_t nblocks)
+{
+    g_assert_not_reached();
+}
+#endif
+
+bool gcm_test_next_accel(void)
+{
+    /* Drop the AES instructions first, then the carry-less multiply.  */
+    if (gcm_accel & GCM_ACCEL_AES) {
+        gcm_accel &= ~GCM_ACCEL_AES;
+        return true;
+    }
+    if (gcm_accel & GCM_ACCEL_CLMUL) {
+        gcm_accel &= ~GCM_ACCEL_CLMUL;
+        return true;
+    }
+    return false;
+}
+
 static void gcm_gen_table( gcm_context *ctx )
 {
     int i, j;
@@ -109,6 +345,9 @@ static void gcm_gen_table( gcm_context *ctx )
         }
     }
 
+    if (ctx->accel & GCM_ACCEL_CLMUL) {
+        gcm_clmul_init(ctx, h);
+    }
 }
 
 int gcm_init( gcm_context *ctx, const unsigned char *key, unsigned int keysize )
@@ -120,6 +359,17 @@ int gcm_init( gcm_context *ctx, const unsigned char *key, unsigned int keysize )
     if( ( ret = aes_setkey_enc( &ctx->aes_ctx, key, keysize ) ) != 0 )
         return( ret );
 
+    /* A context keeps the implementation it was set up for.  */
+    ctx->accel = gcm_accel;
+    if (ctx->accel & GCM_ACCEL_AES) {
+        int i;
+
+        for (i = 0; i < 4 * (ctx->aes_ctx.rounds + 1); i++) {
+            PUT_UINT32_BE(ctx->aes_ctx.rd_key[i], ctx->aes_rk[i / 4],
+                          (i % 4) * 4);
+        }
+    }
+
     gcm_gen_table( ctx );
 
     return( 0 );
@@ -180,6 +430,65 @@ static void gcm_mult( gcm_context *ctx, const unsigned char x[16], unsigned char
     PUT_UINT32_BE( zl, output, 12 );
 }
 
+/* Fold @nblocks full blocks from @in into the GHASH accumulator @x.  */
+static void gcm_ghash(gcm_context *ctx, unsigned char x[16],
+                      const unsigned char *in, size_t nblocks)
+{
+    size_t i;
+
+    if (ctx->accel & GCM_ACCEL_CLMUL) {
+        gcm_clmul_ghash(ctx, x, in, nblocks);
+        return;
+    }
+    for (; nblocks; nblocks--) {
+        for (i = 0; i < 16; i++) {
+            x[i] ^= in[i];
+        }
+        gcm_mult(ctx, x, x);
+        in += 16;
+    }
+}
+
+/*
+ * Bulk path for full blocks: CTR crypt @nblocks blocks from @input to
+ * @output, with the counter in @ctr, and hash the ciphertext into @x.
+ */
+static void gcm_crypt_blocks(gcm_context *ctx, int mode,
+                             unsigned char ctr[16], unsigned char x[16],
+                             unsigned char *output,
+                             const unsigned char *input, size_t nblocks)
+{
+    unsigned char ks[GCM_BULK_BLOCKS * 16];
+    size_t n, i;
+
+    for (; nblocks; nblocks -= n) {
+        n = MIN(nblocks, GCM_BULK_BLOCKS);
+
+        if (ctx->accel & GCM_ACCEL_AES) {
+            gcm_aes_ctr(ctx, ctr, ks, n);
+        } else {
+            for (i = 0; i < n; i++) {
+                stl_be_p(ctr + 12, ldl_be_p(ctr + 12) + 1);
+                aes_crypt_ecb(&ctx->aes_ctx, AES_ENCRYPT, ctr, ks + i * 16);
+            }
+        }
+
+        /* Hash the input before a decryption in place overwrites it.  */
+        if (mode == GCM_DECRYPT) {
+            gcm_ghash(ctx, x, input, n);
+        }
+        for (i = 0; i < n * 16; i++) {
+            output[i] = input[i] ^ ks[i];
+        }
+        if (mode == GCM_ENCRYPT) {
+            gcm_ghash(ctx, x, output, n);
+        }
+
+        input += n * 16;
+        output += n * 16;
+    }
+}
+
 void gcm_push_iv(gcm_context *ctx,
                  const unsigned char *iv,
                  size_t iv_len, size_t tag_len)
@@ -201,6 +510,12 @@ void gcm_push_aad(gcm_context *ctx,
     size_t i;
 
     p = aad;
+    use_len = aad_len & ~(size_t)15;
+    gcm_ghash(ctx, ctx->mul, p, use_len / 16);
+    aad_len -= use_len;
+    p += use_len;
+    ctx->aad_len += use_len;
+
     while(aad_len > 0)
     {
         use_len = ( aad_len < 16 ) ? aad_len : 16;
@@ -236,6 +551,19 @@ void gcm_push_data(gcm_context *ctx,
     p = input;
     while( length > 0 )
     {
+        if (ctx->ectr_len == 0 && ctx->mul_idx == 0 && length >= 16) {
+            size_t nblocks = length / 16;
+
+            gcm_crypt_blocks(ctx, mode, ctx->iv, ctx->mul, out_p, p,
+                             nblocks);
+            use_len = nblocks * 16;
+            length -= use_len;
+            p += use_len;
+            out_p += use_len;
+            ctx->data_len += use_len;
+            continue;
+        }
+
         use_len = ( length < 16 ) ? length : 16;
         if (ctx->ectr_len && use_len > ctx->ectr_len) {
             use_len = ctx->ectr_len;
@@ -374,6 +702,11 @@ int gcm_crypt_and_tag( gcm_context *ctx,
     memcpy( tag, ectr, tag_len );
 
     p = add;
+    use_len = add_len & ~(size_t)15;
+    gcm_ghash( ctx, buf, p, use_len / 16 );
+    add_len -= use_len;
+    p += use_len;
+
     while( add_len > 0 )
     {
         use_len = ( add_len < 16 ) ? add_len : 16;
@@ -387,7 +720,12 @@ int gcm_crypt_and_tag( gcm_context *ctx,
         p += use_len;
     }
 
-    p = input;
+    use_len = length & ~(size_t)15;
+    gcm_crypt_blocks( ctx, mode, y, buf, out_p, input, use_len / 16 );
+    length -= use_len;
+    p = input + use_len;
+    out_p += use_len;
+
     while( length > 0 )
     {
         use_len = ( length < 16 ) ? length : 16;
@@ -34,6 +34,7 @@
 #include "qemu/error-report.h"
 #include "qemu/queue.h"
 #include "qemu/compiler.h"
+#include "qemu/event-loop-stats.h"
 #include "qom/object.h"
 
 #ifndef _WIN32
@@ -251,6 +252,9 @@ type_init(main_loop_register_types)
 
 static int max_priority;
 
+/* When the main loop last took the BQL, for the event loop stats.  */
+static int64_t main_loop_bql_start_ns;
+
 #ifndef _WIN32
 static int glib_pollfds_idx;
 static int glib_n_poll_fds;
@@ -309,6 +313,8 @@ static int os_host_main_loop_wait(int64_t timeout)
 
     glib_pollfds_fill(&timeout);
 
+    event_loop_stats_end(EVENT_LOOP_HANDLER_KIND_MAIN_LOOP, NULL, "main-loop",
+                         main_loop_bql_start_ns);
     qemu_mutex_unlock_iothread();
     replay_mutex_unlock();
 
@@ -316,6 +322,7 @@ static int os_host_main_loop_wait(int64_t timeout)
 
     replay_mutex_lock();
     qemu_mutex_lock_iothread();
+    main_loop_bql_start_ns = event_loop_stats_begin();
 
     glib_pollfds_poll();
 
@@ -521,6 +528,8 @@ static int os_host_main_loop_wait(int64_t timeout)
 
     poll_timeout_ns = qemu_soonest_timeout(poll_timeout_ns, timeout);
 
+    event_loop_stats_end(EVENT_LOOP_HANDLER_KIND_MAIN_LOOP, NULL, "main-loop",
+                         main_loop_bql_start_ns);
     qemu_mutex_unlock_iothread();
 
     replay_mutex_unlock();
@@ -530,6 +539,7 @@ static int os_host_main_loop_wait(int64_t timeout)
     replay_mutex_lock();
 
     qemu_mutex_lock_iothread();
+    main_loop_bql_start_ns = event_loop_stats_begin();
     if (g_poll_ret > 0) {
         for (i = 0; i < w->num; i++) {
             w->revents[i] = poll_fds[n_poll_fds + i].revents;
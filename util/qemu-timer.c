@@ -26,6 +26,7 @@
 #include "qemu/main-loop.h"
 #include "qemu/timer.h"
 #include "qemu/lockable.h"
+#include "qemu/event-loop-stats.h"
 #include "sysemu/cpu-timers.h"
 #include "sysemu/replay.h"
 #include "sysemu/cpus.h"
@@ -505,6 +506,7 @@ bool timerlist_run_timers(QEMUTimerList *timer_list)
     bool progress = false;
     QEMUTimerCB *cb;
     void *opaque;
+    int64_t start_ns;
 
     if (!qatomic_read(&timer_list->active_timers)) {
         return false;
@@ -573,7 +575,10 @@ bool timerlist_run_timers(QEMUTimerList *timer_list)
 
         /* run the callback (the timer list can be modified) */
         qemu_mutex_unlock(&timer_list->active_timers_lock);
+        start_ns = event_loop_stats_begin();
         cb(opaque);
+        event_loop_stats_end(EVENT_LOOP_HANDLER_KIND_TIMER, (void *)cb, NULL,
+                             start_ns);
         qemu_mutex_lock(&timer_list->active_timers_lock);
 
         progress = true;
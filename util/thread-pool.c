@@ -18,6 +18,7 @@
 #include "qemu/queue.h"
 #include "qemu/thread.h"
 #include "qemu/coroutine.h"
+#include "qemu/timer.h"
 #include "trace.h"
 #include "block/thread-pool.h"
 #include "qemu/main-loop.h"
@@ -45,6 +46,9 @@ struct ThreadPoolElement {
     enum ThreadState state;
     int ret;
 
+    /* Host monotonic time at submission, for the queue latency stats.  */
+    int64_t submit_ns;
+
     /* Access to this list is protected by lock.  */
     QTAILQ_ENTRY(ThreadPoolElement) reqs;
 
@@ -71,6 +75,15 @@ struct ThreadPool {
     int pending_threads; /* threads created but not running yet */
     int min_threads;
     int max_threads;
+
+    /* Statistics, also protected by lock.  */
+    int64_t queue_depth;
+    int64_t max_queue_depth;
+    uint64_t submitted;
+    uint64_t completed;
+    uint64_t total_wait_ns;
+    uint64_t max_wait_ns;
+    uint64_t total_run_ns;
 };
 
 static void *worker_thread(void *opaque)
@@ -83,6 +96,8 @@ static void *worker_thread(void *opaque)
 
     while (pool->cur_threads <= pool->max_threads) {
         ThreadPoolElement *req;
+        int64_t start_ns;
+        uint64_t wait_ns;
         int ret;
 
         if (QTAILQ_EMPTY(&pool->request_list)) {
@@ -105,6 +120,12 @@ static void *worker_thread(void *opaque)
         req = QTAILQ_FIRST(&pool->request_list);
         QTAILQ_REMOVE(&pool->request_list, req, reqs);
         req->state = THREAD_ACTIVE;
+        pool->queue_depth--;
+
+        start_ns = get_clock();
+        wait_ns = start_ns - req->submit_ns;
+        pool->total_wait_ns += wait_ns;
+        pool->max_wait_ns = MAX(pool->max_wait_ns, wait_ns);
         qemu_mutex_unlock(&pool->lock);
 
         ret = req->func(req->arg);
@@ -116,6 +137,8 @@ static void *worker_thread(void *opaque)
 
         qemu_bh_schedule(pool->completion_bh);
         qemu_mutex_lock(&pool->lock);
+        pool->total_run_ns += get_clock() - start_ns;
+        pool->completed++;
     }
 
     pool->cur_threads--;
@@ -224,6 +247,7 @@ static void thread_pool_cancel(BlockAIOCB *acb)
     QEMU_LOCK_GUARD(&pool->lock);
     if (elem->state == THREAD_QUEUED) {
         QTAILQ_REMOVE(&pool->request_list, elem, reqs);
+        pool->queue_depth--;
         qemu_bh_schedule(pool->completion_bh);
 
         elem->state = THREAD_DONE;
@@ -250,6 +274,7 @@ BlockAIOCB *thread_pool_submit_aio(ThreadPool *pool,
         BlockCompletionFunc *cb, void *opaque)
 {
     ThreadPoolElement *req;
+    bool wake;
 
     req = qemu_aio_get(&thread_pool_aiocb_info, NULL, cb, opaque);
     req->func = func;
@@ -265,9 +290,23 @@ BlockAIOCB *thread_pool_submit_aio(ThreadPool *pool,
     if (pool->idle_threads == 0 && pool->cur_threads < pool->max_threads) {
         spawn_thread(pool);
     }
+    req->submit_ns = get_clock();
     QTAILQ_INSERT_TAIL(&pool->request_list, req, reqs);
+    pool->submitted++;
+    pool->queue_depth++;
+    pool->max_queue_depth = MAX(pool->max_queue_depth, pool->queue_depth);
+
+    /*
+     * Busy and still-starting workers look at request_list before going
+     * to sleep, so only pay for a wakeup if somebody is actually idle.
+     * Back-to-back submissions from one AioContext then cost a single
+     * futex call instead of one per request.
+     */
+    wake = pool->idle_threads > 0;
     qemu_mutex_unlock(&pool->lock);
-    qemu_cond_signal(&pool->request_cond);
+    if (wake) {
+        qemu_cond_signal(&pool->request_cond);
+    }
     return &req->common;
 }
 
@@ -326,6 +365,25 @@ void thread_pool_update_params(ThreadPool *pool, AioContext *ctx)
     qemu_mutex_unlock(&pool->lock);
 }
 
+ThreadPoolStats *thread_pool_query_stats(ThreadPool *pool)
+{
+    ThreadPoolStats *stats = g_new0(ThreadPoolStats, 1);
+
+    QEMU_LOCK_GUARD(&pool->lock);
+    stats->threads = pool->cur_threads;
+    stats->idle_threads = pool->idle_threads;
+    stats->queue_depth = pool->queue_depth;
+    stats->max_queue_depth = pool->max_queue_depth;
+    stats->submitted = pool->submitted;
+    stats->completed = pool->completed;
+    if (pool->completed) {
+        stats->avg_wait_ns = pool->total_wait_ns / pool->completed;
+        stats->avg_run_ns = pool->total_run_ns / pool->completed;
+    }
+    stats->max_wait_ns = pool->max_wait_ns;
+    return stats;
+}
+
 static void thread_pool_init_one(ThreadPool *pool, AioContext *ctx)
 {
     if (!ctx) {